@@ -0,0 +1,118 @@
+/*****************************************************************************
+ * Copyright (c) 2021 Bosch.IO GmbH
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * SPDX-License-Identifier: MPL-2.0
+ ****************************************************************************/
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "batch_queue.hpp"
+#include "benchmark.hpp"
+
+using namespace iotea::core;
+using namespace iotea::benchmark;
+
+static constexpr uint64_t MESSAGES = 2000000;
+
+using message_ptr = std::shared_ptr<const std::string>;
+
+/**
+ * @brief Stand-in for the MQTT client's consumer queue: every message is
+ * taken under its own lock.
+ */
+class SingleQueue {
+   public:
+    void Push(message_ptr msg) {
+        {
+            std::lock_guard<std::mutex> lock{mutex_};
+            items_.push_back(std::move(msg));
+        }
+        cv_.notify_one();
+    }
+
+    message_ptr TryPopFor(std::chrono::milliseconds timeout) {
+        std::unique_lock<std::mutex> lock{mutex_};
+        if (!cv_.wait_for(lock, timeout, [this] { return !items_.empty(); })) {
+            return nullptr;
+        }
+        auto msg = std::move(items_.front());
+        items_.pop_front();
+        return msg;
+    }
+
+   private:
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::deque<message_ptr> items_;
+};
+
+/**
+ * @brief Stand-in for the broker: delivers MESSAGES messages from its own
+ * thread.
+ */
+template <typename Queue>
+static std::thread Produce(Queue& queue) {
+    return std::thread{[&queue] {
+        auto msg = std::make_shared<const std::string>(R"({"feature":"temp","value":21})");
+        for (uint64_t i = 0; i < MESSAGES; i++) {
+            queue.Push(msg);
+        }
+    }};
+}
+
+int main() {
+    uint64_t handled = 0;
+
+    {
+        // Previous loop: one message per iteration plus a locked connection check
+        SingleQueue queue;
+        std::mutex connection_mutex;
+        bool connected = true;
+
+        auto producer = Produce(queue);
+        Measure("receive: single message loop", MESSAGES, [&](uint64_t) {
+            message_ptr msg;
+            while (msg == nullptr) {
+                {
+                    std::lock_guard<std::mutex> lock{connection_mutex};
+                    DoNotOptimize(connected);
+                }
+                msg = queue.TryPopFor(std::chrono::milliseconds{100});
+            }
+            handled += msg->size();
+        });
+        producer.join();
+    }
+
+    for (size_t batch_size : {1, 16, 64, 256}) {
+        BatchQueue<message_ptr> queue;
+        std::vector<message_ptr> batch;
+        size_t next = 0;
+
+        auto producer = Produce(queue);
+        Measure("receive: batch loop (" + std::to_string(batch_size) + ")", MESSAGES, [&](uint64_t) {
+            while (next == batch.size()) {
+                batch.clear();
+                next = 0;
+                queue.PopBatch(batch, batch_size, std::chrono::milliseconds{100});
+            }
+            handled += batch[next++]->size();
+        });
+        producer.join();
+    }
+
+    DoNotOptimize(handled);
+    return 0;
+}
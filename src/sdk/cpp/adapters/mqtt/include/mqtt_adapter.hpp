@@ -11,34 +11,53 @@
 #ifndef SRC_SDK_CPP_ADAPTERS_MQTT_HPP_
 #define SRC_SDK_CPP_ADAPTERS_MQTT_HPP_
 
-#include <chrono>
-#include <functional>
-#include <list>
 #include <memory>
 #include <string>
-#include <unordered_map>
-#include <utility>
 #include <vector>
 
-#pragma GCC diagnostic push
-#pragma GCC diagnostic ignored "-Wunused-parameter"
-#include <mqtt/async_client.h>
-#pragma GCC diagnostic pop
-
 #include "nlohmann/json.hpp"
 
 using json = nlohmann::json;
 
-#include "logging.hpp"
+#include "mqtt_connection.hpp"
 #include "protocol_gateway.hpp"
-#include "util.hpp"
 
 namespace iotea {
 namespace core {
 
 extern "C" {
+
 class MqttProtocolAdapter : public Adapter {
    public:
+    /**
+     * @brief Construct a new MqttProtocolAdapter.
+     *
+     * @param name The name of the adapter
+     * @param is_platform_proto Whether the adapter speaks the platform protocol
+     * @param config The adapter configuration: "brokerUrl", "topicNamespace"
+     * and optionally "receiveBatchSize", the maximum number of received
+     * messages handled between two checks of the connection state
+     * (default 64), "qos", the QoS to publish with unless specified by the
+     * PublishOptions (default 0), and "maxInFlight", the maximum number of
+     * published messages waiting for their delivery (default 1024).
+     * Stashed messages published while disconnected are kept in a spool
+     * file if "spool" is configured: "path", the file to use, "maxSize", the
+     * maximum number of bytes to keep (default 16 MiB), and "drainRate", the
+     * maximum number of spooled messages published per second after a
+     * reconnect (default 1000).
+     * Reconnects are attempted with an exponential, jittered backoff between
+     * "minReconnectDelayMs" (default 100) and "maxReconnectDelayMs" (default
+     * 30000). "clientId" sets a stable client ID and "persistentSession"
+     * (default false) asks the broker to keep the session, including queued
+     * messages, while disconnected; it requires a client ID.
+     * "connections" (default 1) spreads the traffic over several connections
+     * to the broker, each with its own receive loop. Messages are published
+     * on a connection chosen by their topic, which preserves the order per
+     * topic. Shared subscriptions are made on every connection so that the
+     * broker balances them, other subscriptions on the first connection
+     * only. With several connections, the client ID and the spool path are
+     * suffixed with "-<n>" and ".<n>".
+     */
     MqttProtocolAdapter(const std::string& name, bool is_platform_proto, const json& config);
 
     virtual ~MqttProtocolAdapter() = default;
@@ -46,33 +65,30 @@ class MqttProtocolAdapter : public Adapter {
     // Adapter
     void Start() override;
     void Stop() override;
-    void Publish(const std::string& topic, const std::string& data, const PublishOptions& opts) override;
+    bool Publish(const std::string& topic, const std::string& data, const PublishOptions& opts) override;
+    bool PublishBatch(const PublishEntry* entries, size_t count) override;
     void Subscribe(const std::string& topic, on_msg_func_ptr on_msg, const SubscribeOptions& opts) override;
     void SubscribeShared(const std::string& group, const std::string& topic, on_msg_func_ptr on_msg, const SubscribeOptions& opts) override;
+    void SubscribePayload(const std::string& topic, on_payload_func_ptr on_msg, const SubscribeOptions& opts) override;
+    void SubscribeSharedPayload(const std::string& group, const std::string& topic, on_payload_func_ptr on_msg, const SubscribeOptions& opts) override;
+
+    /**
+     * @brief Get the counters of the published messages.
+     *
+     * @return PublishCounters
+     */
+    PublishCounters GetPublishCounters() const;
 
    private:
-    enum class State {
-        kDisconnected,
-        kConnecting,
-        kConnected,
-        kStopping,
-    };
+    static constexpr int DEFAULT_QOS = 0;
+    static constexpr size_t DEFAULT_CONNECTIONS = 1;
 
-    void ChangeState(State state);
+    size_t ConnectionFor(const std::string& topic) const;
 
-    mqtt::async_client client_;
+    int qos_;
     std::string topic_ns_;
-    mqtt::connect_options connOpts_;
-
-    on_msg_func_ptr on_msg_;
-    int reconnect_delay_seconds_;
-
-    std::vector<std::string> topics_;
-    std::vector<std::pair<TopicExprMatcher, on_msg_func_ptr>> matchers_;
 
-    std::mutex state_mutex_;
-    State state_;
-    State next_state_;
+    std::vector<std::unique_ptr<MqttConnection>> connections_;
 };
 
 } // extern "C"
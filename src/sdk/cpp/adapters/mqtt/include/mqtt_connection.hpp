@@ -0,0 +1,230 @@
+/*****************************************************************************
+ * Copyright (c) 2021 Bosch.IO GmbH
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * SPDX-License-Identifier: MPL-2.0
+ ****************************************************************************/
+
+#ifndef SRC_SDK_CPP_ADAPTERS_MQTT_MQTT_CONNECTION_HPP_
+#define SRC_SDK_CPP_ADAPTERS_MQTT_MQTT_CONNECTION_HPP_
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <random>
+#include <string>
+#include <vector>
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wunused-parameter"
+#include <mqtt/async_client.h>
+#pragma GCC diagnostic pop
+
+#include "nlohmann/json.hpp"
+
+using json = nlohmann::json;
+
+#include "batch_queue.hpp"
+#include "protocol_gateway.hpp"
+#include "spool.hpp"
+#include "topic_trie.hpp"
+
+namespace iotea {
+namespace core {
+
+/**
+ * @brief PublishCounters reports the state of the messages published by an
+ * MqttProtocolAdapter.
+ */
+struct PublishCounters {
+    uint64_t in_flight;     // Published but neither acknowledged nor failed yet
+    uint64_t acknowledged;  // Acknowledged by the broker (or sent if QoS 0)
+    uint64_t failed;        // Failed to be published or delivered
+    uint64_t rejected;      // Rejected because the in-flight window was full
+    uint64_t spooled;       // Waiting in the spool to be published
+};
+
+/**
+ * @brief OutgoingMessage is a message of a batch published by an
+ * MqttConnection. The payload is owned by the caller.
+ */
+struct OutgoingMessage {
+    std::string topic;
+    const std::string* data;
+    int qos;
+    bool retain;
+    bool stash;
+};
+
+/**
+ * @brief MqttConnection is a single connection of an MqttProtocolAdapter to
+ * the broker. It runs its own state machine and receive loop and delivers
+ * the received messages to the subscriptions made on it.
+ */
+class MqttConnection {
+   public:
+    /**
+     * @brief Construct a new MqttConnection.
+     *
+     * @param config The configuration of the adapter, see MqttProtocolAdapter
+     * @param client_id The client ID to connect with, may be empty
+     * @param spool_path The path of the spool file, unused if the spool is
+     * not configured
+     */
+    MqttConnection(const json& config, const std::string& client_id, const std::string& spool_path);
+
+    MqttConnection(const MqttConnection&) = delete;
+    MqttConnection& operator=(const MqttConnection&) = delete;
+
+    /**
+     * @brief Connect and handle received messages until Stop() is called.
+     */
+    void Run();
+
+    /**
+     * @brief Make Run() disconnect and return.
+     */
+    void Stop();
+
+    /**
+     * @brief Publish a message.
+     *
+     * @param topic The full topic
+     * @param data The payload
+     * @param qos The QoS
+     * @param retain Whether the broker should retain the message
+     * @param stash Whether to spool the message if it cannot be published
+     * @return bool false if the message was rejected
+     */
+    bool Publish(const std::string& topic, const std::string& data, int qos, bool retain, bool stash);
+
+    /**
+     * @brief Publish several messages in order, claiming the in-flight
+     * window for all of them at once.
+     *
+     * @param messages The messages with their full topics
+     * @return size_t The number of messages accepted
+     */
+    size_t PublishBatch(const std::vector<OutgoingMessage>& messages);
+
+    /**
+     * @brief Subscribe to a topic filter, "$share/<group>/" prefixes
+     * included. Takes effect on the next (re)connect.
+     *
+     * @param filter The full topic filter
+     * @param on_msg The callback to call for matching messages
+     */
+    void Subscribe(const std::string& filter, on_payload_func_ptr on_msg);
+
+    /**
+     * @brief Get the counters of the published messages.
+     *
+     * @return PublishCounters
+     */
+    PublishCounters GetPublishCounters() const;
+
+   private:
+    /**
+     * @brief DeliveryTracker counts the published messages through the
+     * callbacks of their delivery tokens.
+     */
+    class DeliveryTracker : public mqtt::iaction_listener {
+       public:
+        explicit DeliveryTracker(size_t window);
+
+        size_t GetWindow() const;
+
+        // Claim a slot in the in-flight window, false if the window is full
+        bool Acquire(bool count_rejection = true);
+
+        // Claim up to count slots, returns the number claimed
+        size_t AcquireMany(size_t count);
+
+        // Release slots claimed for messages that were not published
+        void Release(size_t count = 1);
+
+        // Count messages rejected because the window was full
+        void Reject(size_t count);
+
+        // Count a message that could not be published
+        void Fail();
+
+        PublishCounters GetCounters() const;
+
+        // mqtt::iaction_listener
+        void on_success(const mqtt::token& tok) override;
+        void on_failure(const mqtt::token& tok) override;
+
+       private:
+        const uint64_t window_;
+
+        std::atomic<uint64_t> in_flight_{0};
+        std::atomic<uint64_t> acknowledged_{0};
+        std::atomic<uint64_t> failed_{0};
+        std::atomic<uint64_t> rejected_{0};
+    };
+
+    enum class State {
+        kDisconnected,
+        kConnecting,
+        kConnected,
+        kStopping,
+    };
+
+    static constexpr size_t DEFAULT_RECEIVE_BATCH_SIZE = 64;
+    static constexpr size_t DEFAULT_MAX_IN_FLIGHT = 1024;
+    static constexpr size_t DEFAULT_SPOOL_SIZE = 16 * 1024 * 1024;
+    static constexpr double DEFAULT_SPOOL_DRAIN_RATE = 1000;
+    static constexpr int64_t DEFAULT_MIN_RECONNECT_DELAY_MS = 100;
+    static constexpr int64_t DEFAULT_MAX_RECONNECT_DELAY_MS = 30000;
+
+    void ChangeState(State state);
+    void HandleMessages(std::chrono::milliseconds timeout);
+    bool StashMessage(const std::string& topic, const std::string& data, int qos, bool retain, bool force);
+    void DrainSpool();
+    void ScheduleReconnect();
+    void SubscribeAll();
+
+    // Declared before the client so that it outlives pending deliveries
+    DeliveryTracker deliveries_;
+
+    mqtt::async_client client_;
+    mqtt::connect_options connOpts_;
+
+    // Backoff between reconnect attempts
+    std::chrono::milliseconds min_reconnect_delay_;
+    std::chrono::milliseconds max_reconnect_delay_;
+    std::chrono::milliseconds reconnect_delay_;
+    std::chrono::steady_clock::time_point reconnect_at_;
+    std::minstd_rand rng_;
+
+    std::vector<std::string> topics_;
+    TopicTrie<on_payload_func_ptr> subscriptions_;
+
+    // Messages are queued by the client's callback and handled in batches
+    BatchQueue<mqtt::const_message_ptr> queue_;
+    std::vector<mqtt::const_message_ptr> batch_;
+    size_t batch_size_;
+
+    std::mutex state_mutex_;
+    State state_;
+    State next_state_;
+    std::atomic<bool> connected_{false};
+
+    // Stashed messages published while disconnected
+    mutable std::mutex spool_mutex_;
+    Spool spool_;
+    SpoolRecord drain_record_;
+    double drain_rate_;
+    double drain_budget_;
+    std::chrono::steady_clock::time_point last_drain_;
+};
+
+}  // namespace core
+}  // namespace iotea
+
+#endif // SRC_SDK_CPP_ADAPTERS_MQTT_MQTT_CONNECTION_HPP_
@@ -8,185 +8,166 @@
  * SPDX-License-Identifier: MPL-2.0
  ****************************************************************************/
 
-#include <chrono>
+#include <algorithm>
+#include <functional>
 #include <memory>
-#include <regex>
 #include <string>
 #include <thread>
+#include <vector>
 
+#include "logging.hpp"
 #include "mqtt_adapter.hpp"
 
 namespace iotea {
 namespace core {
 
-using namespace std::chrono_literals;
-
 static auto logger = iotea::core::logging::NamedLogger{"MqttProtocolAdapter"};
 
-/////////////////////////
-// MqttProtocolAdapter //
-/////////////////////////
+constexpr int MqttProtocolAdapter::DEFAULT_QOS;
+constexpr size_t MqttProtocolAdapter::DEFAULT_CONNECTIONS;
 
 extern "C" {
 
 MqttProtocolAdapter::MqttProtocolAdapter(const std::string& name, bool is_platform_proto, const json& config)
     : Adapter{name, is_platform_proto}
-    , client_{config["brokerUrl"].get<std::string>(), "" /* TODO set appropriate client_id */}
+    , qos_{config.value("qos", DEFAULT_QOS)}
     , topic_ns_{config["topicNamespace"].get<std::string>()} {
 
-    state_ = State::kDisconnected;
-    next_state_ = State::kDisconnected;
+    if (qos_ < 0 || qos_ > 2) {
+        logger.Error() << "Invalid QoS " << qos_ << ", using " << DEFAULT_QOS << ".";
+        qos_ = DEFAULT_QOS;
+    }
 
-    reconnect_delay_seconds_ = 0;
+    auto n = std::max<size_t>(config.value("connections", DEFAULT_CONNECTIONS), 1);
+    auto client_id = config.value("clientId", std::string{});
 
-    connOpts_.set_keep_alive_interval(20);
-    connOpts_.set_automatic_reconnect(false);
-    connOpts_.set_clean_session(true);
-    connOpts_.set_connect_timeout(std::chrono::seconds(2));
+    std::string spool_path;
+    auto spool = config.find("spool");
+    if (spool != config.end()) {
+        spool_path = spool->at("path").get<std::string>();
+    }
 
-    client_.start_consuming();
-}
+    for (size_t i = 0; i < n; i++) {
+        // Each connection needs a client ID and spool file of its own
+        auto id = client_id.empty() || n == 1 ? client_id : client_id + "-" + std::to_string(i);
+        auto path = spool_path.empty() || n == 1 ? spool_path : spool_path + "." + std::to_string(i);
 
-void MqttProtocolAdapter::ChangeState(State state) {
-    std::lock_guard<std::mutex> lock(state_mutex_);
-    if (next_state_ != state) {
-        switch (state) {
-            case State::kDisconnected:
-                logger.Debug() << "Changing state to: [Disconnected].";
-                break;
-            case State::kConnecting:
-                logger.Debug() << "Changing state to: [Connecting].";
-                break;
-            case State::kConnected:
-                logger.Debug() << "Changing state to: [Connected].";
-                break;
-            case State::kStopping: {
-                logger.Debug() << "Changing state to: [Stopping].";
-            } break;
-        }
-        next_state_ = state;
+        connections_.push_back(std::make_unique<MqttConnection>(config, id, path));
     }
 }
 
 void MqttProtocolAdapter::Start() {
-    mqtt::token_ptr connect_token;
-    mqtt::token_ptr disconnect_token;
-    bool running = true;
-
-    while (running) {
-        if (next_state_ != state_) {
-            // on_exit
-            switch (state_) {
-                default:
-                    break;
-            }
-            // on entry
-            switch (next_state_) {
-                case State::kConnecting:
-                    logger.Info() << "Connecting to '" << client_.get_server_uri() << "'... ";
-                    connect_token = client_.connect(connOpts_);
-                    break;
-                case State::kConnected: {
-                    logger.Info() << "Connected";
-                    connect_token = nullptr;
-                    for (const auto& topic : topics_) {
-                        client_.subscribe(topic, 1 /* qos */);
-                    }
-                } break;
-                case State::kDisconnected:
-                    logger.Info() << "Disconnected";
-                    reconnect_delay_seconds_ = 5;
-                    break;
-                case State::kStopping:
-                    if (client_.is_connected()) {
-                        logger.Info() << "Disconnecting... ";
-                        disconnect_token = client_.disconnect();
-                    }
-                    break;
-            }
-            state_ = next_state_;
-        }
-        switch (state_) {
-            case State::kConnected: {
-                if (!client_.is_connected()) {
-                    ChangeState(State::kDisconnected);
-                }
-                auto msg = client_.try_consume_message_for(100ms);
-                if (msg != nullptr) {
-                    auto topic = msg->get_topic();
-
-                    for (const auto& m : matchers_) {
-                        if (m.first.Match(topic)) {
-                            m.second(topic, msg->get_payload_str(), "");
-                        }
-                    }
-                }
-
-            } break;
-            case State::kConnecting: {
-                try {
-                    if (connect_token->wait_for(5s)) {
-                        ChangeState(State::kConnected);
-                    }
-                } catch (const mqtt::exception& e) {
-                    logger.Error() << "Unable to connect to MQTT server '" << client_.get_server_uri()
-                                 << "': " << e.to_string();
-                    ChangeState(State::kDisconnected);
-                }
-            } break;
-            case State::kDisconnected: {
-                if (reconnect_delay_seconds_ > 0) {
-                    reconnect_delay_seconds_--;
-                    std::this_thread::sleep_for(1s);
-                } else {
-                    ChangeState(State::kConnecting);
-                }
-            } break;
-
-            case State::kStopping: {
-                if (disconnect_token) {
-                    logger.Debug() << "Wait up to 5 seconds for disconnect confirmation.";
-                    if (disconnect_token->wait_for(5s)) {
-                        logger.Debug() << "Disconnected successfully.";
-                    } else {
-                        logger.Debug() << "Failed to get disconnect confirmation.";
-                    }
-                }
-                running = false;
-            } break;
-        }
+    std::vector<std::thread> threads;
+
+    for (size_t i = 1; i < connections_.size(); i++) {
+        threads.emplace_back(&MqttConnection::Run, connections_[i].get());
+    }
+
+    connections_[0]->Run();
+
+    for (auto& t : threads) {
+        t.join();
     }
 }
 
 void MqttProtocolAdapter::Stop() {
-    ChangeState(State::kStopping);
+    for (auto& c : connections_) {
+        c->Stop();
+    }
+}
+
+size_t MqttProtocolAdapter::ConnectionFor(const std::string& topic) const {
+    if (connections_.size() == 1) {
+        return 0;
+    }
+
+    return std::hash<std::string>{}(topic) % connections_.size();
 }
 
-void MqttProtocolAdapter::Publish(const std::string& topic, const std::string& data, const PublishOptions&) {
+bool MqttProtocolAdapter::Publish(const std::string& topic, const std::string& data, const PublishOptions& opts) {
     auto full_topic = topic_ns_ + topic;
 
-    logger.Debug() << "Publishing message.";
-    logger.Debug() << "\ttopic: '" << full_topic << "'";
-    logger.Debug() << "\tpayload: '" << data << "'";
+    IOTEA_LOG_DEBUG(logger) << "Publishing message.";
+    IOTEA_LOG_DEBUG(logger) << "\ttopic: '" << full_topic << "'";
+    IOTEA_LOG_DEBUG(logger) << "\tpayload: '" << data << "'";
+
+    auto qos = opts.Qos() == PublishOptions::DEFAULT_QOS ? qos_ : opts.Qos();
 
-    client_.publish(full_topic, data);
+    return connections_[ConnectionFor(full_topic)]->Publish(full_topic, data, qos, opts.Retain(), opts.Stash());
 }
 
-void MqttProtocolAdapter::Subscribe(const std::string& topic, on_msg_func_ptr on_msg, const SubscribeOptions&) {
+bool MqttProtocolAdapter::PublishBatch(const PublishEntry* entries, size_t count) {
+    IOTEA_LOG_DEBUG(logger) << "Publishing " << count << " messages.";
+
+    // Split the batch by connection, keeping the order of each
+    std::vector<std::vector<OutgoingMessage>> batches(connections_.size());
+
+    for (size_t i = 0; i < count; i++) {
+        const auto& e = entries[i];
+        auto full_topic = topic_ns_ + e.topic;
+        auto qos = e.opts.Qos() == PublishOptions::DEFAULT_QOS ? qos_ : e.opts.Qos();
+        auto c = ConnectionFor(full_topic);
+
+        batches[c].push_back(OutgoingMessage{std::move(full_topic), &e.msg, qos, e.opts.Retain(), e.opts.Stash()});
+    }
+
+    size_t accepted = 0;
+    for (size_t c = 0; c < batches.size(); c++) {
+        if (!batches[c].empty()) {
+            accepted += connections_[c]->PublishBatch(batches[c]);
+        }
+    }
+
+    return accepted == count;
+}
+
+PublishCounters MqttProtocolAdapter::GetPublishCounters() const {
+    auto sum = PublishCounters{0, 0, 0, 0, 0};
+
+    for (const auto& c : connections_) {
+        auto counters = c->GetPublishCounters();
+        sum.in_flight += counters.in_flight;
+        sum.acknowledged += counters.acknowledged;
+        sum.failed += counters.failed;
+        sum.rejected += counters.rejected;
+        sum.spooled += counters.spooled;
+    }
+
+    return sum;
+}
+
+void MqttProtocolAdapter::Subscribe(const std::string& topic, on_msg_func_ptr on_msg, const SubscribeOptions& opts) {
+    SubscribePayload(topic, [on_msg](const std::string& t, const payload_ptr& m, const std::string& a) {
+        on_msg(t, *m, a);
+    }, opts);
+}
+
+void MqttProtocolAdapter::SubscribeShared(const std::string& group, const std::string& topic, on_msg_func_ptr on_msg, const SubscribeOptions& opts) {
+    SubscribeSharedPayload(group, topic, [on_msg](const std::string& t, const payload_ptr& m, const std::string& a) {
+        on_msg(t, *m, a);
+    }, opts);
+}
+
+void MqttProtocolAdapter::SubscribePayload(const std::string& topic, on_payload_func_ptr on_msg, const SubscribeOptions&) {
     auto topic_with_ns = topic_ns_ + topic;
 
-    logger.Debug() << "Subscribing to " << topic_with_ns;
-    topics_.push_back(topic_with_ns);
-    matchers_.push_back(std::make_pair(TopicExprMatcher{topic_with_ns}, on_msg));
+    IOTEA_LOG_DEBUG(logger) << "Subscribing to " << topic_with_ns;
+
+    // A plain subscription on several connections would deliver each message
+    // several times
+    connections_[0]->Subscribe(topic_with_ns, on_msg);
 }
 
-void MqttProtocolAdapter::SubscribeShared(const std::string& group, const std::string& topic, on_msg_func_ptr on_msg, const SubscribeOptions&) {
+void MqttProtocolAdapter::SubscribeSharedPayload(const std::string& group, const std::string& topic, on_payload_func_ptr on_msg, const SubscribeOptions&) {
     auto topic_with_ns = topic_ns_ + topic;
     auto shared_topic = std::string{"$share"} + "/" + group + "/" + topic_with_ns;
 
-    logger.Debug() << "Subscribing to " << shared_topic;
-    topics_.push_back(shared_topic);
-    matchers_.push_back(std::make_pair(TopicExprMatcher{topic_with_ns}, on_msg));
+    IOTEA_LOG_DEBUG(logger) << "Subscribing to " << shared_topic;
+
+    // The broker balances the messages among the connections of the group
+    for (auto& c : connections_) {
+        c->Subscribe(shared_topic, on_msg);
+    }
 }
 
 } // extern "C"
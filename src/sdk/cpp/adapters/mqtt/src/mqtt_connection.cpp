@@ -0,0 +1,471 @@
+/*****************************************************************************
+ * Copyright (c) 2021 Bosch.IO GmbH
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * SPDX-License-Identifier: MPL-2.0
+ ****************************************************************************/
+
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+
+#include "logging.hpp"
+#include "mqtt_connection.hpp"
+
+namespace iotea {
+namespace core {
+
+using namespace std::chrono_literals;
+
+static auto logger = iotea::core::logging::NamedLogger{"MqttConnection"};
+
+constexpr size_t MqttConnection::DEFAULT_RECEIVE_BATCH_SIZE;
+constexpr size_t MqttConnection::DEFAULT_MAX_IN_FLIGHT;
+constexpr size_t MqttConnection::DEFAULT_SPOOL_SIZE;
+constexpr double MqttConnection::DEFAULT_SPOOL_DRAIN_RATE;
+constexpr int64_t MqttConnection::DEFAULT_MIN_RECONNECT_DELAY_MS;
+constexpr int64_t MqttConnection::DEFAULT_MAX_RECONNECT_DELAY_MS;
+
+/////////////////////
+// DeliveryTracker //
+/////////////////////
+MqttConnection::DeliveryTracker::DeliveryTracker(size_t window)
+    : window_{window} {}
+
+size_t MqttConnection::DeliveryTracker::GetWindow() const {
+    return static_cast<size_t>(window_);
+}
+
+bool MqttConnection::DeliveryTracker::Acquire(bool count_rejection) {
+    if (in_flight_.fetch_add(1) >= window_) {
+        in_flight_--;
+        if (count_rejection) {
+            rejected_++;
+        }
+        return false;
+    }
+
+    return true;
+}
+
+size_t MqttConnection::DeliveryTracker::AcquireMany(size_t count) {
+    auto before = in_flight_.fetch_add(count);
+    auto claimed = before >= window_ ? 0 : std::min<uint64_t>(count, window_ - before);
+
+    if (claimed < count) {
+        in_flight_ -= count - claimed;
+    }
+
+    return static_cast<size_t>(claimed);
+}
+
+void MqttConnection::DeliveryTracker::Release(size_t count) {
+    in_flight_ -= count;
+}
+
+void MqttConnection::DeliveryTracker::Reject(size_t count) {
+    rejected_ += count;
+}
+
+void MqttConnection::DeliveryTracker::Fail() {
+    failed_++;
+}
+
+PublishCounters MqttConnection::DeliveryTracker::GetCounters() const {
+    return PublishCounters{in_flight_.load(), acknowledged_.load(), failed_.load(), rejected_.load(), 0};
+}
+
+void MqttConnection::DeliveryTracker::on_success(const mqtt::token&) {
+    in_flight_--;
+    acknowledged_++;
+}
+
+void MqttConnection::DeliveryTracker::on_failure(const mqtt::token& tok) {
+    Release();
+    Fail();
+    IOTEA_LOG_DEBUG(logger) << "Failed to deliver message " << tok.get_message_id() << ".";
+}
+
+////////////////////
+// MqttConnection //
+////////////////////
+MqttConnection::MqttConnection(const json& config, const std::string& client_id, const std::string& spool_path)
+    : deliveries_{std::max<size_t>(config.value("maxInFlight", DEFAULT_MAX_IN_FLIGHT), 1)}
+    , client_{config["brokerUrl"].get<std::string>(), client_id}
+    , min_reconnect_delay_{std::max<int64_t>(config.value("minReconnectDelayMs", DEFAULT_MIN_RECONNECT_DELAY_MS), 1)}
+    , max_reconnect_delay_{std::max<int64_t>(config.value("maxReconnectDelayMs", DEFAULT_MAX_RECONNECT_DELAY_MS), 1)}
+    , reconnect_delay_{min_reconnect_delay_}
+    , rng_{std::random_device{}()}
+    , batch_size_{std::max<size_t>(config.value("receiveBatchSize", DEFAULT_RECEIVE_BATCH_SIZE), 1)}
+    , drain_rate_{DEFAULT_SPOOL_DRAIN_RATE}
+    , drain_budget_{0} {
+
+    state_ = State::kDisconnected;
+    next_state_ = State::kDisconnected;
+
+    max_reconnect_delay_ = std::max(max_reconnect_delay_, min_reconnect_delay_);
+
+    auto persistent_session = config.value("persistentSession", false);
+    if (persistent_session && client_.get_client_id().empty()) {
+        logger.Error() << "A persistent session requires a \"clientId\", using a clean session.";
+        persistent_session = false;
+    }
+
+    connOpts_.set_keep_alive_interval(20);
+    connOpts_.set_automatic_reconnect(false);
+    connOpts_.set_clean_session(!persistent_session);
+    connOpts_.set_connect_timeout(std::chrono::seconds(2));
+
+    // The in-flight window is enforced by the adapter, keep the client from
+    // failing publishes earlier
+    connOpts_.set_max_inflight(static_cast<int>(deliveries_.GetWindow()));
+
+    // Messages are received through the callback rather than the client's
+    // consumer queue so that they can be taken in batches, and connection
+    // loss is signalled instead of polled for every message.
+    client_.set_message_callback([this](mqtt::const_message_ptr msg) {
+        queue_.Push(std::move(msg));
+    });
+
+    client_.set_connection_lost_handler([this](const std::string&) {
+        connected_ = false;
+        ChangeState(State::kDisconnected);
+    });
+
+    auto spool = config.find("spool");
+    if (spool != config.end()) {
+        drain_rate_ = std::max(spool->value("drainRate", DEFAULT_SPOOL_DRAIN_RATE), 1.0);
+
+        if (!spool_.Open(spool_path, spool->value("maxSize", DEFAULT_SPOOL_SIZE))) {
+            logger.Error() << "Continuing without spool.";
+        }
+    }
+
+    batch_.reserve(batch_size_);
+}
+
+void MqttConnection::ChangeState(State state) {
+    std::lock_guard<std::mutex> lock(state_mutex_);
+
+    // The connection lost handler runs on the client's thread and must not
+    // undo a pending stop
+    if (next_state_ == State::kStopping) {
+        return;
+    }
+
+    if (next_state_ != state) {
+        switch (state) {
+            case State::kDisconnected:
+                IOTEA_LOG_DEBUG(logger) << "Changing state to: [Disconnected].";
+                break;
+            case State::kConnecting:
+                IOTEA_LOG_DEBUG(logger) << "Changing state to: [Connecting].";
+                break;
+            case State::kConnected:
+                IOTEA_LOG_DEBUG(logger) << "Changing state to: [Connected].";
+                break;
+            case State::kStopping: {
+                IOTEA_LOG_DEBUG(logger) << "Changing state to: [Stopping].";
+            } break;
+        }
+        next_state_ = state;
+
+        // Let the receive loop react without waiting for a message
+        queue_.Wake();
+    }
+}
+
+void MqttConnection::HandleMessages(std::chrono::milliseconds timeout) {
+    queue_.PopBatch(batch_, batch_size_, timeout);
+
+    for (const auto& msg : batch_) {
+        const auto& topic = msg->get_topic();
+
+        // Shares ownership of the message instead of copying the payload
+        auto payload = payload_ptr{msg, &msg->get_payload()};
+
+        subscriptions_.Match(topic, [&topic, &payload](const on_payload_func_ptr& on_msg) {
+            on_msg(topic, payload, "");
+        });
+    }
+
+    batch_.clear();
+}
+
+void MqttConnection::Run() {
+    mqtt::token_ptr connect_token;
+    mqtt::token_ptr disconnect_token;
+    bool running = true;
+
+    while (running) {
+        State next_state;
+        {
+            std::lock_guard<std::mutex> lock(state_mutex_);
+            next_state = next_state_;
+        }
+
+        if (next_state != state_) {
+            // on_exit
+            switch (state_) {
+                default:
+                    break;
+            }
+            // on entry
+            switch (next_state) {
+                case State::kConnecting:
+                    logger.Info() << "Connecting to '" << client_.get_server_uri() << "'... ";
+                    connect_token = client_.connect(connOpts_);
+                    break;
+                case State::kConnected: {
+                    logger.Info() << "Connected";
+
+                    // A resumed session already holds the subscriptions but
+                    // topics may have been added since it was created
+                    if (connect_token->get_connect_response().is_session_present()) {
+                        IOTEA_LOG_DEBUG(logger) << "Resumed session.";
+                    }
+
+                    SubscribeAll();
+
+                    connect_token = nullptr;
+                    reconnect_delay_ = min_reconnect_delay_;
+
+                    connected_ = true;
+                    last_drain_ = std::chrono::steady_clock::now();
+                    drain_budget_ = 0;
+                } break;
+                case State::kDisconnected:
+                    logger.Info() << "Disconnected";
+                    connected_ = false;
+                    ScheduleReconnect();
+                    break;
+                case State::kStopping:
+                    connected_ = false;
+
+                    if (client_.is_connected()) {
+                        logger.Info() << "Disconnecting... ";
+                        disconnect_token = client_.disconnect();
+                    }
+                    break;
+            }
+            state_ = next_state;
+        }
+        switch (state_) {
+            case State::kConnected: {
+                DrainSpool();
+
+                // The state is only checked between batches, a lost
+                // connection is reported by the connection lost handler.
+                auto spooled = spool_.IsOpen() && GetPublishCounters().spooled > 0;
+                HandleMessages(spooled ? 10ms : 100ms);
+            } break;
+            case State::kConnecting: {
+                try {
+                    if (connect_token->wait_for(5s)) {
+                        ChangeState(State::kConnected);
+                    }
+                } catch (const mqtt::exception& e) {
+                    logger.Error() << "Unable to connect to MQTT server '" << client_.get_server_uri()
+                                 << "': " << e.to_string();
+                    ChangeState(State::kDisconnected);
+                }
+            } break;
+            case State::kDisconnected: {
+                auto remaining = reconnect_at_ - std::chrono::steady_clock::now();
+                if (remaining > remaining.zero()) {
+                    // Sleep in slices to notice Stop()
+                    std::this_thread::sleep_for(std::min<std::chrono::steady_clock::duration>(remaining, 100ms));
+                } else {
+                    ChangeState(State::kConnecting);
+                }
+            } break;
+
+            case State::kStopping: {
+                if (disconnect_token) {
+                    IOTEA_LOG_DEBUG(logger) << "Wait up to 5 seconds for disconnect confirmation.";
+                    if (disconnect_token->wait_for(5s)) {
+                        IOTEA_LOG_DEBUG(logger) << "Disconnected successfully.";
+                    } else {
+                        IOTEA_LOG_DEBUG(logger) << "Failed to get disconnect confirmation.";
+                    }
+                }
+                running = false;
+            } break;
+        }
+    }
+}
+
+void MqttConnection::Stop() {
+    ChangeState(State::kStopping);
+}
+
+void MqttConnection::ScheduleReconnect() {
+    // Wait for a random time between half and all of the current delay so
+    // that clients disconnected together do not reconnect together
+    auto half = reconnect_delay_.count() / 2;
+    auto delay = std::chrono::milliseconds{half + std::uniform_int_distribution<int64_t>{0, half}(rng_)};
+
+    IOTEA_LOG_DEBUG(logger) << "Reconnecting in " << delay.count() << "ms.";
+    reconnect_at_ = std::chrono::steady_clock::now() + delay;
+    reconnect_delay_ = std::min(reconnect_delay_ * 2, max_reconnect_delay_);
+}
+
+void MqttConnection::SubscribeAll() {
+    if (topics_.empty()) {
+        return;
+    }
+
+    // Subscribe to all topics with a single SUBSCRIBE packet
+    auto topics = mqtt::string_collection::create(topics_);
+    auto qos = mqtt::iasync_client::qos_collection(topics_.size(), 1);
+
+    try {
+        client_.subscribe(topics, qos);
+    } catch (const mqtt::exception& e) {
+        logger.Error() << "Failed to subscribe: " << e.to_string();
+    }
+}
+
+bool MqttConnection::Publish(const std::string& topic, const std::string& data, int qos, bool retain, bool stash) {
+    if (stash && StashMessage(topic, data, qos, retain, false)) {
+        return true;
+    }
+
+    if (!deliveries_.Acquire()) {
+        IOTEA_LOG_DEBUG(logger) << "Too many messages in flight, rejecting message.";
+        return false;
+    }
+
+    try {
+        // The token is kept by the client until the delivery completes
+        client_.publish(topic, data.data(), data.size(), qos, retain, nullptr, deliveries_);
+    } catch (const mqtt::exception& e) {
+        deliveries_.Release();
+
+        if (stash && StashMessage(topic, data, qos, retain, true)) {
+            return true;
+        }
+
+        deliveries_.Fail();
+        logger.Warn() << "Failed to publish message: " << e.to_string();
+        return false;
+    }
+
+    return true;
+}
+
+size_t MqttConnection::PublishBatch(const std::vector<OutgoingMessage>& messages) {
+    auto slots = deliveries_.AcquireMany(messages.size());
+    size_t accepted = 0;
+    size_t rejected = 0;
+
+    for (const auto& m : messages) {
+        if (m.stash && StashMessage(m.topic, *m.data, m.qos, m.retain, false)) {
+            accepted++;
+            continue;
+        }
+
+        if (slots == 0) {
+            rejected++;
+            continue;
+        }
+
+        try {
+            // The token is kept by the client until the delivery completes
+            client_.publish(m.topic, m.data->data(), m.data->size(), m.qos, m.retain, nullptr, deliveries_);
+            slots--;
+            accepted++;
+        } catch (const mqtt::exception& e) {
+            if (m.stash && StashMessage(m.topic, *m.data, m.qos, m.retain, true)) {
+                accepted++;
+                continue;
+            }
+
+            deliveries_.Fail();
+            logger.Warn() << "Failed to publish message: " << e.to_string();
+        }
+    }
+
+    // Return the slots of the stashed and failed messages
+    deliveries_.Release(slots);
+
+    if (rejected > 0) {
+        IOTEA_LOG_DEBUG(logger) << "Too many messages in flight, rejecting " << rejected << " messages.";
+        deliveries_.Reject(rejected);
+    }
+
+    return accepted;
+}
+
+PublishCounters MqttConnection::GetPublishCounters() const {
+    auto counters = deliveries_.GetCounters();
+
+    if (spool_.IsOpen()) {
+        std::lock_guard<std::mutex> lock{spool_mutex_};
+        counters.spooled = spool_.Count();
+    }
+
+    return counters;
+}
+
+bool MqttConnection::StashMessage(const std::string& topic, const std::string& data, int qos, bool retain, bool force) {
+    if (!spool_.IsOpen()) {
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock{spool_mutex_};
+
+    // Messages are spooled while the spool is drained to keep their order
+    if (!force && connected_ && spool_.Count() == 0) {
+        return false;
+    }
+
+    return spool_.Append(topic, data, qos, retain);
+}
+
+void MqttConnection::DrainSpool() {
+    if (!spool_.IsOpen()) {
+        return;
+    }
+
+    auto now = std::chrono::steady_clock::now();
+    auto elapsed = std::chrono::duration<double>(now - last_drain_).count();
+    last_drain_ = now;
+
+    // Allow bursts of at most 100ms worth of messages
+    drain_budget_ = std::min(drain_budget_ + elapsed * drain_rate_, std::max(drain_rate_ / 10, 1.0));
+
+    std::lock_guard<std::mutex> lock{spool_mutex_};
+
+    while (drain_budget_ >= 1 && spool_.Peek(drain_record_)) {
+        // Leave the messages in the spool while the window is full
+        if (!deliveries_.Acquire(false)) {
+            break;
+        }
+
+        try {
+            client_.publish(drain_record_.topic, drain_record_.payload.data(), drain_record_.payload.size(),
+                            drain_record_.qos, drain_record_.retain, nullptr, deliveries_);
+        } catch (const mqtt::exception& e) {
+            deliveries_.Release();
+            IOTEA_LOG_DEBUG(logger) << "Failed to publish spooled message: " << e.to_string();
+            break;
+        }
+
+        spool_.Pop();
+        drain_budget_--;
+    }
+}
+
+void MqttConnection::Subscribe(const std::string& filter, on_payload_func_ptr on_msg) {
+    topics_.push_back(filter);
+    subscriptions_.Insert(filter, std::move(on_msg));
+}
+
+}  // namespace core
+}  // namespace iotea
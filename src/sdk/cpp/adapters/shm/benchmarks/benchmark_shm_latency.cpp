@@ -0,0 +1,131 @@
+/*****************************************************************************
+ * Copyright (c) 2021 Bosch.IO GmbH
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * SPDX-License-Identifier: MPL-2.0
+ ****************************************************************************/
+
+// Measures the delivery latency of the ShmProtocolAdapter between two
+// processes by bouncing a message back and forth.
+
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "shm_adapter.hpp"
+
+using namespace iotea::core;
+
+static constexpr int ROUNDS = 100000;
+
+// Signals the arrival of a message
+class Arrivals {
+   public:
+    on_payload_func_ptr Callback() {
+        return [this](const std::string&, const payload_ptr&, const std::string&) {
+            std::lock_guard<std::mutex> lock{mutex_};
+            count_++;
+            cv_.notify_one();
+        };
+    }
+
+    bool WaitFor(uint64_t n, std::chrono::milliseconds timeout) {
+        std::unique_lock<std::mutex> lock{mutex_};
+        return cv_.wait_for(lock, timeout, [this, n] { return count_ >= n; });
+    }
+
+   private:
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    uint64_t count_ = 0;
+};
+
+int main() {
+    auto bus = "iotea-benchmark-" + std::to_string(::getpid());
+    auto config = json{{"bus", bus}};
+    const std::string payload(256, 'x');
+
+    auto pid = ::fork();
+    if (pid == 0) {
+        {
+            // Echo every ping
+            ShmProtocolAdapter echo{"echo", false, config};
+            echo.SubscribePayload("ping", [&echo](const std::string&, const payload_ptr& p, const std::string&) {
+                echo.Publish("pong", *p, PublishOptions{false, ""});
+            }, SubscribeOptions{false, ""});
+
+            echo.Subscribe("stop", [&echo](const std::string&, const std::string&, const std::string&) {
+                echo.Stop();
+            }, SubscribeOptions{false, ""});
+
+            echo.Start();
+        }
+
+        ::_exit(0);
+    }
+
+    ShmProtocolAdapter adapter{"benchmark", false, config};
+
+    Arrivals pongs;
+    adapter.SubscribePayload("pong", pongs.Callback(), SubscribeOptions{false, ""});
+
+    std::thread t{[&adapter] { adapter.Start(); }};
+
+    // Wait for the echo process to subscribe
+    uint64_t sent = 0;
+    do {
+        adapter.Publish("ping", payload, PublishOptions{false, ""});
+        sent++;
+    } while (!pongs.WaitFor(1, std::chrono::milliseconds{10}));
+
+    // Drain the pongs of the pings sent while waiting
+    pongs.WaitFor(sent, std::chrono::seconds{1});
+
+    std::vector<double> rtts;
+    rtts.reserve(ROUNDS);
+
+    for (auto i = 0; i < ROUNDS; i++) {
+        auto start = std::chrono::steady_clock::now();
+        adapter.Publish("ping", payload, PublishOptions{false, ""});
+        if (!pongs.WaitFor(sent + 1, std::chrono::seconds{1})) {
+            std::cerr << "Lost a message" << std::endl;
+            break;
+        }
+        sent++;
+        rtts.push_back(std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count());
+    }
+
+    adapter.Publish("stop", "", PublishOptions{false, ""});
+    ::waitpid(pid, nullptr, 0);
+
+    adapter.Stop();
+    t.join();
+
+    // The registry outlives the adapters
+    ::shm_unlink(("/" + bus).c_str());
+
+    if (rtts.empty()) {
+        return 1;
+    }
+
+    std::sort(rtts.begin(), rtts.end());
+    std::cout << "One-way latency of " << payload.size() << " byte messages over " << rtts.size() << " round trips:" << std::endl;
+    std::cout << "  p50: " << rtts[rtts.size() / 2] / 2 << " us" << std::endl;
+    std::cout << "  p99: " << rtts[rtts.size() * 99 / 100] / 2 << " us" << std::endl;
+
+    return 0;
+}
@@ -0,0 +1,142 @@
+/*****************************************************************************
+ * Copyright (c) 2021 Bosch.IO GmbH
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * SPDX-License-Identifier: MPL-2.0
+ ****************************************************************************/
+
+#ifndef SRC_SDK_CPP_ADAPTERS_SHM_SHM_ADAPTER_HPP_
+#define SRC_SDK_CPP_ADAPTERS_SHM_SHM_ADAPTER_HPP_
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "nlohmann/json.hpp"
+
+using json = nlohmann::json;
+
+#include "protocol_gateway.hpp"
+#include "shm_ring.hpp"
+#include "topic_trie.hpp"
+
+namespace iotea {
+namespace core {
+
+extern "C" {
+
+/**
+ * @brief ShmProtocolAdapter exchanges messages with the other processes of a
+ * host through POSIX shared memory instead of a broker. Every adapter owns
+ * an inbox ring; the subscriptions of all adapters on the same bus are kept
+ * in a shared registry. A publisher matches the topic against the registry
+ * and writes the message directly into the inboxes of the subscribers, of
+ * each "$share" group only into the inbox of the next member in turn.
+ * Messages are dropped if an inbox is full and are neither retained nor
+ * persisted.
+ */
+class ShmProtocolAdapter : public Adapter {
+   public:
+    /**
+     * @brief Construct a new ShmProtocolAdapter.
+     *
+     * @param name The name of the adapter
+     * @param is_platform_proto Whether the adapter speaks the platform protocol
+     * @param config The adapter configuration: optionally "bus", the name of
+     * the shared memory objects connecting the adapters (default "iotea"),
+     * "topicNamespace" (default "iotea/"), "inboxSize", the number of bytes
+     * of the inbox (default 4 MiB) and "receiveBatchSize", the maximum
+     * number of messages handled between two checks for Stop() (default 64).
+     */
+    ShmProtocolAdapter(const std::string& name, bool is_platform_proto, const json& config);
+
+    ~ShmProtocolAdapter() override;
+
+    // Adapter
+    void Start() override;
+    void Stop() override;
+    bool Publish(const std::string& topic, const std::string& data, const PublishOptions& opts) override;
+    void Subscribe(const std::string& topic, on_msg_func_ptr on_msg, const SubscribeOptions& opts) override;
+    void SubscribeShared(const std::string& group, const std::string& topic, on_msg_func_ptr on_msg, const SubscribeOptions& opts) override;
+    void SubscribePayload(const std::string& topic, on_payload_func_ptr on_msg, const SubscribeOptions& opts) override;
+    void SubscribeSharedPayload(const std::string& group, const std::string& topic, on_payload_func_ptr on_msg, const SubscribeOptions& opts) override;
+
+   private:
+    struct Registry;
+
+    // A mapped inbox of another (or this) adapter
+    struct Inbox {
+        uint32_t incarnation;
+        void* map;
+        size_t size;
+        ShmRing ring;
+    };
+
+    // A participant as seen when the routes were built
+    struct Peer {
+        uint32_t incarnation;
+        std::string inbox;
+        size_t inbox_size;
+    };
+
+    struct Member {
+        uint32_t participant;
+        uint32_t subscription;
+    };
+
+    // The subscribers of a filter, several for a "$share" group
+    struct Target {
+        std::vector<Member> members;
+        std::atomic<uint32_t>* next;
+    };
+
+    static constexpr uint32_t NO_PARTICIPANT = UINT32_MAX;
+    static constexpr size_t DEFAULT_INBOX_SIZE = 4 * 1024 * 1024;
+    static constexpr size_t DEFAULT_RECEIVE_BATCH_SIZE = 64;
+
+    bool OpenRegistry();
+    bool Register();
+    void Deregister();
+    void AddSubscription(const std::string& filter, on_payload_func_ptr on_msg);
+    void UpdateRoutes();
+    ShmRing* GetInbox(uint32_t participant);
+    void Unmap(Inbox& inbox);
+
+    std::string bus_;
+    std::string topic_ns_;
+    size_t inbox_size_;
+    size_t batch_size_;
+
+    Registry* registry_ = nullptr;
+    uint32_t participant_ = NO_PARTICIPANT;
+    Inbox inbox_{};
+    std::string inbox_name_;
+
+    // Indexed by the number of the subscription in the registry
+    std::vector<on_payload_func_ptr> callbacks_;
+
+    // The routes of the publishers, rebuilt when the registry changes
+    std::mutex publish_mutex_;
+    uint64_t routes_generation_ = UINT64_MAX;
+    TopicTrie<size_t> routes_;
+    std::vector<Target> targets_;
+    std::vector<Peer> peers_;
+    std::vector<std::unique_ptr<Inbox>> peer_inboxes_;
+
+    std::atomic<bool> stopped_{false};
+};
+
+} // extern "C"
+
+}  // namespace core
+}  // namespace iotea
+
+extern "C" std::shared_ptr<iotea::core::Adapter> Load(const std::string& name, bool is_platform_proto, const json& config);
+
+#endif // SRC_SDK_CPP_ADAPTERS_SHM_SHM_ADAPTER_HPP_
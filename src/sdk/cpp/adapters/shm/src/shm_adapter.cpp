@@ -0,0 +1,537 @@
+/*****************************************************************************
+ * Copyright (c) 2021 Bosch.IO GmbH
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * SPDX-License-Identifier: MPL-2.0
+ ****************************************************************************/
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <thread>
+#include <unordered_map>
+
+#include "common.hpp"
+#include "logging.hpp"
+#include "shm_adapter.hpp"
+
+namespace iotea {
+namespace core {
+
+using namespace std::chrono_literals;
+
+static auto logger = iotea::core::logging::NamedLogger{"ShmProtocolAdapter"};
+
+constexpr uint32_t ShmProtocolAdapter::NO_PARTICIPANT;
+constexpr size_t ShmProtocolAdapter::DEFAULT_INBOX_SIZE;
+constexpr size_t ShmProtocolAdapter::DEFAULT_RECEIVE_BATCH_SIZE;
+
+static constexpr char REGISTRY_MAGIC[8] = {'I', 'O', 'T', 'E', 'A', 'R', 'G', '1'};
+
+static constexpr size_t MAX_PARTICIPANTS = 64;
+static constexpr size_t MAX_SUBSCRIPTIONS = 1024;
+static constexpr size_t MAX_FILTER_SIZE = 256;
+static constexpr size_t MAX_INBOX_NAME_SIZE = 64;
+
+// How long to wait for another process to finish creating the registry
+static constexpr auto REGISTRY_INIT_TIMEOUT = 1s;
+
+struct RegistryParticipant {
+    uint32_t used;
+    uint32_t pid;
+    uint32_t incarnation;  // Bumped whenever the slot is taken
+    uint32_t reserved;
+    uint64_t inbox_size;
+    char inbox[MAX_INBOX_NAME_SIZE];
+};
+
+struct RegistrySubscription {
+    uint32_t used;
+    uint32_t participant;
+    std::atomic<uint32_t> next;  // The member of a share to deliver to next
+    uint32_t reserved;
+    char filter[MAX_FILTER_SIZE];
+};
+
+// The registry lists the adapters on a bus and their subscriptions. It is
+// only changed while holding the mutex; generation is bumped by every change
+// so that publishers know when to rebuild their routes.
+struct ShmProtocolAdapter::Registry {
+    char magic[8];
+    std::atomic<uint32_t> ready;
+    uint32_t reserved;
+    pthread_mutex_t mutex;
+    std::atomic<uint64_t> generation;
+    RegistryParticipant participants[MAX_PARTICIPANTS];
+    RegistrySubscription subscriptions[MAX_SUBSCRIPTIONS];
+};
+
+// Holds the registry mutex, recovering it from a process that died with it
+class RegistryLock {
+   public:
+    explicit RegistryLock(pthread_mutex_t* mutex)
+        : mutex_{mutex} {
+        if (pthread_mutex_lock(mutex_) == EOWNERDEAD) {
+            // Entries are written before they are marked as used, a
+            // partially written entry is never seen
+            pthread_mutex_consistent(mutex_);
+        }
+    }
+
+    ~RegistryLock() { pthread_mutex_unlock(mutex_); }
+
+    RegistryLock(const RegistryLock&) = delete;
+    RegistryLock& operator=(const RegistryLock&) = delete;
+
+   private:
+    pthread_mutex_t* mutex_;
+};
+
+// Map a shared memory object, creating it with the given size if requested.
+// Fails quietly if the object to create exists already.
+static void* MapShared(const std::string& name, size_t size, bool create) {
+    auto fd = ::shm_open(name.c_str(), O_RDWR | (create ? O_CREAT | O_EXCL : 0), 0600);
+    if (fd < 0) {
+        if (!create || errno != EEXIST) {
+            logger.Error() << "Failed to open '" << name << "': " << std::strerror(errno);
+        }
+        return nullptr;
+    }
+
+    if (create && ::ftruncate(fd, static_cast<off_t>(size)) != 0) {
+        logger.Error() << "Failed to resize '" << name << "': " << std::strerror(errno);
+        ::close(fd);
+        return nullptr;
+    }
+
+    struct stat st;
+    if (::fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < size) {
+        ::close(fd);
+        return nullptr;
+    }
+
+    auto map = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+
+    if (map == MAP_FAILED) {
+        logger.Error() << "Failed to map '" << name << "': " << std::strerror(errno);
+        return nullptr;
+    }
+
+    return map;
+}
+
+static bool IsAlive(uint32_t pid) {
+    return ::kill(static_cast<pid_t>(pid), 0) == 0 || errno != ESRCH;
+}
+
+extern "C" {
+
+ShmProtocolAdapter::ShmProtocolAdapter(const std::string& name, bool is_platform_proto, const json& config)
+    : Adapter{name, is_platform_proto}
+    , bus_{config.value("bus", std::string{MQTT_TOPIC_NS})}
+    , topic_ns_{config.value("topicNamespace", std::string{MQTT_TOPIC_NS} + "/")}
+    , inbox_size_{config.value("inboxSize", DEFAULT_INBOX_SIZE)}
+    , batch_size_{std::max<size_t>(config.value("receiveBatchSize", DEFAULT_RECEIVE_BATCH_SIZE), 1)}
+    , callbacks_(MAX_SUBSCRIPTIONS)
+    , peer_inboxes_(MAX_PARTICIPANTS) {
+
+    // Shared memory objects are named "/<name>" without further slashes
+    std::replace(bus_.begin(), bus_.end(), '/', '_');
+
+    if (!OpenRegistry() || !Register()) {
+        logger.Error() << "Adapter '" << name_ << "' is not connected to bus '" << bus_ << "'.";
+    }
+}
+
+ShmProtocolAdapter::~ShmProtocolAdapter() {
+    Deregister();
+
+    for (auto& inbox : peer_inboxes_) {
+        if (inbox) {
+            Unmap(*inbox);
+        }
+    }
+
+    if (registry_ != nullptr) {
+        ::munmap(registry_, sizeof(Registry));
+    }
+}
+
+bool ShmProtocolAdapter::OpenRegistry() {
+    auto name = "/" + bus_;
+
+    auto map = MapShared(name, sizeof(Registry), true);
+    if (map != nullptr) {
+        registry_ = static_cast<Registry*>(map);
+
+        pthread_mutexattr_t attr;
+        pthread_mutexattr_init(&attr);
+        pthread_mutexattr_setpshared(&attr, PTHREAD_PROCESS_SHARED);
+        pthread_mutexattr_setrobust(&attr, PTHREAD_MUTEX_ROBUST);
+        pthread_mutex_init(&registry_->mutex, &attr);
+        pthread_mutexattr_destroy(&attr);
+
+        std::memcpy(registry_->magic, REGISTRY_MAGIC, sizeof(REGISTRY_MAGIC));
+        registry_->ready.store(1, std::memory_order_release);
+
+        return true;
+    }
+
+    // Another process created the registry, wait until it is initialized
+    auto deadline = std::chrono::steady_clock::now() + REGISTRY_INIT_TIMEOUT;
+
+    while (std::chrono::steady_clock::now() < deadline) {
+        if (registry_ == nullptr) {
+            registry_ = static_cast<Registry*>(MapShared(name, sizeof(Registry), false));
+        }
+
+        if (registry_ != nullptr && registry_->ready.load(std::memory_order_acquire) != 0) {
+            if (std::memcmp(registry_->magic, REGISTRY_MAGIC, sizeof(REGISTRY_MAGIC)) == 0) {
+                return true;
+            }
+
+            logger.Error() << "'" << name << "' is not a registry.";
+            break;
+        }
+
+        std::this_thread::sleep_for(1ms);
+    }
+
+    if (registry_ != nullptr) {
+        ::munmap(registry_, sizeof(Registry));
+        registry_ = nullptr;
+    }
+
+    return false;
+}
+
+bool ShmProtocolAdapter::Register() {
+    RegistryLock lock{&registry_->mutex};
+
+    // Release the entries of processes that died without deregistering
+    for (uint32_t p = 0; p < MAX_PARTICIPANTS; p++) {
+        auto& entry = registry_->participants[p];
+        if (entry.used == 0 || IsAlive(entry.pid)) {
+            continue;
+        }
+
+        logger.Info() << "Releasing participant " << p << " of dead process " << entry.pid << ".";
+        ::shm_unlink(entry.inbox);
+        entry.used = 0;
+
+        for (auto& s : registry_->subscriptions) {
+            if (s.used != 0 && s.participant == p) {
+                s.used = 0;
+            }
+        }
+
+        registry_->generation++;
+    }
+
+    auto slot = std::find_if(std::begin(registry_->participants), std::end(registry_->participants),
+                             [](const RegistryParticipant& p) { return p.used == 0; });
+
+    if (slot == std::end(registry_->participants)) {
+        logger.Error() << "Bus '" << bus_ << "' has no room for another participant.";
+        return false;
+    }
+
+    auto p = static_cast<uint32_t>(slot - std::begin(registry_->participants));
+    auto incarnation = slot->incarnation + 1;
+
+    inbox_name_ = "/" + bus_ + "." + std::to_string(p) + "." + std::to_string(incarnation);
+    if (inbox_name_.size() >= MAX_INBOX_NAME_SIZE) {
+        logger.Error() << "Bus name '" << bus_ << "' is too long.";
+        return false;
+    }
+
+    auto size = ShmRing::Size(inbox_size_);
+
+    ::shm_unlink(inbox_name_.c_str());
+    inbox_.map = MapShared(inbox_name_, size, true);
+    if (inbox_.map == nullptr) {
+        return false;
+    }
+
+    inbox_.size = size;
+    inbox_.incarnation = incarnation;
+
+    if (!inbox_.ring.Create(inbox_.map, size)) {
+        Unmap(inbox_);
+        ::shm_unlink(inbox_name_.c_str());
+        return false;
+    }
+
+    slot->pid = static_cast<uint32_t>(::getpid());
+    slot->incarnation = incarnation;
+    slot->inbox_size = size;
+    std::strncpy(slot->inbox, inbox_name_.c_str(), MAX_INBOX_NAME_SIZE - 1);
+    slot->inbox[MAX_INBOX_NAME_SIZE - 1] = '\0';
+    slot->used = 1;
+
+    registry_->generation++;
+
+    participant_ = p;
+    return true;
+}
+
+void ShmProtocolAdapter::Deregister() {
+    if (participant_ == NO_PARTICIPANT) {
+        return;
+    }
+
+    {
+        RegistryLock lock{&registry_->mutex};
+
+        for (auto& s : registry_->subscriptions) {
+            if (s.used != 0 && s.participant == participant_) {
+                s.used = 0;
+            }
+        }
+
+        registry_->participants[participant_].used = 0;
+        registry_->generation++;
+    }
+
+    Unmap(inbox_);
+    ::shm_unlink(inbox_name_.c_str());
+    participant_ = NO_PARTICIPANT;
+}
+
+void ShmProtocolAdapter::Unmap(Inbox& inbox) {
+    if (inbox.map != nullptr) {
+        ::munmap(inbox.map, inbox.size);
+        inbox.map = nullptr;
+    }
+}
+
+void ShmProtocolAdapter::Start() {
+    if (participant_ == NO_PARTICIPANT) {
+        return;
+    }
+
+    uint32_t tag;
+    std::string topic;
+
+    while (!stopped_.load()) {
+        if (!inbox_.ring.Wait(100ms)) {
+            continue;
+        }
+
+        for (size_t i = 0; i < batch_size_; i++) {
+            // The payload is copied out of the ring once, into the string
+            // handed to the subscriber
+            auto payload = std::make_shared<std::string>();
+            if (!inbox_.ring.Pop(tag, topic, *payload)) {
+                break;
+            }
+
+            if (tag < callbacks_.size() && callbacks_[tag]) {
+                callbacks_[tag](topic, payload, name_);
+            }
+        }
+    }
+
+    stopped_ = false;
+}
+
+void ShmProtocolAdapter::Stop() {
+    stopped_ = true;
+
+    if (participant_ != NO_PARTICIPANT) {
+        inbox_.ring.Wake();
+    }
+}
+
+void ShmProtocolAdapter::UpdateRoutes() {
+    if (registry_->generation.load(std::memory_order_acquire) == routes_generation_) {
+        return;
+    }
+
+    RegistryLock lock{&registry_->mutex};
+
+    routes_ = TopicTrie<size_t>{};
+    targets_.clear();
+    peers_.assign(MAX_PARTICIPANTS, Peer{0, std::string{}, 0});
+
+    for (uint32_t p = 0; p < MAX_PARTICIPANTS; p++) {
+        const auto& entry = registry_->participants[p];
+        if (entry.used != 0) {
+            peers_[p] = Peer{entry.incarnation, entry.inbox, entry.inbox_size};
+        }
+    }
+
+    // The members of a share are collected in a single target
+    std::unordered_map<std::string, size_t> shares;
+
+    for (uint32_t s = 0; s < MAX_SUBSCRIPTIONS; s++) {
+        auto& entry = registry_->subscriptions[s];
+        if (entry.used == 0 || registry_->participants[entry.participant].used == 0) {
+            continue;
+        }
+
+        std::string filter{entry.filter};
+        auto member = Member{entry.participant, s};
+
+        if (filter.compare(0, 7, "$share/") == 0) {
+            auto it = shares.find(filter);
+            if (it != shares.end()) {
+                targets_[it->second].members.push_back(member);
+                continue;
+            }
+
+            shares.emplace(filter, targets_.size());
+        }
+
+        routes_.Insert(filter, targets_.size());
+        targets_.push_back(Target{{member}, &entry.next});
+    }
+
+    routes_generation_ = registry_->generation.load();
+}
+
+ShmRing* ShmProtocolAdapter::GetInbox(uint32_t participant) {
+    const auto& peer = peers_[participant];
+    auto& inbox = peer_inboxes_[participant];
+
+    if (inbox && inbox->incarnation == peer.incarnation) {
+        return &inbox->ring;
+    }
+
+    if (inbox) {
+        Unmap(*inbox);
+    } else {
+        inbox = std::make_unique<Inbox>();
+    }
+
+    inbox->incarnation = peer.incarnation;
+    inbox->size = peer.inbox_size;
+    inbox->map = MapShared(peer.inbox, peer.inbox_size, false);
+
+    if (inbox->map == nullptr || !inbox->ring.Attach(inbox->map, inbox->size)) {
+        Unmap(*inbox);
+        inbox.reset();
+        return nullptr;
+    }
+
+    return &inbox->ring;
+}
+
+bool ShmProtocolAdapter::Publish(const std::string& topic, const std::string& data, const PublishOptions&) {
+    if (registry_ == nullptr) {
+        return false;
+    }
+
+    auto full_topic = topic_ns_ + topic;
+
+    IOTEA_LOG_DEBUG(logger) << "Publishing message.";
+    IOTEA_LOG_DEBUG(logger) << "\ttopic: '" << full_topic << "'";
+    IOTEA_LOG_DEBUG(logger) << "\tpayload: '" << data << "'";
+
+    std::lock_guard<std::mutex> lock{publish_mutex_};
+
+    UpdateRoutes();
+
+    auto delivered = true;
+
+    routes_.Match(full_topic, [&](size_t t) {
+        const auto& target = targets_[t];
+        auto n = target.members.size();
+
+        // Members of a share take turns, skipping those whose inbox is gone
+        // or full
+        for (size_t i = 0; i < n; i++) {
+            const auto& m = n == 1 ? target.members[0] : target.members[target.next->fetch_add(1) % n];
+
+            auto ring = GetInbox(m.participant);
+            if (ring != nullptr && ring->Push(m.subscription, full_topic, data.data(), data.size())) {
+                return;
+            }
+        }
+
+        delivered = false;
+    });
+
+    return delivered;
+}
+
+void ShmProtocolAdapter::AddSubscription(const std::string& filter, on_payload_func_ptr on_msg) {
+    if (participant_ == NO_PARTICIPANT) {
+        return;
+    }
+
+    if (filter.size() >= MAX_FILTER_SIZE) {
+        logger.Error() << "Topic filter '" << filter << "' is too long.";
+        return;
+    }
+
+    RegistryLock lock{&registry_->mutex};
+
+    auto slot = std::find_if(std::begin(registry_->subscriptions), std::end(registry_->subscriptions),
+                             [](const RegistrySubscription& s) { return s.used == 0; });
+
+    if (slot == std::end(registry_->subscriptions)) {
+        logger.Error() << "Bus '" << bus_ << "' has no room for another subscription.";
+        return;
+    }
+
+    // Set before the subscription becomes visible to publishers
+    callbacks_[static_cast<size_t>(slot - std::begin(registry_->subscriptions))] = std::move(on_msg);
+
+    slot->participant = participant_;
+    slot->next.store(0);
+    std::strncpy(slot->filter, filter.c_str(), MAX_FILTER_SIZE - 1);
+    slot->filter[MAX_FILTER_SIZE - 1] = '\0';
+    slot->used = 1;
+
+    registry_->generation++;
+}
+
+void ShmProtocolAdapter::Subscribe(const std::string& topic, on_msg_func_ptr on_msg, const SubscribeOptions& opts) {
+    SubscribePayload(topic, [on_msg](const std::string& t, const payload_ptr& m, const std::string& a) {
+        on_msg(t, *m, a);
+    }, opts);
+}
+
+void ShmProtocolAdapter::SubscribeShared(const std::string& group, const std::string& topic, on_msg_func_ptr on_msg, const SubscribeOptions& opts) {
+    SubscribeSharedPayload(group, topic, [on_msg](const std::string& t, const payload_ptr& m, const std::string& a) {
+        on_msg(t, *m, a);
+    }, opts);
+}
+
+void ShmProtocolAdapter::SubscribePayload(const std::string& topic, on_payload_func_ptr on_msg, const SubscribeOptions&) {
+    auto topic_with_ns = topic_ns_ + topic;
+
+    IOTEA_LOG_DEBUG(logger) << "Subscribing to " << topic_with_ns;
+    AddSubscription(topic_with_ns, std::move(on_msg));
+}
+
+void ShmProtocolAdapter::SubscribeSharedPayload(const std::string& group, const std::string& topic, on_payload_func_ptr on_msg, const SubscribeOptions&) {
+    auto shared_topic = std::string{"$share"} + "/" + group + "/" + topic_ns_ + topic;
+
+    IOTEA_LOG_DEBUG(logger) << "Subscribing to " << shared_topic;
+    AddSubscription(shared_topic, std::move(on_msg));
+}
+
+} // extern "C"
+
+}  // namespace core
+}  // namespace iotea
+
+extern "C" std::shared_ptr<iotea::core::Adapter> Load(const std::string& name, bool is_platform_proto, const json& config) {
+    return std::make_shared<iotea::core::ShmProtocolAdapter>(name, is_platform_proto, config);
+}
@@ -0,0 +1,56 @@
+/*****************************************************************************
+ * Copyright (c) 2021 Bosch.IO GmbH
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * SPDX-License-Identifier: MPL-2.0
+ ****************************************************************************/
+
+#ifndef SRC_SDK_CPP_LIB_BENCHMARKS_BENCHMARK_HPP_
+#define SRC_SDK_CPP_LIB_BENCHMARKS_BENCHMARK_HPP_
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <string>
+
+namespace iotea {
+namespace benchmark {
+
+/**
+ * @brief Run func iterations times and print the time per iteration and the
+ * number of iterations per second.
+ *
+ * @return double The number of iterations per second
+ */
+inline double Measure(const std::string& name, uint64_t iterations, const std::function<void(uint64_t)>& func) {
+    auto start = std::chrono::steady_clock::now();
+    for (uint64_t i = 0; i < iterations; i++) {
+        func(i);
+    }
+    auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    auto per_second = iterations / elapsed;
+    std::cout << std::left << std::setw(40) << name
+              << std::right << std::setw(12) << std::fixed << std::setprecision(1) << (elapsed * 1e9 / iterations) << " ns/op"
+              << std::setw(16) << std::setprecision(0) << per_second << " op/s" << std::endl;
+
+    return per_second;
+}
+
+/**
+ * @brief Prevent the compiler from optimizing away a computed value.
+ */
+template <typename T>
+inline void DoNotOptimize(const T& value) {
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+}  // namespace benchmark
+}  // namespace iotea
+
+#endif // SRC_SDK_CPP_LIB_BENCHMARKS_BENCHMARK_HPP_
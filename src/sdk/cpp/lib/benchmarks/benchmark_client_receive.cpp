@@ -0,0 +1,105 @@
+/*****************************************************************************
+ * Copyright (c) 2021 Bosch.IO GmbH
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * SPDX-License-Identifier: MPL-2.0
+ ****************************************************************************/
+
+// Measures the number of events per second that Client::Receive delivers to
+// a talent at INFO level, and the cost of a disabled DEBUG statement with
+// and without the level-gated logging macros.
+
+#include <iostream>
+#include <memory>
+#include <string>
+
+#include "benchmark.hpp"
+#include "client.hpp"
+#include "interface.hpp"
+#include "logging.hpp"
+#include "protocol_gateway.hpp"
+
+using iotea::benchmark::DoNotOptimize;
+using iotea::benchmark::Measure;
+using namespace iotea::core;
+
+static auto logger = logging::NamedLogger{"Benchmark"};
+
+// A gateway without adapters, events are fed to the client directly
+class BenchmarkGateway : public ProtocolGateway {
+   public:
+    BenchmarkGateway()
+        : ProtocolGateway{std::string{"benchmark"}, false} {}
+};
+
+class CountingTalent : public Talent {
+   public:
+    CountingTalent()
+        : Talent{"counting-talent"} {}
+
+    void OnEvent(event_ptr event, event_ctx_ptr) override {
+        DoNotOptimize(event);
+        count_++;
+    }
+
+    uint64_t GetCount() const { return count_; }
+
+   private:
+    uint64_t count_ = 0;
+};
+
+int main(int argc, char** argv) {
+    uint64_t iterations = argc > 1 ? std::stoull(argv[1]) : 200000;
+
+    logging::SetLevel(logging::Level::INFO);
+
+    const std::string topic = "iotea/talent/counting-talent/events";
+    const std::string payload = R"({
+        "msgType": 1,
+        "subject": "someuser",
+        "feature": "speed",
+        "value": 42,
+        "$features": {},
+        "type": "Vehicle",
+        "instance": "4711",
+        "returnTopic": "iotea/ingestion/events",
+        "whenMs": 1620000000000
+    })";
+
+    std::cout << "Logging " << iterations << " disabled DEBUG statements" << std::endl;
+
+    auto ungated_rate = Measure("logger.Debug() << ...", iterations, [&](uint64_t) {
+        logger.Debug() << "\tpayload: " << payload;
+    });
+
+    auto gated_rate = Measure("IOTEA_LOG_DEBUG(logger) << ...", iterations, [&](uint64_t) {
+        IOTEA_LOG_DEBUG(logger) << "\tpayload: " << payload;
+    });
+
+    std::cout << "Speedup: " << gated_rate / ungated_rate << "x" << std::endl;
+
+    auto gateway = std::make_shared<BenchmarkGateway>();
+    Client client{gateway};
+
+    auto talent = std::make_shared<CountingTalent>();
+    client.RegisterTalent(talent);
+
+    std::cout << "Receiving " << iterations << " events at INFO level" << std::endl;
+
+    // The gateway delivers messages through the Receiver interface
+    Receiver& receiver = client;
+
+    Measure("Client::Receive", iterations, [&](uint64_t) {
+        receiver.Receive(topic, payload, "");
+    });
+
+    if (talent->GetCount() != iterations) {
+        std::cerr << "Expected " << iterations << " events, got " << talent->GetCount() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,82 @@
+/*****************************************************************************
+ * Copyright (c) 2021 Bosch.IO GmbH
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * SPDX-License-Identifier: MPL-2.0
+ ****************************************************************************/
+
+// Compares the generation of call IDs by constructing a random engine and
+// formatting through a std::stringstream per ID (as previously done by
+// Uuid4) to the thread local generators in id_generator.hpp.
+
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+
+#include "benchmark.hpp"
+#include "id_generator.hpp"
+#include "util.hpp"
+
+using iotea::benchmark::DoNotOptimize;
+using iotea::benchmark::Measure;
+
+static std::string LegacyUUID() {
+    std::random_device rd;
+    std::mt19937 gen(rd());
+    std::uniform_int_distribution<> dist(0, 255);
+
+    uint8_t bits[16];
+    for (int i = 0; i < 16; i++) {
+        bits[i] = dist(gen);
+    }
+
+    bits[6] = (bits[6] & 0x0f) | 0x40;
+    bits[8] = (bits[8] & 0x3f) | 0x80;
+
+    static constexpr char chars[] = "0123456789abcdef";
+    static constexpr int dash_indices[] = {4, 6, 8, 10};
+    const int* didx = dash_indices;
+
+    std::stringstream ss;
+    for (int i = 0; i < 16; i++) {
+        if (i == *didx) {
+            ss << "-";
+            didx++;
+        }
+
+        ss << chars[bits[i] >> 4] << chars[bits[i] & 0x0f];
+    }
+
+    return ss.str();
+}
+
+int main(int argc, char** argv) {
+    uint64_t iterations = argc > 1 ? std::stoull(argv[1]) : 200000;
+
+    std::cout << "Generating " << iterations << " IDs" << std::endl;
+
+    auto legacy_rate = Measure("Legacy Uuid4", iterations, [](uint64_t) {
+        DoNotOptimize(LegacyUUID());
+    });
+
+    Measure("Uuid4", iterations, [](uint64_t) {
+        DoNotOptimize(std::string(iotea::core::Uuid4()));
+    });
+
+    auto uuid_rate = Measure("GenerateUUID4", iterations, [](uint64_t) {
+        DoNotOptimize(iotea::core::GenerateUUID4());
+    });
+
+    auto compact_rate = Measure("GenerateCompactId", iterations, [](uint64_t) {
+        DoNotOptimize(iotea::core::GenerateCompactId());
+    });
+
+    std::cout << "Speedup GenerateUUID4: " << uuid_rate / legacy_rate << "x" << std::endl;
+    std::cout << "Speedup GenerateCompactId: " << compact_rate / legacy_rate << "x" << std::endl;
+
+    return 0;
+}
@@ -0,0 +1,63 @@
+/*****************************************************************************
+ * Copyright (c) 2021 Bosch.IO GmbH
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * SPDX-License-Identifier: MPL-2.0
+ ****************************************************************************/
+
+// Measures the number of messages per second that the LoopbackAdapter
+// delivers from a publishing to a subscribing adapter, i.e. between two
+// talents in the same process without a broker.
+
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+
+#include "benchmark.hpp"
+#include "loopback_adapter.hpp"
+
+using iotea::benchmark::Measure;
+using namespace iotea::core;
+
+int main(int argc, char** argv) {
+    uint64_t iterations = argc > 1 ? std::stoull(argv[1]) : 1000000;
+
+    auto config = json{{"bus", "benchmark"}};
+    auto publisher = std::make_shared<LoopbackAdapter>("publisher", false, config);
+    auto subscriber = std::make_shared<LoopbackAdapter>("subscriber", false, config);
+
+    std::atomic<uint64_t> received{0};
+    subscriber->SubscribeSharedPayload("group", "talent/+/events", [&received](const std::string&, const payload_ptr&, const std::string&) {
+        received++;
+    }, SubscribeOptions{false, ""});
+
+    std::thread t{[subscriber] { subscriber->Start(); }};
+
+    const std::string payload(512, 'x');
+
+    std::cout << "Publishing " << iterations << " messages of " << payload.size() << " bytes" << std::endl;
+
+    auto start = std::chrono::steady_clock::now();
+
+    Measure("LoopbackAdapter::Publish", iterations, [&](uint64_t) {
+        publisher->Publish("talent/counting-talent/events", payload, PublishOptions{false, ""});
+    });
+
+    while (received.load() < iterations) {
+        std::this_thread::yield();
+    }
+
+    auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "Delivered " << static_cast<uint64_t>(iterations / elapsed) << " msg/s" << std::endl;
+
+    subscriber->Stop();
+    t.join();
+
+    return 0;
+}
@@ -0,0 +1,91 @@
+/*****************************************************************************
+ * Copyright (c) 2021 Bosch.IO GmbH
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * SPDX-License-Identifier: MPL-2.0
+ ****************************************************************************/
+
+// Compares the classification of incoming topics with std::regex (as
+// previously done by Client::Receive) to the TopicRouter.
+
+#include <iostream>
+#include <regex>
+#include <string>
+#include <vector>
+
+#include "benchmark.hpp"
+#include "topic_router.hpp"
+
+using iotea::benchmark::DoNotOptimize;
+using iotea::benchmark::Measure;
+using iotea::core::TopicRouter;
+
+static constexpr char TALENTS_DISCOVERY_TOPIC[] = R"(configManager/talents/discover)";
+static constexpr char PLATFORM_EVENTS_TOPIC[] = R"(platform/$events)";
+
+static int ClassifyRegex(const std::string& topic, std::string& talent_id, std::string& channel_id, std::string& call_id) {
+    static const auto event_expr = std::regex{R"(.*/talent/([^/]+)/events$)"};
+    static const auto call_expr = std::regex{R"(.*/talent/[^/]+/events/([^\.]+)\.([^/]+)/(.+)$)"};
+
+    std::cmatch m;
+
+    if (std::regex_match(topic.c_str(), m, event_expr)) {
+        talent_id = m[1];
+        return 1;
+    }
+
+    if (std::regex_match(topic.c_str(), m, call_expr)) {
+        talent_id = m[1];
+        channel_id = m[2];
+        call_id = m[3];
+        return 2;
+    }
+
+    if (topic.find(TALENTS_DISCOVERY_TOPIC) != std::string::npos) {
+        return 3;
+    }
+
+    if (topic.find(PLATFORM_EVENTS_TOPIC) != std::string::npos) {
+        return 4;
+    }
+
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    uint64_t iterations = argc > 1 ? std::stoull(argv[1]) : 1000000;
+
+    const std::string channel_id = "vehicle-speed-talent.3f9c2b6e-8d41-4a7f-9e15-b0c2d7a4e613";
+
+    TopicRouter router;
+    router.AddTalent("vehicle-speed-talent", channel_id);
+
+    const std::vector<std::string> topics{
+        "iotea/talent/vehicle-speed-talent/events",
+        "iotea/talent/vehicle-speed-talent/events/" + channel_id + "/6a1d2f80-5c3b-4e9a-8f27-1b4c9d0e3a57",
+        "iotea/talent/vehicle-speed-talent/events",
+        "iotea/configManager/talents/discover",
+        "iotea/talent/vehicle-speed-talent/events",
+        "iotea/platform/$events",
+    };
+
+    std::cout << "Classifying " << iterations << " topics" << std::endl;
+
+    auto regex_rate = Measure("std::regex", iterations, [&topics](uint64_t i) {
+        std::string talent_id, channel_id, call_id;
+        DoNotOptimize(ClassifyRegex(topics[i % topics.size()], talent_id, channel_id, call_id));
+        DoNotOptimize(talent_id);
+    });
+
+    auto router_rate = Measure("TopicRouter", iterations, [&topics, &router](uint64_t i) {
+        auto route = router.Resolve(topics[i % topics.size()]);
+        DoNotOptimize(route);
+    });
+
+    std::cout << "Speedup: " << router_rate / regex_rate << "x" << std::endl;
+
+    return 0;
+}
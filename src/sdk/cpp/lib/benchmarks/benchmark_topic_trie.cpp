@@ -0,0 +1,105 @@
+/*****************************************************************************
+ * Copyright (c) 2021 Bosch.IO GmbH
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * SPDX-License-Identifier: MPL-2.0
+ ****************************************************************************/
+
+// Compares dispatching incoming topics to subscriptions by testing one
+// std::regex per subscription (as previously done by MqttProtocolAdapter) to
+// the TopicTrie.
+
+#include <iostream>
+#include <regex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "benchmark.hpp"
+#include "topic_trie.hpp"
+
+using iotea::benchmark::DoNotOptimize;
+using iotea::benchmark::Measure;
+using iotea::core::TopicTrie;
+
+// The previous TopicExprMatcher
+static std::regex ToRegex(std::string expr) {
+    auto replace_all = [&expr](const std::string& what, const std::string& with) {
+        for (auto p = expr.find(what); p != std::string::npos; p = expr.find(what, p + with.size())) {
+            expr.replace(p, what.size(), with);
+        }
+    };
+
+    replace_all("$", R"(\$)");
+    replace_all(".", R"(\.)");
+    replace_all("+", R"([^/]+)");
+
+    if (expr.back() == '#') {
+        expr.replace(expr.size() - 1, 1, ".*");
+    }
+
+    return std::regex{expr};
+}
+
+int main(int argc, char** argv) {
+    uint64_t iterations = argc > 1 ? std::stoull(argv[1]) : 20000;
+    size_t talents = argc > 2 ? std::stoull(argv[2]) : 200;
+
+    // The subscriptions of a client hosting the given number of talents
+    std::vector<std::string> filters{
+        "iotea/configManager/talents/discover",
+        "iotea/platform/$events",
+    };
+
+    for (size_t i = 0; i < talents; i++) {
+        auto talent_id = "talent-" + std::to_string(i);
+        filters.push_back("$share/" + talent_id + "/iotea/talent/" + talent_id + "/events");
+        filters.push_back("iotea/talent/" + talent_id + "/events/" + talent_id + ".channel/+");
+    }
+
+    std::vector<std::pair<std::regex, int>> matchers;
+    TopicTrie<int> trie;
+
+    for (size_t i = 0; i < filters.size(); i++) {
+        auto filter = filters[i];
+        if (filter.compare(0, 7, "$share/") == 0) {
+            filter = filter.substr(filter.find('/', 7) + 1);
+        }
+
+        matchers.emplace_back(ToRegex(filter), static_cast<int>(i));
+        trie.Insert(filters[i], static_cast<int>(i));
+    }
+
+    const std::vector<std::string> topics{
+        "iotea/talent/talent-7/events",
+        "iotea/talent/talent-42/events/talent-42.channel/6a1d2f80-5c3b-4e9a-8f27-1b4c9d0e3a57",
+        "iotea/configManager/talents/discover",
+        "iotea/platform/$events",
+    };
+
+    std::cout << "Matching " << iterations << " topics against " << filters.size() << " subscriptions" << std::endl;
+
+    auto regex_rate = Measure("std::regex per subscription", iterations, [&](uint64_t i) {
+        const auto& topic = topics[i % topics.size()];
+        int sum = 0;
+        for (const auto& m : matchers) {
+            if (std::regex_match(topic.c_str(), m.first)) {
+                sum += m.second;
+            }
+        }
+        DoNotOptimize(sum);
+    });
+
+    auto trie_rate = Measure("TopicTrie", iterations, [&](uint64_t i) {
+        int sum = 0;
+        trie.Match(topics[i % topics.size()], [&sum](int v) { sum += v; });
+        DoNotOptimize(sum);
+    });
+
+    std::cout << "Speedup: " << trie_rate / regex_rate << "x" << std::endl;
+
+    return 0;
+}
@@ -0,0 +1,111 @@
+/*****************************************************************************
+ * Copyright (c) 2021 Bosch.IO GmbH
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * SPDX-License-Identifier: MPL-2.0
+ ****************************************************************************/
+
+#ifndef SRC_SDK_CPP_LIB_INCLUDE_BATCH_QUEUE_HPP_
+#define SRC_SDK_CPP_LIB_INCLUDE_BATCH_QUEUE_HPP_
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <iterator>
+#include <mutex>
+#include <vector>
+
+namespace iotea {
+namespace core {
+
+/**
+ * @brief BatchQueue hands items from producer threads (e.g. the MQTT
+ * client's message arrived callback) to a consumer thread in batches. The
+ * consumer takes a whole batch under a single lock.
+ *
+ * @tparam T The type of the items
+ */
+template <typename T>
+class BatchQueue {
+   public:
+    /**
+     * @brief Append an item and wake the consumer.
+     *
+     * @param item The item
+     */
+    void Push(T item) {
+        bool was_empty;
+        {
+            std::lock_guard<std::mutex> lock{mutex_};
+            was_empty = items_.empty();
+            items_.push_back(std::move(item));
+        }
+
+        // The consumer only waits on an empty queue
+        if (was_empty) {
+            cv_.notify_one();
+        }
+    }
+
+    /**
+     * @brief Move up to max_items items to the end of batch. Waits up to
+     * timeout for the first item unless woken by Wake().
+     *
+     * @param batch The vector to append the items to
+     * @param max_items The maximum number of items to take
+     * @param timeout The maximum time to wait if the queue is empty
+     * @return size_t The number of items taken
+     */
+    template <typename Rep, typename Period>
+    size_t PopBatch(std::vector<T>& batch, size_t max_items, const std::chrono::duration<Rep, Period>& timeout) {
+        std::unique_lock<std::mutex> lock{mutex_};
+
+        if (items_.empty() && !woken_) {
+            cv_.wait_for(lock, timeout, [this] { return !items_.empty() || woken_; });
+        }
+
+        woken_ = false;
+
+        auto n = std::min(max_items, items_.size());
+        auto end = items_.begin() + static_cast<std::ptrdiff_t>(n);
+        std::move(items_.begin(), end, std::back_inserter(batch));
+        items_.erase(items_.begin(), end);
+
+        return n;
+    }
+
+    /**
+     * @brief Make a waiting (or the next) PopBatch() return immediately.
+     */
+    void Wake() {
+        {
+            std::lock_guard<std::mutex> lock{mutex_};
+            woken_ = true;
+        }
+
+        cv_.notify_one();
+    }
+
+    /**
+     * @brief Remove all items.
+     */
+    void Clear() {
+        std::lock_guard<std::mutex> lock{mutex_};
+        items_.clear();
+    }
+
+   private:
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::deque<T> items_;
+    bool woken_ = false;
+};
+
+}  // namespace core
+}  // namespace iotea
+
+#endif // SRC_SDK_CPP_LIB_INCLUDE_BATCH_QUEUE_HPP_
@@ -0,0 +1,171 @@
+/*****************************************************************************
+ * Copyright (c) 2021 Bosch.IO GmbH
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * SPDX-License-Identifier: MPL-2.0
+ ****************************************************************************/
+
+#ifndef SRC_SDK_CPP_LIB_INCLUDE_BOUNDED_QUEUE_HPP_
+#define SRC_SDK_CPP_LIB_INCLUDE_BOUNDED_QUEUE_HPP_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <utility>
+
+namespace iotea {
+namespace core {
+
+/**
+ * @brief BoundedQueue is a lock-free queue of fixed capacity. Any number of
+ * threads may push and pop concurrently without taking a lock, each slot
+ * carries a sequence number telling whether it is free or filled for the
+ * current lap of the ring (D. Vyukov's bounded MPMC queue). Neither Push()
+ * nor Pop() block, waiting is left to the caller.
+ *
+ * @tparam T The type of the items, must be default constructible and movable
+ */
+template <typename T>
+class BoundedQueue {
+   public:
+    /**
+     * @brief Construct a new BoundedQueue.
+     *
+     * @param capacity The minimum number of items, rounded up to a power of
+     * two of at least 2
+     */
+    explicit BoundedQueue(size_t capacity) {
+        size_t size = 2;
+        while (size < capacity) {
+            size <<= 1;
+        }
+
+        mask_ = size - 1;
+        slots_.reset(new Slot[size]);
+
+        for (size_t i = 0; i < size; i++) {
+            slots_[i].seq.store(i, std::memory_order_relaxed);
+        }
+
+        push_pos_.value.store(0, std::memory_order_relaxed);
+        pop_pos_.value.store(0, std::memory_order_relaxed);
+    }
+
+    BoundedQueue(const BoundedQueue&) = delete;
+    BoundedQueue& operator=(const BoundedQueue&) = delete;
+
+    /**
+     * @brief Append an item.
+     *
+     * @param item The item, moved from only if it was appended
+     * @return false if the queue is full
+     */
+    bool Push(T& item) {
+        auto pos = push_pos_.value.load(std::memory_order_relaxed);
+        Slot* slot;
+
+        for (;;) {
+            slot = &slots_[pos & mask_];
+            auto seq = slot->seq.load(std::memory_order_acquire);
+            auto diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+
+            if (diff == 0) {
+                // The slot is free in this lap, claim it
+                if (push_pos_.value.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (diff < 0) {
+                // The slot still holds the item of the previous lap
+                return false;
+            } else {
+                pos = push_pos_.value.load(std::memory_order_relaxed);
+            }
+        }
+
+        slot->item = std::move(item);
+        slot->seq.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * @brief Remove the oldest item.
+     *
+     * @param item The item removed
+     * @return false if the queue is empty
+     */
+    bool Pop(T& item) {
+        auto pos = pop_pos_.value.load(std::memory_order_relaxed);
+        Slot* slot;
+
+        for (;;) {
+            slot = &slots_[pos & mask_];
+            auto seq = slot->seq.load(std::memory_order_acquire);
+            auto diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos + 1);
+
+            if (diff == 0) {
+                // The slot is filled in this lap, claim it
+                if (pop_pos_.value.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = pop_pos_.value.load(std::memory_order_relaxed);
+            }
+        }
+
+        item = std::move(slot->item);
+        slot->item = T{};
+
+        // Free the slot for the next lap
+        slot->seq.store(pos + mask_ + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * @brief Get the number of items. Only a snapshot while other threads
+     * push or pop.
+     *
+     * @return size_t
+     */
+    size_t Size() const {
+        auto pop_pos = pop_pos_.value.load(std::memory_order_acquire);
+        auto push_pos = push_pos_.value.load(std::memory_order_acquire);
+        return push_pos > pop_pos ? push_pos - pop_pos : 0;
+    }
+
+    /**
+     * @brief Get the capacity.
+     *
+     * @return size_t
+     */
+    size_t GetCapacity() const {
+        return mask_ + 1;
+    }
+
+   private:
+    struct Slot {
+        std::atomic<size_t> seq;
+        T item;
+    };
+
+    // Producers and consumers update their positions on separate cache lines
+    struct Position {
+        std::atomic<size_t> value;
+        char padding[64 - sizeof(std::atomic<size_t>)];
+    };
+
+    Position push_pos_;
+    Position pop_pos_;
+    size_t mask_;
+    std::unique_ptr<Slot[]> slots_;
+};
+
+}  // namespace core
+}  // namespace iotea
+
+#endif // SRC_SDK_CPP_LIB_INCLUDE_BOUNDED_QUEUE_HPP_
@@ -11,7 +11,10 @@
 #ifndef SRC_SDK_CPP_LIB_INCLUDE_CALL_HPP_
 #define SRC_SDK_CPP_LIB_INCLUDE_CALL_HPP_
 
+#include <atomic>
+#include <list>
 #include <memory>
+#include <mutex>
 #include <set>
 #include <string>
 #include <unordered_map>
@@ -22,7 +25,10 @@
 #include "common.hpp"
 #include "event.hpp"
 #include "interface.hpp"
+#include "outbox.hpp"
 #include "protocol_gateway.hpp"
+#include "publisher.hpp"
+#include "timer_wheel.hpp"
 #include "util.hpp"
 
 using json = nlohmann::json;
@@ -32,6 +38,8 @@ namespace core {
 
 using call_id_t = std::string;
 
+static constexpr int64_t DEFAULT_TIMER_RESOLUTION_MS = 10;
+
 using gather_func_ptr = std::function<void(std::vector<json>)>;
 using gather_and_reply_func_ptr = std::function<json(std::vector<json>)>;
 using timeout_func_ptr = std::function<void(void)>;
@@ -173,7 +181,8 @@ class CallToken {
       * @param call_id A unique ID
       * @param timeout The maximum time to wait for a reply to a call in ms. If
       * the call can remain pending indefinatly use 0 (will leak memory if the
-      * reply is never received).
+      * reply is never received unless the number of pending calls is limited,
+      * see Client::SetMaxPendingCalls).
       */
      explicit CallToken(const call_id_t& call_id, int64_t timeout = 0);
 
@@ -229,6 +238,21 @@ class Gatherer {
      */
     virtual bool Wants(const call_id_t& id) const;
 
+    /**
+     * @brief Get the IDs of the calls expected by the gatherer.
+     *
+     * @return const std::set<call_id_t>&
+     */
+    const std::set<call_id_t>& GetIds() const;
+
+    /**
+     * @brief Get the time in ms since the epoch at which the nearest of the
+     * pending calls times out.
+     *
+     * @return int64_t
+     */
+    int64_t GetDeadline() const;
+
     /**
      * @brief Return whether the gatherer has gathered all the expected replies
      * and is ready for forward them.
@@ -321,12 +345,18 @@ class PreparedFunctionReply {
      * @param event The event that triggered the call
      * @param return_topic The topic on which the reply should be posted
      * @param gateway A pointer to a GatewayProtocl
+     * @param outbox An Outbox coalescing the reply or nullptr to publish it
+     * right away
+     * @param publisher A Publisher publishing on its own thread or nullptr to
+     * publish on the calling thread
      */
     PreparedFunctionReply(const std::string& talent_id,
             const std::string& feature,
             event_ptr event,
             const std::string& return_topic,
-            gateway_ptr gateway);
+            gateway_ptr gateway,
+            outbox_ptr outbox = nullptr,
+            publisher_ptr publisher = nullptr);
 
     virtual ~PreparedFunctionReply() = default;
 
@@ -346,6 +376,8 @@ class PreparedFunctionReply {
     std::string call_id_;
     std::string return_topic_;
     gateway_ptr gateway_;
+    outbox_ptr outbox_;
+    publisher_ptr publisher_;
 };
 
 /**
@@ -380,16 +412,54 @@ class ReplyGatherer : public Gatherer {
 
 /**
  * @brief ReplyHandler maintains a collection of pending function calls and
- * their associated result handling functions. ReplyHandler should not be used
- * by external clients.
+ * their associated result handling functions. Gatherers are indexed by the
+ * IDs of the calls they expect and their deadlines are tracked by a
+ * TimerWheel so that neither replies nor timeouts require a scan of all
+ * pending calls. ReplyHandler is thread safe and should not be used by
+ * external clients.
  *
  */
 class ReplyHandler {
    public:
+    /**
+     * @brief Construct a new ReplyHandler.
+     *
+     * @param max_pending The maximum number of pending Gatherers. When the
+     * limit is exceeded the oldest Gatherer is evicted and timed out. If 0
+     * the number of pending Gatherers is unbounded.
+     * @param resolution_ms The resolution in ms with which timeouts are
+     * detected.
+     */
+    explicit ReplyHandler(size_t max_pending = 0, int64_t resolution_ms = DEFAULT_TIMER_RESOLUTION_MS);
+
     virtual ~ReplyHandler() = default;
 
     /**
-     * @brief Add a Gatherer to this ReplyHandler.
+     * @brief Set the maximum number of pending Gatherers.
+     *
+     * @param max_pending The maximum number of pending Gatherers or 0 for no
+     * limit.
+     */
+    void SetMaxPending(size_t max_pending);
+
+    /**
+     * @brief Set the resolution with which timeouts are detected.
+     *
+     * @param resolution_ms The resolution in ms
+     */
+    void SetResolution(int64_t resolution_ms);
+
+    /**
+     * @brief Get the resolution with which timeouts are detected.
+     *
+     * @return int64_t The resolution in ms
+     */
+    int64_t GetResolution() const;
+
+    /**
+     * @brief Add a Gatherer to this ReplyHandler. If the maximum number of
+     * pending Gatherers is exceeded the oldest Gatherers are removed and
+     * timed out on the calling thread.
      *
      * @param gatherer The Gatherer
      */
@@ -404,17 +474,53 @@ class ReplyHandler {
      */
     std::shared_ptr<Gatherer> ExtractGatherer(const call_id_t& id);
 
+    /**
+     * @brief Pass a reply to the Gatherer expecting it. If the Gatherer has
+     * gathered all its replies it is removed and returned so that the caller
+     * can forward the replies.
+     *
+     * @param id A call ID.
+     * @param reply The reply to the call.
+     * @return std::shared_ptr<Gatherer> The ready Gatherer or nullptr if no
+     * Gatherer expected the reply or the Gatherer expects more replies.
+     */
+    std::shared_ptr<Gatherer> GatherReply(const call_id_t& id, const json& reply);
+
     /**
      * @brief Remove and return all Gatherers that are waiting for a reply that
      * has timed out.
      *
-     * @param ts A steady clock timestamp in ms
+     * @param ts The current time in ms since the epoch
      * @return std::vector<std::shard_ptr<Gatherer>>
      */
     std::vector<std::shared_ptr<Gatherer>> ExtractTimedOut(int64_t ts);
 
+    /**
+     * @brief Get the number of pending Gatherers.
+     *
+     * @return size_t
+     */
+    size_t GetPendingCount() const;
+
    private:
-    std::vector<std::shared_ptr<Gatherer>> gatherers_;
+    using gatherer_list = std::list<std::shared_ptr<Gatherer>>;
+
+    struct Pending {
+        gatherer_list::iterator order;
+        timer_id_t timer;
+    };
+
+    std::shared_ptr<Gatherer> Remove(Gatherer* gatherer);
+
+    mutable std::mutex mutex_;
+    std::atomic<size_t> max_pending_;
+
+    // Pending gatherers in the order they were added
+    gatherer_list order_;
+    TimerWheel wheel_;
+    std::unordered_map<timer_id_t, Gatherer*> timers_;
+    std::unordered_map<Gatherer*, Pending> pending_;
+    std::unordered_map<call_id_t, Gatherer*> index_;
 };
 
 }  // namespace core
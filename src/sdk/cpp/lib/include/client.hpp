@@ -12,6 +12,7 @@
 #define SRC_SDK_CPP_LIB_INCLUDE_CLIENT_HPP_
 
 #include <atomic>
+#include <condition_variable>
 #include <memory>
 #include <mutex>
 #include <string>
@@ -21,7 +22,10 @@
 
 #include "event.hpp"
 #include "call.hpp"
+#include "dispatcher.hpp"
+#include "id_generator.hpp"
 #include "talent.hpp"
+#include "topic_router.hpp"
 
 
 namespace iotea {
@@ -113,14 +117,18 @@ class Client : public Receiver {
      *
      * @param gateway A ProtocolGatway
      * configuration to use.
+     * @param dispatch_options Controls how incoming messages are distributed
+     * among worker threads. By default messages are handled synchronously on
+     * the thread that received them.
      */
-     explicit Client(gateway_ptr gateway);
+     explicit Client(gateway_ptr gateway, const DispatchOptions& dispatch_options = DispatchOptions{});
 
      virtual ~Client();
 
      /**
       * @brief Start the client. All Services, Talents and subscriptions must
-      * be created and registerd before Start() is called. When the client is
+      * be created and registerd before Start() is called, registrations made
+      * after Start() are rejected. When the client is
       * in the "started" state it will attempt to connect to the broker and
       * will try to maintain the connection indefinitely reconnecting if the
       * connection is lost.  This method does not return until Stop() is
@@ -175,12 +183,94 @@ class Client : public Receiver {
       */
      virtual void Subscribe(schema::rule_ptr rules, const OnEvent callback);
 
+     /**
+      * @brief Set the function generating the IDs of outgoing calls and
+      * talent channels. Defaults to GenerateUUID, GenerateCompactId yields
+      * shorter IDs and reply topics. Must be called before Start().
+      *
+      * The IDs should not contain '/', a channel ID must be a single level
+      * of the reply topics. A reply to a call ID containing '/' is routed by
+      * taking everything after the channel level as the call ID.
+      *
+      * @param uuid_gen The ID generator
+      */
+     void SetIdGenerator(uuid_generator_func_ptr uuid_gen);
+
+     /**
+      * @brief Limit the number of outgoing calls awaiting replies. When the
+      * limit is exceeded the oldest pending calls are timed out.
+      *
+      * @param max_pending The maximum number of pending calls or 0 for no
+      * limit.
+      */
+     void SetMaxPendingCalls(size_t max_pending);
+
+     /**
+      * @brief Set the resolution with which call timeouts are detected, i.e.
+      * timeout handlers are invoked at most this late. Defaults to
+      * DEFAULT_TIMER_RESOLUTION_MS.
+      *
+      * @param resolution_ms The resolution in ms
+      */
+     void SetTimerResolution(int64_t resolution_ms);
+
+     /**
+      * @brief Coalesce the events and function replies sent by the Talents
+      * into arrays, one message per return topic, instead of publishing each
+      * of them right away. A message is held back until max_events messages
+      * for its topic are pending or for at most max_delay_ms. Must be called
+      * before Start().
+      *
+      * @param max_events The maximum number of messages per array, 1 to
+      * publish each message right away
+      * @param max_delay_ms The maximum time a message is held back in ms
+      */
+     void SetEmitBatching(size_t max_events, int64_t max_delay_ms);
+
+     /**
+      * @brief Get a snapshot of the queue depth counters of each dispatch
+      * worker. Empty if messages are handled synchronously.
+      *
+      * @return std::vector<DispatchStats>
+      */
+     std::vector<DispatchStats> GetDispatchStats() const;
+
+     /**
+      * @brief Publish the events, function calls and replies sent by the
+      * Talents on a dedicated publisher thread instead of the thread sending
+      * them. Messages are queued per priority class, function calls and
+      * replies before events, and a full queue blocks the sender or drops
+      * messages as configured. EventContext::Emit returns whether an event
+      * was throttled or dropped. Must be called before Start().
+      *
+      * @param options The queue of each priority class
+      */
+     void SetAsyncPublishing(const PublisherOptions& options = PublisherOptions{});
+
+     /**
+      * @brief Get a snapshot of the counters of each publisher queue, indexed
+      * by PublishPriority. Empty if publishing is synchronous.
+      *
+      * @return std::vector<PublisherStats>
+      */
+     std::vector<PublisherStats> GetPublisherStats() const;
+
+     /**
+      * @brief Get a snapshot of the sent, suppressed and conflated event
+      * counters of each output feature with an EmitPolicy (see
+      * Talent::AddOutput). Empty before Start() or if no policy is set.
+      *
+      * @return std::unordered_map<std::string, EmitStats>
+      */
+     std::unordered_map<std::string, EmitStats> GetEmitStats() const;
+
      std::function<void(error_message_ptr)> OnError;
      std::function<void(platform_event_ptr event)> OnPlatformEvent;
 
     protected:
 
-    Client(gateway_ptr gateway, std::shared_ptr<CalleeTalent> callee_talent, reply_handler_ptr reply_handler);
+    Client(gateway_ptr gateway, std::shared_ptr<CalleeTalent> callee_talent, reply_handler_ptr reply_handler,
+            const DispatchOptions& dispatch_options = DispatchOptions{});
 
      /**
       * @brief Parse and distribute a discover message to all Talents.
@@ -222,9 +312,9 @@ class Client : public Receiver {
       * @brief Handle an event sent to a particular Talent.
       *
       * @param talent_id The ID of the talent
-      * @param msg The raw event
+      * @param msg The raw event, kept by the parsed Event rather than copied
       */
-     virtual void HandleEvent(const std::string& talent_id, const std::string& msg);
+     virtual void HandleEvent(const std::string& talent_id, const payload_ptr& msg);
 
      /**
       * @brief Handle a reply to a function call.
@@ -232,10 +322,11 @@ class Client : public Receiver {
       * @param talent_id The ID of the talent that made the call
       * @param channel_id The ID of the channel the reply was sent to
       * @param call_id The ID of the call
-      * @param msg The raw reply event
+      * @param msg The raw reply event, kept by the parsed Event rather than
+      * copied
       */
      virtual void HandleCallReply(const std::string& talent_id, const std::string&
-             channel_id, const call_id_t& call_id, const std::string& msg);
+             channel_id, const call_id_t& call_id, const payload_ptr& msg);
 
      /**
       * @brief Receive a message from MQTT.
@@ -246,9 +337,19 @@ class Client : public Receiver {
       */
      void Receive(const std::string& topic, const std::string& msg, const std::string& adapter_id) override;
 
+     /**
+      * @brief Receive a message from MQTT. The payload is shared with the
+      * dispatcher instead of being copied.
+      *
+      * @param topic The topic the message was sent one
+      * @param msg The message
+      * @param adapter_id The adapter the message was received from
+      */
+     void Receive(const std::string& topic, const payload_ptr& msg, const std::string& adapter_id) override;
+
      /**
       * @brief Handle the progress of time. This method is called
-      * periodically. Used for cleaning out timed out function calls and
+      * once per timer tick. Used for cleaning out timed out function calls and
       * anything else that needs to be inspected periodically.
       *
       * @param ts The current epoch time in ms.
@@ -262,18 +363,79 @@ class Client : public Receiver {
       */
      virtual void SubscribeInternal(std::shared_ptr<Talent> talent);
 
+     /**
+      * @brief Create the EmitShaper from the emit policies of the Talents,
+      * if any. Emitted events only carry the name of the feature, so an
+      * output declared with different policies by several Talents is
+      * reported and left unshaped.
+      */
+     void CreateShaper();
+
     private:
      void StartTicker();
      void StopTicker();
 
+     /**
+      * @brief Send an event held back by the EmitShaper.
+      */
+     void SendShaped(const std::string& topic, const std::string& msg);
+
+     /**
+      * @brief Send all events held back by the EmitShaper and the Outbox
+      * and stop the publisher thread once they are published.
+      */
+     void FlushEmitted();
+
+     /**
+      * @brief Return true and log an error if the talent table has been frozen
+      * by Start().
+      */
+     bool IsFrozen(const std::string& talent_id) const;
+
+     /**
+      * @brief TalentEntry is an entry in the table used to resolve the
+      * target of an incoming event with a single lookup. Function talents
+      * take precedence over subscription talents with the same ID.
+      */
+     struct TalentEntry {
+         std::shared_ptr<FunctionTalent> function_talent;
+         std::shared_ptr<Talent> subscription_talent;
+     };
+
+     using msg_handler_func_ptr = std::function<void(const payload_ptr&)>;
+
+     /**
+      * @brief Hand a message and its handler to the dispatcher. Exclusive
+      * handlers are executed while holding the client lock. Worker threads
+      * keep a reference to the message rather than a copy.
+      */
+     void Dispatch(size_t key, bool exclusive, const payload_ptr& msg, msg_handler_func_ptr handler);
+
+     /**
+      * @brief Compute the shard key of a message according to the dispatch
+      * options.
+      */
+     size_t GetShardKey(const std::string& talent_id, const std::string& msg) const;
+
      gateway_ptr gateway_;
      std::shared_ptr<CalleeTalent> callee_talent_;
      std::unordered_map<std::string, std::shared_ptr<FunctionTalent>> function_talents_;
      std::unordered_map<std::string, std::shared_ptr<Talent>> subscription_talents_;
+     std::unordered_map<std::string, TalentEntry> talents_;
+     std::atomic_bool frozen_;
      reply_handler_ptr reply_handler_;
+     DispatchOptions dispatch_options_;
+     std::unique_ptr<Dispatcher> dispatcher_;
+     TopicRouter router_;
+     uuid_generator_func_ptr uuid_gen_;
+     outbox_ptr outbox_;
+     emit_shaper_ptr shaper_;
+     publisher_ptr publisher_;
 
      std::thread ticker_thread_;
      std::atomic_bool ticker_is_running_;
+     std::mutex ticker_mutex_;
+     std::condition_variable ticker_cv_;
      std::mutex mutex_;
 };
 
@@ -13,16 +13,32 @@
 #define SRC_SDK_CPP_LIB_INCLUDE_CONTEXT_HPP_
 
 #include <string>
+#include <type_traits>
+#include <vector>
 
 #include "call.hpp"
+#include "emit_shaper.hpp"
 #include "event.hpp"
+#include "publisher.hpp"
+#include "outbox.hpp"
 #include "protocol_gateway.hpp"
+#include "serializer.hpp"
 
 namespace iotea {
 namespace core {
 
 using reply_handler_ptr = std::shared_ptr<ReplyHandler>;
 
+/**
+ * @brief FeatureValue is a single event emitted by EventContext::EmitBatch.
+ */
+struct FeatureValue {
+    std::string feature;
+    json value;
+    std::string type = DEFAULT_TYPE;
+    std::string instance = DEFAULT_INSTANCE;
+};
+
 /**
  * @brief EventContext is the context within which an event exists.
  */
@@ -42,9 +58,16 @@ class EventContext {
      * @param reply_handler The ReplyHandler to use for collecting replies to outgoing calls
      * @param gateway A gateway to send replies with
      * @param uuid_gen A function generating stringified UUID4s
+     * @param outbox An Outbox coalescing the emitted events or nullptr to
+     * publish each event right away
+     * @param shaper An EmitShaper applying the emit policies of the output
+     * features or nullptr to send every event
+     * @param publisher A Publisher publishing on its own thread or nullptr to
+     * publish on the calling thread
      */
     EventContext(const std::string& talent_id, const std::string& channel_id, const std::string& subject,
-                 const std::string& return_topic, reply_handler_ptr reply_handler, gateway_ptr gateway, uuid_generator_func_ptr uuid_gen);
+                 const std::string& return_topic, reply_handler_ptr reply_handler, gateway_ptr gateway, uuid_generator_func_ptr uuid_gen,
+                 outbox_ptr outbox = nullptr, emit_shaper_ptr shaper = nullptr, publisher_ptr publisher = nullptr);
 
     /**
      * @brief Get the ID of the Talent.
@@ -75,7 +98,8 @@ class EventContext {
     std::string GetReturnTopic() const;
 
     /**
-     * @brief Emit an event within this context.
+     * @brief Emit an event within this context. The event may be suppressed
+     * or held back by the EmitPolicy of the feature.
      *
      * @code
        auto degrees = collect_temperature();
@@ -88,14 +112,40 @@ class EventContext {
      * @param value The value payload of the event
      * @param type The name of the type providing the feature
      * @param instance The name of the instance
+     * @return PublishStatus Tells whether the event was throttled or dropped
+     * by a full publisher queue (see Client::SetAsyncPublishing)
      */
     template <typename T>
-    void Emit(const std::string& feature, const T& value, const std::string& type = DEFAULT_TYPE,
-              const std::string& instance = DEFAULT_INSTANCE) const {
-        auto e = OutgoingEvent<T>{subject_, talent_id_, feature, value, type, instance};
-        gateway_->Publish(return_topic_, e.Json().dump());
+    PublishStatus Emit(const std::string& feature, const T& value, const std::string& type = DEFAULT_TYPE,
+                       const std::string& instance = DEFAULT_INSTANCE) const {
+        auto now_ms = GetEpochTimeMs();
+        auto decision = Shape(feature, value, type, instance, now_ms);
+        if (decision == EmitShaper::Decision::SUPPRESS) {
+            return PublishStatus::OK;
+        }
+
+        ScopedBuffer buffer;
+        SerializeEvent(buffer.Get(), subject_, feature, value, type, instance, now_ms);
+        return Deliver(decision, feature, type, instance, buffer.Get());
     }
 
+    /**
+     * @brief Emit several events within this context as a single message
+     * holding an array of the events. Each event is subject to the
+     * EmitPolicy of its feature.
+     *
+     * @code
+       context.EmitBatch({
+           {"temperature", degrees, "device"},
+           {"humidity", percent, "device"},
+       });
+     * @endcode
+     *
+     * @param values The features and values of the events
+     * @return PublishStatus The most severe status of the events
+     */
+    PublishStatus EmitBatch(const std::vector<FeatureValue>& values) const;
+
     /**
      * @brief Call the function represented by a Callee. Calling a function and
      * gathering the result is a two step process. First
@@ -188,6 +238,37 @@ class EventContext {
      */
     virtual CallToken CallInternal(const Callee& callee, const json& args, int64_t timeout) const;
 
+    /**
+     * @brief Send a serialized event or reply to the return topic, through
+     * the Outbox or the Publisher if there is one.
+     *
+     * @param msg The message
+     * @param priority The priority class of the message
+     * @return PublishStatus
+     */
+    PublishStatus Send(const std::string& msg, PublishPriority priority = PublishPriority::NORMAL) const;
+
+    /**
+     * @brief Apply the EmitPolicy of a feature to an event.
+     */
+    template <typename T>
+    EmitShaper::Decision Shape(const std::string& feature, const T& value, const std::string& type,
+                               const std::string& instance, int64_t now_ms) const {
+        if (!shaper_) {
+            return EmitShaper::Decision::SEND;
+        }
+
+        double number;
+        return shaper_->Admit(subject_, feature, type, instance, AsNumber(value, number) ? &number : nullptr, now_ms);
+    }
+
+    /**
+     * @brief Send a serialized event or hand it to the EmitShaper to hold it
+     * back, as decided by Shape().
+     */
+    PublishStatus Deliver(EmitShaper::Decision decision, const std::string& feature, const std::string& type,
+                          const std::string& instance, const std::string& msg) const;
+
     const std::string talent_id_;
     const std::string channel_id_;
     const std::string subject_;
@@ -195,7 +276,28 @@ class EventContext {
     reply_handler_ptr reply_handler_;
     gateway_ptr gateway_;
     uuid_generator_func_ptr uuid_gen_;
+    outbox_ptr outbox_;
+    emit_shaper_ptr shaper_;
+    publisher_ptr publisher_;
+
+   private:
+    template <typename T>
+    static bool AsNumber(const T& value, double& number) {
+        return AsNumber(value, number, std::integral_constant<bool, std::is_arithmetic<T>::value && !std::is_same<T, bool>::value>{});
+    }
+
+    template <typename T>
+    static bool AsNumber(const T& value, double& number, std::true_type /* number */) {
+        number = static_cast<double>(value);
+        return true;
+    }
+
+    template <typename T>
+    static bool AsNumber(const T&, double&, std::false_type /* number */) {
+        return false;
+    }
 
+    static bool AsNumber(const json& value, double& number);
 };
 
 /**
@@ -217,9 +319,16 @@ class CallContext : public EventContext {
      * @param reply_handler The ReplyHandler to use for collecting replies to outgoing calls
      * @param gateway A gateway to send replies with
      * @param uuid_gen A function generating stringified UUID4s
+     * @param outbox An Outbox coalescing the replies or nullptr to publish
+     * each reply right away
+     * @param shaper An EmitShaper applying the emit policies of the output
+     * features to the emitted events (not to the reply) or nullptr
+     * @param publisher A Publisher publishing on its own thread or nullptr to
+     * publish on the calling thread
      */
     CallContext(const std::string& talent_id, const std::string& channel_id, const std::string& feature,
-                event_ptr event, reply_handler_ptr reply_handler, gateway_ptr gateway, uuid_generator_func_ptr uuid_gen);
+                event_ptr event, reply_handler_ptr reply_handler, gateway_ptr gateway, uuid_generator_func_ptr uuid_gen,
+                outbox_ptr outbox = nullptr, emit_shaper_ptr shaper = nullptr, publisher_ptr publisher = nullptr);
 
     virtual CallToken Call(const Callee& callee, const json& args, int64_t timeout = 10000) const override;
 
@@ -283,7 +392,7 @@ class CallContext : public EventContext {
     void GatherAndReply(gather_and_reply_func_ptr func, timeout_func_ptr timeout_func, Args... args) {
         auto now_ms = GetEpochTimeMs();
         auto tokens = std::vector<CallToken>{args...};
-        auto prepared_reply = PreparedFunctionReply{talent_id_, feature_, event_, return_topic_, gateway_};
+        auto prepared_reply = PreparedFunctionReply{talent_id_, feature_, event_, return_topic_, gateway_, outbox_, publisher_};
         auto gatherer = std::make_shared<ReplyGatherer>(func, timeout_func, prepared_reply, tokens, now_ms);
 
         reply_handler_->AddGatherer(gatherer);
@@ -0,0 +1,180 @@
+/*****************************************************************************
+ * Copyright (c) 2021 Bosch.IO GmbH
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * SPDX-License-Identifier: MPL-2.0
+ ****************************************************************************/
+
+#ifndef SRC_SDK_CPP_LIB_INCLUDE_DISPATCHER_HPP_
+#define SRC_SDK_CPP_LIB_INCLUDE_DISPATCHER_HPP_
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace iotea {
+namespace core {
+
+using task_func_ptr = std::function<void(void)>;
+
+/**
+ * @brief DispatchOptions describes how the Client distributes incoming
+ * messages among its worker threads.
+ */
+class DispatchOptions {
+   public:
+    /**
+     * @brief The property of a message used to select the worker (shard) that
+     * handles it. Messages with the same key are always handled by the same
+     * worker and therefore in the order they were received.
+     */
+    enum class ShardKey {
+        SUBJECT,
+        TALENT,
+        INSTANCE,
+    };
+
+    /**
+     * @brief Construct a new DispatchOptions.
+     *
+     * @param workers The number of worker threads. If 0 messages are handled
+     * synchronously on the thread that received them.
+     * @param shard_key The message property to shard on.
+     * @param cpus CPUs to pin the workers to. Worker i is pinned to
+     * cpus[i % cpus.size()]. If empty the workers are not pinned.
+     */
+    explicit DispatchOptions(size_t workers = 0, ShardKey shard_key = ShardKey::SUBJECT, const std::vector<int>& cpus = {});
+
+    /**
+     * @brief Get the number of worker threads.
+     *
+     * @return size_t
+     */
+    size_t GetWorkers() const;
+
+    /**
+     * @brief Get the message property to shard on.
+     *
+     * @return DispatchOptions::ShardKey
+     */
+    ShardKey GetShardKey() const;
+
+    /**
+     * @brief Get the CPUs to pin the workers to.
+     *
+     * @return const std::vector<int>&
+     */
+    const std::vector<int>& GetCpus() const;
+
+   private:
+    size_t workers_;
+    ShardKey shard_key_;
+    std::vector<int> cpus_;
+};
+
+/**
+ * @brief DispatchStats is a snapshot of the counters of a single shard.
+ */
+struct DispatchStats {
+    size_t queue_depth;
+    size_t max_queue_depth;
+    uint64_t processed;
+};
+
+/**
+ * @brief Dispatcher executes tasks on a fixed pool of worker threads. Each
+ * worker owns a queue (shard) and tasks are assigned to a shard by a key so
+ * that tasks with the same key are executed sequentially in the order they
+ * were posted while tasks with different keys may execute in parallel.
+ * Should not be used by external clients.
+ */
+class Dispatcher {
+   public:
+    /**
+     * @brief Construct a new Dispatcher.
+     *
+     * @param options The dispatch options
+     */
+    explicit Dispatcher(const DispatchOptions& options);
+
+    virtual ~Dispatcher();
+
+    /**
+     * @brief Start the workers. Tasks posted before Start() are queued and
+     * executed once the workers are running.
+     */
+    virtual void Start();
+
+    /**
+     * @brief Stop the workers. Tasks already queued are executed before the
+     * workers exit. Blocks until all workers have terminated.
+     */
+    virtual void Stop();
+
+    /**
+     * @brief Return whether tasks are executed on worker threads or
+     * synchronously by Post().
+     *
+     * @return bool
+     */
+    bool IsParallel() const;
+
+    /**
+     * @brief Post a task to the shard selected by key. If the Dispatcher has
+     * no workers, or has been stopped, the task is executed immediately on
+     * the calling thread.
+     *
+     * @param key A hash of the shard key
+     * @param task The task to execute
+     */
+    virtual void Post(size_t key, task_func_ptr task);
+
+    /**
+     * @brief Get a snapshot of the counters of each shard.
+     *
+     * @return std::vector<DispatchStats>
+     */
+    std::vector<DispatchStats> GetStats() const;
+
+    /**
+     * @brief Hash a shard key.
+     *
+     * @param key The shard key
+     * @return size_t
+     */
+    static size_t Hash(const std::string& key);
+
+   private:
+    struct Shard {
+        std::mutex mutex;
+        std::condition_variable cv;
+        std::deque<task_func_ptr> queue;
+        bool stopped = false;
+        std::atomic<size_t> depth{0};
+        std::atomic<size_t> max_depth{0};
+        std::atomic<uint64_t> processed{0};
+        std::thread thread;
+    };
+
+    void Run(Shard* shard);
+    void Pin(std::thread& thread, size_t index) const;
+
+    DispatchOptions options_;
+    std::vector<std::unique_ptr<Shard>> shards_;
+    std::atomic_bool stopped_;
+};
+
+}  // namespace core
+}  // namespace iotea
+
+#endif // SRC_SDK_CPP_LIB_INCLUDE_DISPATCHER_HPP_
@@ -0,0 +1,222 @@
+/*****************************************************************************
+ * Copyright (c) 2021 Bosch.IO GmbH
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * SPDX-License-Identifier: MPL-2.0
+ ****************************************************************************/
+
+#ifndef SRC_SDK_CPP_LIB_INCLUDE_EMIT_SHAPER_HPP_
+#define SRC_SDK_CPP_LIB_INCLUDE_EMIT_SHAPER_HPP_
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace iotea {
+namespace core {
+
+/**
+ * @brief EmitPolicy describes how the events of an output feature are
+ * thinned out before they are sent. Each event is shaped per subject, type
+ * and instance of the feature. By default all events are sent.
+ *
+ * @code
+   // At most one event per second, only if it moved by more than 0.5
+   AddOutput("temperature", metadata, EmitPolicy{}.Conflate(1000).Deadband(0.5));
+ * @endcode
+ */
+class EmitPolicy {
+   public:
+    /**
+     * @brief Hold back each event for up to window_ms. Events emitted in the
+     * meantime replace the held back event, so that only the latest value of
+     * a window is sent at its end.
+     *
+     * @param window_ms The window in ms, 0 to send right away
+     * @return EmitPolicy&
+     */
+    EmitPolicy& Conflate(int64_t window_ms);
+
+    /**
+     * @brief Suppress numeric values that differ from the last value sent by
+     * less than absolute or by less than relative times its magnitude.
+     * Values that are not numbers are always sent.
+     *
+     * @param absolute The absolute deadband, 0 for none
+     * @param relative The relative deadband, e.g. 0.01 for 1%, 0 for none
+     * @return EmitPolicy&
+     */
+    EmitPolicy& Deadband(double absolute, double relative = 0);
+
+    /**
+     * @brief Suppress the events exceeding a rate, allowing bursts of up to
+     * burst events (token bucket). Not applied to conflated events, which
+     * are sent at most once per window anyway.
+     *
+     * @param per_second The sustained number of events per second, 0 for no
+     * limit
+     * @param burst The maximum number of events sent at once
+     * @return EmitPolicy&
+     */
+    EmitPolicy& RateLimit(double per_second, double burst = 1);
+
+    int64_t GetConflationWindow() const;
+    double GetAbsoluteDeadband() const;
+    double GetRelativeDeadband() const;
+    double GetRate() const;
+    double GetBurst() const;
+
+    /**
+     * @brief Compare this EmitPolicy to another.
+     *
+     * @param other The EmitPolicy to compare this EmitPolicy to
+     *
+     * @return true If this EmitPolicy is equal to "other"
+     */
+    bool operator==(const EmitPolicy& other) const;
+    bool operator!=(const EmitPolicy& other) const;
+
+   private:
+    int64_t window_ms_ = 0;
+    double absolute_ = 0;
+    double relative_ = 0;
+    double rate_ = 0;
+    double burst_ = 1;
+};
+
+/**
+ * @brief EmitStats counts the events of an output feature.
+ */
+struct EmitStats {
+    uint64_t sent;        // Sent, right away or at the end of a window
+    uint64_t suppressed;  // Dropped by the deadband or the rate limit
+    uint64_t conflated;   // Replaced by a later event of the same window
+};
+
+using emit_sink_func_ptr = std::function<void(
+    const std::string&,   // topic
+    const std::string&)>; // message
+
+/**
+ * @brief EmitShaper applies the EmitPolicy of each output feature to the
+ * events emitted by the contexts of a Client. Policies must be set before
+ * the first event is emitted. Should not be used by external clients.
+ */
+class EmitShaper {
+   public:
+    /**
+     * @brief What to do with an event.
+     */
+    enum class Decision {
+        SEND,
+        SUPPRESS,
+        HOLD,  // Pass the serialized event to Hold()
+    };
+
+    /**
+     * @brief Set the policy of an output feature.
+     *
+     * @param feature The name of the feature
+     * @param policy The policy
+     */
+    void SetPolicy(const std::string& feature, const EmitPolicy& policy);
+
+    /**
+     * @brief Decide what to do with an event.
+     *
+     * @param subject The subject of the event
+     * @param feature The feature of the event
+     * @param type The type of the event
+     * @param instance The instance of the event
+     * @param number The value if it is a number, nullptr otherwise
+     * @param now_ms The current time in ms since the epoch
+     * @return Decision
+     */
+    Decision Admit(const std::string& subject, const std::string& feature, const std::string& type,
+                   const std::string& instance, const double* number, int64_t now_ms);
+
+    /**
+     * @brief Hold back a serialized event that Admit() decided to HOLD,
+     * replacing the event held back for the same subject, type and
+     * instance.
+     *
+     * @param subject The subject of the event
+     * @param feature The feature of the event
+     * @param type The type of the event
+     * @param instance The instance of the event
+     * @param topic The topic to publish the event to
+     * @param msg The serialized event
+     */
+    void Hold(const std::string& subject, const std::string& feature, const std::string& type,
+              const std::string& instance, const std::string& topic, const std::string& msg);
+
+    /**
+     * @brief Send the held back events whose window has ended.
+     *
+     * @param now_ms The current time in ms since the epoch
+     * @param sink The function sending an event
+     */
+    void FlushExpired(int64_t now_ms, const emit_sink_func_ptr& sink);
+
+    /**
+     * @brief Send all held back events.
+     *
+     * @param sink The function sending an event
+     */
+    void Flush(const emit_sink_func_ptr& sink);
+
+    /**
+     * @brief Get the shortest conflation window of all policies.
+     *
+     * @return int64_t The window in ms, 0 if no feature is conflated
+     */
+    int64_t GetMinConflationWindow() const;
+
+    /**
+     * @brief Get a snapshot of the counters of each feature with a policy.
+     *
+     * @return std::unordered_map<std::string, EmitStats>
+     */
+    std::unordered_map<std::string, EmitStats> GetStats() const;
+
+   private:
+    // The shaping state of a subject, type and instance
+    struct State {
+        bool has_last = false;
+        double last = 0;
+        double tokens = 0;
+        int64_t refilled_ms = 0;
+        bool holding = false;
+        int64_t hold_until_ms = 0;
+        std::string topic;
+        std::string msg;
+    };
+
+    struct Feature {
+        explicit Feature(const EmitPolicy& policy);
+
+        const EmitPolicy policy;
+
+        mutable std::mutex mutex;
+        EmitStats stats{0, 0, 0};
+        std::unordered_map<std::string, State> states;
+    };
+
+    void Flush(int64_t now_ms, bool all, const emit_sink_func_ptr& sink);
+
+    // Not changed once events are emitted, only the features are locked
+    std::unordered_map<std::string, std::unique_ptr<Feature>> features_;
+};
+
+using emit_shaper_ptr = std::shared_ptr<EmitShaper>;
+
+}  // namespace core
+}  // namespace iotea
+
+#endif // SRC_SDK_CPP_LIB_INCLUDE_EMIT_SHAPER_HPP_
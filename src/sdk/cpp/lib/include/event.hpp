@@ -22,6 +22,7 @@
 #include "common.hpp"
 #include "interface.hpp"
 #include "logging.hpp"
+#include "raw_json.hpp"
 #include "schema.hpp"
 #include "util.hpp"
 
@@ -274,56 +275,60 @@ class Event {
           const std::string& instance = "default", const std::string& return_topic = "",
           int64_t when = GetEpochTimeMs());
 
-    Event() = default;
+    Event();
+
+    virtual ~Event() = default;
 
     /**
      * @brief Get the name of the return topic.
      *
-     * @return std::string
+     * @return const std::string&
      */
-    virtual std::string GetReturnTopic() const;
+    virtual const std::string& GetReturnTopic() const;
 
     /**
      * @brief Get the name of the subject.
      *
-     * @return std::string
+     * @return const std::string&
      */
-    virtual std::string GetSubject() const;
+    virtual const std::string& GetSubject() const;
 
     /**
      * @brief Get the name of the feature.
      *
-     * @return std::string
+     * @return const std::string&
      */
-    virtual std::string GetFeature() const;
+    virtual const std::string& GetFeature() const;
 
     /**
-     * @brief Get the payload value as JSON.
+     * @brief Get the payload value as JSON. Events created from a raw payload
+     * decode the value on first access.
      *
-     * @return json
+     * @return const json&
      */
-    virtual json GetValue() const;
+    virtual const json& GetValue() const;
 
     /**
-     * @brief Get the features of the event.
+     * @brief Get the features of the event. Events created from a raw
+     * payload decode the features on first access.
      *
-     * @return std::string
+     * @return const json&
      */
-    virtual json GetFeatures() const;
+    virtual const json& GetFeatures() const;
 
     /**
      * @brief Get the name of the instance.
      *
-     * @return std::string
+     * @return const std::string&
      */
-    virtual std::string GetInstance() const;
+    virtual const std::string& GetInstance() const;
 
     /**
      * @brief Get the name of the type.
      *
-     * @return std::string
+     * @return const std::string&
      */
-    virtual std::string GetType() const;
+    virtual const std::string& GetType() const;
 
     /**
      * @brief Get the time when the event was emitted in milliseconds since the
@@ -348,6 +353,28 @@ class Event {
      */
     static event_ptr FromJson(const json& j);
 
+    /**
+     * @brief Create an event from a raw payload without decoding it. The
+     * header fields (subject, feature, type, instance, return topic and
+     * time) are decoded together on first access, the value and the
+     * features each on their first access. Accessors throw a json exception
+     * if a field turns out to be malformed.
+     *
+     * @param raw The indexed payload, its buffer is kept by the Event
+     * @return A pointer to an Event or nullptr if the payload is not a JSON
+     * object or a required field is missing
+     */
+    static event_ptr FromRaw(RawJsonObject raw);
+
+    /**
+     * @brief Get the payload the event was created from by FromRaw(). Should
+     * not be used by external clients.
+     *
+     * @return const payload_ptr& The payload or nullptr if the event was
+     * created from its fields
+     */
+    const payload_ptr& GetPayload() const;
+
     /**
      * @brief Compare this Event to another. Comparison ignores the "when_" member.
      *
@@ -358,14 +385,13 @@ class Event {
     bool operator==(const Event& other) const;
 
    private:
-    std::string return_topic_;
-    std::string subject_;
-    std::string feature_;
-    json value_;
-    json features_;
-    std::string type_;
-    std::string instance_;
-    int64_t when_;
+    // The fields and the raw payload they are decoded from, shared by copies
+    // of the Event.
+    struct State;
+
+    const State& Header() const;
+
+    std::shared_ptr<State> state_;
 };
 
 /**
@@ -0,0 +1,59 @@
+/*****************************************************************************
+ * Copyright (c) 2021 Bosch.IO GmbH
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * SPDX-License-Identifier: MPL-2.0
+ ****************************************************************************/
+
+#ifndef SRC_SDK_CPP_LIB_INCLUDE_ID_GENERATOR_HPP_
+#define SRC_SDK_CPP_LIB_INCLUDE_ID_GENERATOR_HPP_
+
+#include <cstdint>
+#include <string>
+
+namespace iotea {
+namespace core {
+
+/**
+ * @brief Fill a buffer with the bits of a random (version 4) UUID as
+ * defined by RFC 4122. The bits are drawn from a PRNG that is seeded once
+ * per thread.
+ *
+ * @param bits The buffer to fill
+ */
+void GenerateUUID4Bits(uint8_t bits[16]);
+
+/**
+ * @brief Format the bits of a UUID in the canonical form, i.e.
+ * "xxxxxxxx-xxxx-xxxx-xxxx-xxxxxxxxxxxx".
+ *
+ * @param bits The bits of the UUID
+ * @return std::string
+ */
+std::string FormatUUID(const uint8_t bits[16]);
+
+/**
+ * @brief Generate a random (version 4) UUID as defined by RFC 4122.
+ *
+ * @return std::string
+ */
+std::string GenerateUUID4();
+
+/**
+ * @brief Generate a compact ID consisting of a random prefix, chosen once
+ * per process, and a monotonic counter, i.e. "<16 hex digits>-<hex counter>".
+ * The IDs are unique within the process and, with overwhelming probability,
+ * across processes while being about half the size of a UUID. Can be used
+ * instead of UUIDs for call and channel IDs, see Client::SetIdGenerator.
+ *
+ * @return std::string
+ */
+std::string GenerateCompactId();
+
+}  // namespace core
+}  // namespace iotea
+
+#endif // SRC_SDK_CPP_LIB_INCLUDE_ID_GENERATOR_HPP_
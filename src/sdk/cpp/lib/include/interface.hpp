@@ -17,6 +17,14 @@
 namespace iotea {
 namespace core {
 
+/**
+ * @brief payload_ptr is a reference counted handle to the payload of a
+ * received message. Adapters may point it into their own message buffers
+ * (e.g. with the aliasing constructor of std::shared_ptr) so that the payload
+ * can be kept by the receiver without being copied.
+ */
+using payload_ptr = std::shared_ptr<const std::string>;
+
 /**
  * @brief The Receiver interface describes methods required to receive
  * MQTT messages.
@@ -29,6 +37,11 @@ class Receiver {
    public:
     virtual ~Receiver() = default;
     virtual void Receive(const std::string& topic, const std::string& msg, const std::string& adapter_id) = 0;
+
+    // Receive a payload that may be kept beyond the call without copying it
+    virtual void Receive(const std::string& topic, const payload_ptr& msg, const std::string& adapter_id) {
+        Receive(topic, *msg, adapter_id);
+    }
 };
 
 }  // namespace core
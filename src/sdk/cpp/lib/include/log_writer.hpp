@@ -0,0 +1,203 @@
+/*****************************************************************************
+ * Copyright (c) 2021 Bosch.IO GmbH
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * SPDX-License-Identifier: MPL-2.0
+ ****************************************************************************/
+
+#ifndef SRC_SDK_CPP_LIB_INCLUDE_LOG_WRITER_HPP_
+#define SRC_SDK_CPP_LIB_INCLUDE_LOG_WRITER_HPP_
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace iotea {
+namespace core {
+namespace logging {
+
+enum class Level { DEBUG = 0, INFO = 1, WARNING = 2, ERROR = 3 };
+
+/**
+ * @brief OverflowPolicy determines what happens to a log line when the
+ * buffer of the logging thread is full.
+ */
+enum class OverflowPolicy {
+    DROP,   // Discard the line and report the number of dropped lines later
+    BLOCK,  // Wait for the writer to make room
+};
+
+/**
+ * @brief LogRecord is a single log line waiting to be written.
+ */
+struct LogRecord {
+    Level level = Level::INFO;
+    std::chrono::system_clock::time_point time;
+    std::string text;
+};
+
+/**
+ * @brief LogRing is a bounded single producer single consumer queue of log
+ * records. Pushing and popping are lock free. Should not be used by external
+ * clients.
+ */
+class LogRing {
+   public:
+    /**
+     * @brief Construct a new LogRing.
+     *
+     * @param capacity The number of records, rounded up to a power of two
+     */
+    explicit LogRing(size_t capacity);
+
+    /**
+     * @brief Push a record. Must only be called by the producer.
+     *
+     * @param record The record, only moved from if the push succeeds
+     * @return true if the record was pushed, false if the ring is full
+     */
+    bool Push(LogRecord& record);
+
+    /**
+     * @brief Pop a record. Must only be called by the consumer.
+     *
+     * @param record Receives the record
+     * @return true if a record was popped, false if the ring is empty
+     */
+    bool Pop(LogRecord& record);
+
+    /**
+     * @brief Mark the ring as closed, i.e. its producer has terminated.
+     */
+    void Close();
+
+    /**
+     * @brief Return whether the ring has been closed.
+     *
+     * @return bool
+     */
+    bool IsClosed() const;
+
+   private:
+    std::vector<LogRecord> records_;
+    size_t mask_;
+    std::atomic<size_t> head_{0};
+    std::atomic<size_t> tail_{0};
+    std::atomic_bool closed_{false};
+};
+
+/**
+ * @brief AsyncLogWriter writes log records on a background thread. Each
+ * logging thread pushes its records to its own LogRing so that logging
+ * threads never contend with each other. The writer collects the records in
+ * batches, formats the timestamps and writes each batch with a single call
+ * to the output. Should not be used by external clients.
+ */
+class AsyncLogWriter {
+   public:
+    /**
+     * @brief Construct a new AsyncLogWriter and start the writer thread. The
+     * output is stdout.
+     *
+     * @param ring_capacity The number of records buffered per logging thread
+     */
+    explicit AsyncLogWriter(size_t ring_capacity = 4096);
+
+    ~AsyncLogWriter();
+
+    /**
+     * @brief Write to a file instead of stdout.
+     *
+     * @param path The path of the file to append to, stdout if empty
+     * @return true if the file could be opened
+     */
+    bool SetOutput(const std::string& path);
+
+    /**
+     * @brief Set the behavior when the buffer of a logging thread is full.
+     *
+     * @param policy The overflow policy
+     */
+    void SetOverflowPolicy(OverflowPolicy policy);
+
+    /**
+     * @brief Queue a log line. If the writer has been stopped the line is
+     * written synchronously.
+     *
+     * @param level The level of the line
+     * @param time The time at which the line was logged
+     * @param text The text of the line
+     */
+    void Write(Level level, std::chrono::system_clock::time_point time, std::string&& text);
+
+    /**
+     * @brief Block until all lines queued before the call have been written.
+     */
+    void Flush();
+
+    /**
+     * @brief Write all queued lines and stop the writer thread.
+     */
+    void Stop();
+
+    /**
+     * @brief Get the number of lines dropped because a buffer was full.
+     *
+     * @return uint64_t
+     */
+    uint64_t GetDroppedCount() const;
+
+   private:
+    void Run();
+    size_t Drain();
+
+    // Push to the ring of the calling thread, false if it has to be written
+    // synchronously
+    bool Enqueue(LogRecord& record);
+    void Output(const std::string& batch);
+    void Append(std::string& batch, const LogRecord& record);
+    std::shared_ptr<LogRing> GetRing();
+
+    const uint64_t id_;
+    const size_t ring_capacity_;
+
+    std::atomic<OverflowPolicy> policy_{OverflowPolicy::BLOCK};
+    std::atomic<uint64_t> dropped_{0};
+    uint64_t reported_dropped_ = 0;
+
+    std::mutex rings_mutex_;
+    std::vector<std::shared_ptr<LogRing>> rings_;
+
+    std::mutex output_mutex_;
+    FILE* output_ = stdout;
+
+    // Cached formatted second of the last record, e.g. "2021-06-01T12:00:00"
+    int64_t cached_second_ = -1;
+    char cached_timestamp_[32] = {0};
+
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::condition_variable flushed_cv_;
+    bool wake_ = false;
+    uint64_t flush_requested_ = 0;
+    uint64_t flush_done_ = 0;
+    std::atomic_bool stopped_{false};
+    std::atomic<size_t> writers_{0};  // Pushing right now
+    std::thread thread_;
+};
+
+}  // namespace logging
+}  // namespace core
+}  // namespace iotea
+
+#endif // SRC_SDK_CPP_LIB_INCLUDE_LOG_WRITER_HPP_
@@ -11,24 +11,54 @@
 #ifndef SRC_SDK_CPP_LIB_INCLUDE_LOGGING_HPP_
 #define SRC_SDK_CPP_LIB_INCLUDE_LOGGING_HPP_
 
-#include <iostream>
-#include <mutex>
+#include <chrono>
+#include <memory>
+#include <sstream>
+#include <string>
+
+#include "log_writer.hpp"
+
+// The lowest level for which the IOTEA_LOG_* macros generate code:
+// 0 = DEBUG, 1 = INFO, 2 = WARNING, 3 = ERROR. Release builds drop DEBUG
+// statements unless IOTEA_LOG_COMPILE_LEVEL is defined explicitly.
+#ifndef IOTEA_LOG_COMPILE_LEVEL
+#ifdef NDEBUG
+#define IOTEA_LOG_COMPILE_LEVEL 1
+#else
+#define IOTEA_LOG_COMPILE_LEVEL 0
+#endif
+#endif
+
+#define IOTEA_LOG_ENABLED(level) \
+    (static_cast<int>(level) >= IOTEA_LOG_COMPILE_LEVEL && ::iotea::core::logging::IsEnabled(level))
+
+// Log through a NamedLogger (or any object with Debug(), Info(), Warn() and
+// Error() methods) if the level is enabled. The arguments following the
+// macro are not evaluated if the level is disabled, e.g.
+//
+//     IOTEA_LOG_DEBUG(logger) << "payload: " << payload.dump();
+#define IOTEA_LOG(logger, level, method) \
+    if (!IOTEA_LOG_ENABLED(level)) {    \
+    } else                              \
+        (logger).method()
+
+#define IOTEA_LOG_DEBUG(logger) IOTEA_LOG(logger, ::iotea::core::logging::Level::DEBUG, Debug)
+#define IOTEA_LOG_INFO(logger) IOTEA_LOG(logger, ::iotea::core::logging::Level::INFO, Info)
+#define IOTEA_LOG_WARN(logger) IOTEA_LOG(logger, ::iotea::core::logging::Level::WARNING, Warn)
+#define IOTEA_LOG_ERROR(logger) IOTEA_LOG(logger, ::iotea::core::logging::Level::ERROR, Error)
 
 namespace iotea {
 namespace core {
 namespace logging {
 
-enum class Level { DEBUG = 0, INFO = 1, WARNING = 2, ERROR = 3 };
-
 Level GetLogLevel();
 
 class Logger;
 
 class InternalLogger {
    private:
-    std::recursive_mutex mutex_;
-    std::ostream os_;
-    Level level_ = GetLogLevel();
+    std::atomic<Level> level_{GetLogLevel()};
+    AsyncLogWriter* writer_;
 
     InternalLogger();
 
@@ -38,35 +68,39 @@ class InternalLogger {
 
     void SetLevel(const Level level);
 
-    std::ostream& GetStream();
+    AsyncLogWriter* GetWriter();
 
     friend class Logger;
     friend void SetLevel(const Level);
+    friend bool IsEnabled(const Level);
+    friend bool SetOutput(const std::string&);
+    friend void SetOverflowPolicy(OverflowPolicy);
+    friend void Flush();
+    friend uint64_t GetDroppedCount();
     friend Logger Log(const Level);
 };
 
 class Logger {
    public:
 
-    Logger(const Logger& other);
+    Logger(const Logger& other) = default;
 
     Logger& operator=(const Logger& other) = default;
 
-    ~Logger();
+    ~Logger() = default;
 
     Logger& operator<<(const std::ostream& (*f)(std::ostream&));
 
     template <typename T>
     Logger& operator<<(const T& t) {
-        if (logger_->GetLevel() <= level_) {
-            logger_->GetStream() << t;
+        if (line_) {
+            line_->os << t;
         }
 
         return *this;
     }
 
     friend class NamedLogger;
-    friend void SetLevel(const Level);
     friend Logger Log(const Level);
     friend Logger Debug();
     friend Logger Info();
@@ -74,18 +108,59 @@ class Logger {
     friend Logger Error();
 
    private:
-    InternalLogger* logger_;
-    Level level_ = Level::INFO;
-    int call_depth_ = -1;
+    // The line is shared by copies of the Logger and handed to the writer
+    // when the last copy goes out of scope.
+    struct Line {
+        Level level;
+        std::chrono::system_clock::time_point time;
+        std::ostringstream os;
 
-    Logger(InternalLogger* l, const Level level, int call_depth = 0);
+        ~Line();
+    };
 
-    explicit Logger(InternalLogger* l);
+    std::shared_ptr<Line> line_;
 
+    explicit Logger(std::shared_ptr<Line> line);
 };
 
 void SetLevel(const Level lvl);
 
+/**
+ * @brief Return whether lines of the given level are currently logged.
+ *
+ * @param lvl The level
+ * @return bool
+ */
+bool IsEnabled(const Level lvl);
+
+/**
+ * @brief Write the log to a file instead of stdout.
+ *
+ * @param path The path of the file to append to, stdout if empty
+ * @return true if the file could be opened
+ */
+bool SetOutput(const std::string& path);
+
+/**
+ * @brief Set what happens to a log line if the buffer of the logging thread
+ * is full. The default is to block until the writer has made room.
+ *
+ * @param policy The overflow policy
+ */
+void SetOverflowPolicy(OverflowPolicy policy);
+
+/**
+ * @brief Block until all lines logged before the call have been written.
+ */
+void Flush();
+
+/**
+ * @brief Get the number of log lines dropped because a buffer was full.
+ *
+ * @return uint64_t
+ */
+uint64_t GetDroppedCount();
+
 Logger Log(const Level lvl);
 
 Logger Debug();
@@ -0,0 +1,150 @@
+/*****************************************************************************
+ * Copyright (c) 2021 Bosch.IO GmbH
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * SPDX-License-Identifier: MPL-2.0
+ ****************************************************************************/
+
+#ifndef SRC_SDK_CPP_LIB_INCLUDE_LOOPBACK_ADAPTER_HPP_
+#define SRC_SDK_CPP_LIB_INCLUDE_LOOPBACK_ADAPTER_HPP_
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "nlohmann/json.hpp"
+
+#include "batch_queue.hpp"
+#include "protocol_gateway.hpp"
+#include "topic_trie.hpp"
+
+using json = nlohmann::json;
+
+namespace iotea {
+namespace core {
+
+/**
+ * @brief LoopbackBus connects the LoopbackAdapters of a process that use the
+ * same bus name. Publishes are matched against the subscriptions of all
+ * adapters on the bus and queued to the subscribing adapters. Should not be
+ * used by external clients.
+ */
+class LoopbackBus {
+   public:
+    /**
+     * @brief A message queued to a subscriber.
+     */
+    struct Delivery {
+        std::string topic;
+        payload_ptr payload;
+        on_payload_func_ptr on_msg;
+    };
+
+    using inbox_ptr = std::shared_ptr<BatchQueue<Delivery>>;
+
+    /**
+     * @brief Get the bus with the given name, creating it if it does not
+     * exist. A bus lives as long as it is referenced.
+     *
+     * @param name The name of the bus
+     * @return std::shared_ptr<LoopbackBus>
+     */
+    static std::shared_ptr<LoopbackBus> Get(const std::string& name);
+
+    /**
+     * @brief Subscribe an inbox to a topic filter. Of all subscriptions to
+     * the same "$share/<group>/<filter>" only one receives each message, in
+     * turns.
+     *
+     * @param filter The topic filter
+     * @param inbox The inbox to queue matching messages to
+     * @param on_msg The callback to deliver matching messages to
+     */
+    void Subscribe(const std::string& filter, const inbox_ptr& inbox, on_payload_func_ptr on_msg);
+
+    /**
+     * @brief Queue a message to all matching subscriptions. Subscriptions of
+     * inboxes that no longer exist are skipped.
+     *
+     * @param topic The topic
+     * @param payload The payload, shared by all subscribers
+     */
+    void Publish(const std::string& topic, const payload_ptr& payload);
+
+   private:
+    struct Subscriber {
+        std::weak_ptr<BatchQueue<Delivery>> inbox;
+        on_payload_func_ptr on_msg;
+    };
+
+    // A plain subscription or all subscriptions of a share
+    struct Group {
+        std::vector<Subscriber> subscribers;
+        size_t next = 0;
+    };
+
+    std::mutex mutex_;
+    TopicTrie<std::shared_ptr<Group>> groups_;
+    std::unordered_map<std::string, std::shared_ptr<Group>> shares_;
+};
+
+/**
+ * @brief LoopbackAdapter delivers the messages published by the talents of a
+ * process to the matching subscriptions in the same process, without a
+ * broker and without serializing the payload more than once. It is built
+ * into the ProtocolGateway as the module "loopback" and understands MQTT
+ * wildcards and shared subscriptions. Messages are neither retained nor
+ * persisted.
+ */
+class LoopbackAdapter : public Adapter {
+   public:
+    /**
+     * @brief Construct a new LoopbackAdapter.
+     *
+     * @param name The name of the adapter
+     * @param is_platform_proto Whether the adapter speaks the platform protocol
+     * @param config The adapter configuration: optionally "bus", the name of
+     * the bus to connect to (default "default"), "topicNamespace" (default
+     * "iotea/") and "receiveBatchSize", the maximum number of messages
+     * delivered between two checks for Stop() (default 64).
+     */
+    LoopbackAdapter(const std::string& name, bool is_platform_proto, const json& config = json::object());
+
+    // Adapter
+    void Start() override;
+    void Stop() override;
+    bool Publish(const std::string& topic, const std::string& data, const PublishOptions& opts) override;
+    void Subscribe(const std::string& topic, on_msg_func_ptr on_msg, const SubscribeOptions& opts) override;
+    void SubscribeShared(const std::string& group, const std::string& topic, on_msg_func_ptr on_msg, const SubscribeOptions& opts) override;
+    void SubscribePayload(const std::string& topic, on_payload_func_ptr on_msg, const SubscribeOptions& opts) override;
+    void SubscribeSharedPayload(const std::string& group, const std::string& topic, on_payload_func_ptr on_msg, const SubscribeOptions& opts) override;
+
+    /**
+     * @brief Publish a payload without copying it.
+     *
+     * @param topic The topic to publish to
+     * @param payload The payload
+     */
+    void Publish(const std::string& topic, const payload_ptr& payload);
+
+   private:
+    static constexpr size_t DEFAULT_RECEIVE_BATCH_SIZE = 64;
+
+    std::shared_ptr<LoopbackBus> bus_;
+    std::string topic_ns_;
+    size_t batch_size_;
+
+    LoopbackBus::inbox_ptr inbox_;
+    std::atomic<bool> stopped_{false};
+};
+
+}  // namespace core
+}  // namespace iotea
+
+#endif // SRC_SDK_CPP_LIB_INCLUDE_LOOPBACK_ADAPTER_HPP_
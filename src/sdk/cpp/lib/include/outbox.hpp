@@ -0,0 +1,112 @@
+/*****************************************************************************
+ * Copyright (c) 2021 Bosch.IO GmbH
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * SPDX-License-Identifier: MPL-2.0
+ ****************************************************************************/
+
+#ifndef SRC_SDK_CPP_LIB_INCLUDE_OUTBOX_HPP_
+#define SRC_SDK_CPP_LIB_INCLUDE_OUTBOX_HPP_
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "protocol_gateway.hpp"
+#include "publisher.hpp"
+
+namespace iotea {
+namespace core {
+
+/**
+ * @brief Outbox coalesces the serialized events and function replies sent
+ * to the platform into JSON arrays, which the platform ingests like the
+ * individual messages. The messages of each return topic are published as
+ * one array once max_events of them are pending or the oldest of them has
+ * been pending for max_delay_ms, whichever comes first. A batch of a single
+ * message is published as is. Should not be used by external clients.
+ */
+class Outbox {
+   public:
+    /**
+     * @brief Construct a new Outbox.
+     *
+     * @param gateway The gateway to publish with
+     * @param max_events The maximum number of messages per array
+     * @param max_delay_ms The maximum time a message is held back in ms
+     */
+    Outbox(gateway_ptr gateway, size_t max_events, int64_t max_delay_ms);
+
+    /**
+     * @brief Hand the arrays to a Publisher instead of publishing them with
+     * the gateway. Must be called before the first message is posted.
+     *
+     * @param publisher The Publisher or nullptr
+     */
+    void SetPublisher(publisher_ptr publisher);
+
+    /**
+     * @brief Queue a message, publishing the pending messages of the topic
+     * if max_events are reached.
+     *
+     * @param topic The topic to publish to
+     * @param msg A serialized JSON object
+     * @return PublishStatus The status of publishing the array, OK if the
+     * message is still pending
+     */
+    PublishStatus Post(const std::string& topic, const std::string& msg);
+
+    /**
+     * @brief Publish the messages of all topics whose oldest message has been
+     * pending for max_delay_ms.
+     *
+     * @param now_ms The current time in ms since the epoch
+     */
+    void FlushExpired(int64_t now_ms);
+
+    /**
+     * @brief Publish all pending messages.
+     */
+    void Flush();
+
+    /**
+     * @brief Get the maximum time a message is held back.
+     *
+     * @return int64_t The time in ms
+     */
+    int64_t GetMaxDelay() const;
+
+   private:
+    struct Pending {
+        std::string msgs;  // Comma separated
+        size_t count = 0;
+        int64_t since_ms = 0;
+    };
+
+    // Move the pending messages of a topic into entries_
+    void Take(const std::string& topic, Pending& pending);
+    PublishStatus PublishTaken();
+
+    gateway_ptr gateway_;
+    publisher_ptr publisher_;
+    size_t max_events_;
+    int64_t max_delay_ms_;
+
+    // Held while publishing to keep the order of the arrays of a topic
+    std::mutex mutex_;
+    std::unordered_map<std::string, Pending> pending_;
+    std::vector<PublishEntry> entries_;
+};
+
+using outbox_ptr = std::shared_ptr<Outbox>;
+
+}  // namespace core
+}  // namespace iotea
+
+#endif // SRC_SDK_CPP_LIB_INCLUDE_OUTBOX_HPP_
@@ -11,13 +11,17 @@
 #ifndef SRC_SDK_CPP_LIB_INCLUDE_PROTOCOL_GATEWAY_HPP_
 #define SRC_SDK_CPP_LIB_INCLUDE_PROTOCOL_GATEWAY_HPP_
 
+#include <array>
 #include <functional>
 #include <memory>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 #include "nlohmann/json.hpp"
 
+#include "interface.hpp"
+
 using json = nlohmann::json;
 
 namespace iotea {
@@ -53,9 +57,9 @@ class PubSubOptions {
     /**
      * @brief Get the ID of the adapter configured for this option.
      *
-     * @return std::string
+     * @return const std::string&
      */
-    virtual std::string GetAdapterId() const;
+    virtual const std::string& GetAdapterId() const;
 
     /**
      * @brief Compare this PubSubOptions to another.
@@ -77,6 +81,11 @@ class PubSubOptions {
  */
 class PublishOptions : public PubSubOptions {
    public:
+    /**
+     * @brief Use the QoS configured for the adapter.
+     */
+    static constexpr int DEFAULT_QOS = -1;
+
     /**
      * @brief Construct a new PublishOptions.
      *
@@ -84,8 +93,9 @@ class PublishOptions : public PubSubOptions {
      * platform protocol adapters.
      * @param adapter_id The id of the adapter to apply the option to or and
      * empty string to apply the option to all adapters.
+     * @param qos The quality of service to publish with or DEFAULT_QOS.
      */
-    PublishOptions(bool platform_proto_only, const std::string& adapter_id);
+    PublishOptions(bool platform_proto_only, const std::string& adapter_id, int qos = DEFAULT_QOS);
 
     virtual ~PublishOptions() = default;
 
@@ -103,6 +113,13 @@ class PublishOptions : public PubSubOptions {
      */
     virtual bool Stash() const;
 
+    /**
+     * @brief Get the quality of service of this option.
+     *
+     * @return int The QoS or DEFAULT_QOS
+     */
+    virtual int Qos() const;
+
     /**
      * @brief Compare this PublishOptions to another.
      *
@@ -114,6 +131,7 @@ class PublishOptions : public PubSubOptions {
    private:
     bool retain_;
     bool stash_;
+    int qos_;
 };
 
 /**
@@ -144,11 +162,26 @@ class SubscribeOptions : public PubSubOptions {
     virtual bool operator==(const SubscribeOptions& other) const;
 };
 
+/**
+ * @brief PublishEntry is a single message of a batch passed to
+ * ProtocolGateway::PublishBatch.
+ */
+struct PublishEntry {
+    std::string topic;
+    std::string msg;
+    PublishOptions opts;
+};
+
 using on_msg_func_ptr = std::function<void(
     const std::string&, // topic
     const std::string&, // message
     const std::string&)>; // adapter id
 
+using on_payload_func_ptr = std::function<void(
+    const std::string&, // topic
+    const payload_ptr&, // message
+    const std::string&)>; // adapter id
+
 /**
  * @brief Adapter describes the interface of protocol adapters.
  */
@@ -180,12 +213,14 @@ class Adapter {
     virtual bool IsPlatformProto() const;
 
     /**
-     * @brief Start the Adapter.
+     * @brief Start the Adapter. May block until Stop() is called, the
+     * ProtocolGateway runs each Adapter on its own thread.
      */
     virtual void Start() {};
 
     /**
-     * @brief Stop the Adapter.
+     * @brief Stop the Adapter. May be called before Start() and from any
+     * thread, including the one handling a received message.
      */
     virtual void Stop() {};
 
@@ -195,8 +230,21 @@ class Adapter {
      * @param topic The topic to publish to.
      * @param msg The message to publish.
      * @param opts Options to pass along to the Adapter.
+     * @return bool false if the Adapter rejected the message, e.g. because
+     * too many messages are waiting to be acknowledged.
+     */
+    virtual bool Publish(const std::string& topic, const std::string& msg, const PublishOptions& opts) = 0;
+
+    /**
+     * @brief Publish several messages to the Adapter in order. Adapters
+     * that can pipeline the messages should override this, the default
+     * calls Publish() for each of them.
+     *
+     * @param entries The first message to publish.
+     * @param count The number of messages to publish.
+     * @return bool false if the Adapter rejected any of the messages.
      */
-    virtual void Publish(const std::string& topic, const std::string& msg, const PublishOptions& opts) = 0;
+    virtual bool PublishBatch(const PublishEntry* entries, size_t count);
 
     /**
      * @brief Subscribe to messages from the Adapter
@@ -218,6 +266,31 @@ class Adapter {
      */
     virtual void SubscribeShared(const std::string& group, const std::string& topic, on_msg_func_ptr on_msg, const SubscribeOptions& opts) = 0;
 
+    /**
+     * @brief Subscribe to messages from the Adapter, receiving the payload as
+     * a payload_ptr that can be kept without copying. Adapters that own
+     * their receive buffers should override this, the default copies the
+     * payload of Subscribe().
+     *
+     * @param topic The topic to subscribe to.
+     * @param on_msg A callback function to call when a message matching the
+     * subcription arrives.
+     * @param opts Options to pass along to the Adapter.
+     */
+    virtual void SubscribePayload(const std::string& topic, on_payload_func_ptr on_msg, const SubscribeOptions& opts);
+
+    /**
+     * @brief Subscribe to shared messages from the Adapter, receiving the
+     * payload as a payload_ptr, see SubscribePayload().
+     *
+     * @param group The group to share the subscription with.
+     * @param topic The topic to subscribe to.
+     * @param on_msg A callback function to call when a message matching the
+     * subcription arrives.
+     * @param opts Options to pass along to the Adapter.
+     */
+    virtual void SubscribeSharedPayload(const std::string& group, const std::string& topic, on_payload_func_ptr on_msg, const SubscribeOptions& opts);
+
    protected:
     std::string name_;
     bool is_platform_proto_;
@@ -264,6 +337,11 @@ class ProtocolGatewayException : public std::exception {
     Code code_;
 };
 
+using adapter_loader_func_ptr = std::function<std::shared_ptr<Adapter>(
+    const std::string&, // name
+    bool, // is_platform_proto
+    const json&)>; // config
+
 /**
  * @brief The ProtocolGateway is an abstraction layer between the applications
  * and the transport protocol. It dynamically loads one or more Adapters that
@@ -295,8 +373,23 @@ class ProtocolGateway {
      * @param topic The topic to publish to.
      * @param msg The message to publish.
      * @param opts Options to pass along to the Adapters.
+     * @return bool false if any of the Adapters rejected the message.
+     */
+    virtual bool Publish(const std::string& topic, const std::string& msg, const PublishOptions& options = DefaultPublishOptions);
+
+    /**
+     * @brief Publish several messages to the Adapters. Each message is
+     * routed by its options like a message passed to
+     * ProtocolGateway::Publish(), consecutive messages routed to the same
+     * Adapters are handed to them as one batch. Every Adapter receives its
+     * messages in order.
+     * ProtocolGateway::Start() must be called before
+     * ProtocolGateway::PublishBatch().
+     *
+     * @param entries The messages to publish.
+     * @return bool false if any of the Adapters rejected any of the messages.
      */
-    virtual void Publish(const std::string& topic, const std::string& msg, const PublishOptions& options = DefaultPublishOptions);
+    virtual bool PublishBatch(const std::vector<PublishEntry>& entries);
 
     /**
      * @brief Subscribe to messages from the Adapters.
@@ -322,6 +415,33 @@ class ProtocolGateway {
      */
     virtual void SubscribeShared(const std::string& group, const std::string& topic, on_msg_func_ptr on_msg, const SubscribeOptions& opts = DefaultSubscribeOptions);
 
+    /**
+     * @brief Subscribe to messages from the Adapters, receiving the payload
+     * as a payload_ptr that can be kept without copying.
+     * ProtocolGateway::Start() must be called before
+     * ProtocolGateway::SubscribePayload().
+     *
+     * @param topic The topic to subscribe to.
+     * @param on_msg A callback function to call when a message matching the
+     * subcription arrives.
+     * @param opts Options to pass along to the Adapters.
+     */
+    virtual void SubscribePayload(const std::string& topic, on_payload_func_ptr on_msg, const SubscribeOptions& opts = DefaultSubscribeOptions);
+
+    /**
+     * @brief Subscribe to shared messages from the Adapters, receiving the
+     * payload as a payload_ptr that can be kept without copying.
+     * ProtocolGateway::Start() must be called before
+     * ProtocolGateway::SubscribeSharedPayload().
+     *
+     * @param group The group to share the subscription with.
+     * @param topic The topic to subscribe to.
+     * @param on_msg A callback function to call when a message matching the
+     * subcription arrives.
+     * @param opts Options to pass along to the Adapters.
+     */
+    virtual void SubscribeSharedPayload(const std::string& group, const std::string& topic, on_payload_func_ptr on_msg, const SubscribeOptions& opts = DefaultSubscribeOptions);
+
     /**
      * @brief Initialize the ProtocolGateway by loading all the Adapters listed
      * in the configuration. Throws ProtocolGatewayException if any of the
@@ -331,13 +451,16 @@ class ProtocolGateway {
 
     /**
      * @brief Start the ProtocolGateway. ProtocolGateway::Initialize() must be
-     * called before ProtocolGateway::Start().
+     * called before ProtocolGateway::Start(). The Adapters are started
+     * concurrently, each on its own thread, the first one on the calling
+     * thread. Blocks until all of them have stopped.
      */
     virtual void Start();
 
     /**
      * @brief Stop the ProtocolGateway.  ProtocolGateway::Start() must be
-     * called before ProtocolGateway::Stop().
+     * called before ProtocolGateway::Stop(). The Adapters are stopped
+     * concurrently, Stop() returns once all of them have been told to stop.
      */
     virtual void Stop();
 
@@ -353,6 +476,18 @@ class ProtocolGateway {
      */
     static json CreateConfig(json adaptor_configs);
 
+    /**
+     * @brief Register an Adapter that is linked into the application. Adapters
+     * configured with the module name are created by the loader instead of
+     * being loaded from a shared library. "loopback" is registered for the
+     * LoopbackAdapter.
+     *
+     * @param module_name The module name to register the loader for.
+     * @param load The loader, taking the same arguments as the "Load" symbol
+     * of a shared library Adapter.
+     */
+    static void Register(const std::string& module_name, adapter_loader_func_ptr load);
+
    protected:
     /**
      * @brief A contructor for tests only.
@@ -370,12 +505,23 @@ class ProtocolGateway {
 
 
    private:
-    bool IsValidOperation(std::shared_ptr<Adapter> adapter, const PubSubOptions& opts) const;
+    // The Adapters addressed by a set of options, indexed by whether only
+    // platform protocol Adapters are addressed
+    using route_t = std::array<std::vector<Adapter*>, 2>;
+
+    void RunConcurrently(const std::function<void(Adapter&)>& func);
+
+    const std::vector<Adapter*>& Route(const PubSubOptions& opts) const;
 
     json config_;
     std::string display_name_;
     bool platform_proto_only_;
     std::vector<std::shared_ptr<Adapter>> adapters_;
+
+    // Computed as the Adapters are added, the Adapters addressed by options
+    // without and with an adapter id
+    route_t all_routes_;
+    std::unordered_map<std::string, route_t> named_routes_;
 };
 
 using gateway_ptr = std::shared_ptr<ProtocolGateway>;
@@ -0,0 +1,227 @@
+/*****************************************************************************
+ * Copyright (c) 2021 Bosch.IO GmbH
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * SPDX-License-Identifier: MPL-2.0
+ ****************************************************************************/
+
+#ifndef SRC_SDK_CPP_LIB_INCLUDE_PUBLISHER_HPP_
+#define SRC_SDK_CPP_LIB_INCLUDE_PUBLISHER_HPP_
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "bounded_queue.hpp"
+#include "protocol_gateway.hpp"
+
+namespace iotea {
+namespace core {
+
+/**
+ * @brief The priority class of an outgoing message. Each class has its own
+ * queue and the queue of a higher priority is always drained first.
+ */
+enum class PublishPriority {
+    HIGH = 0,    // Function calls and replies
+    NORMAL = 1,  // Events
+};
+
+/**
+ * @brief The outcome of handing a message to the Publisher. The values are
+ * ordered by severity.
+ */
+enum class PublishStatus {
+    OK = 0,         // Queued or published
+    THROTTLED = 1,  // Queued after waiting for the queue to drain
+    DISPLACED = 2,  // Queued, the oldest queued message was dropped to make room
+    DROPPED = 3,    // Dropped, the queue is full or publishing failed
+};
+
+/**
+ * @brief PublisherOptions describes the queue of each priority class of the
+ * Publisher.
+ */
+class PublisherOptions {
+   public:
+    /**
+     * @brief What to do when a message is posted to a full queue.
+     */
+    enum class Overflow {
+        BLOCK,        // Wait for the publisher thread to make room
+        DROP_OLDEST,  // Drop the oldest queued message
+        DROP_NEWEST,  // Drop the posted message
+    };
+
+    static constexpr size_t DEFAULT_CAPACITY = 4096;
+
+    /**
+     * @brief Construct a new PublisherOptions. Each queue holds
+     * DEFAULT_CAPACITY messages and blocks when full.
+     */
+    PublisherOptions();
+
+    /**
+     * @brief Configure the queue of a priority class.
+     *
+     * @param priority The priority class
+     * @param capacity The maximum number of queued messages, rounded up to a
+     * power of two
+     * @param overflow What to do when the queue is full
+     * @return PublisherOptions&
+     */
+    PublisherOptions& SetQueue(PublishPriority priority, size_t capacity, Overflow overflow);
+
+    /**
+     * @brief Get the capacity of the queue of a priority class.
+     *
+     * @param priority The priority class
+     * @return size_t
+     */
+    size_t GetCapacity(PublishPriority priority) const;
+
+    /**
+     * @brief Get the overflow policy of the queue of a priority class.
+     *
+     * @param priority The priority class
+     * @return PublisherOptions::Overflow
+     */
+    Overflow GetOverflow(PublishPriority priority) const;
+
+   private:
+    struct Queue {
+        size_t capacity;
+        Overflow overflow;
+    };
+
+    Queue queues_[2];
+};
+
+/**
+ * @brief PublisherStats is a snapshot of the counters of a priority class.
+ */
+struct PublisherStats {
+    size_t queue_depth;
+    uint64_t published;
+    uint64_t throttled;  // Posts that waited for room
+    uint64_t displaced;  // Queued messages dropped by DROP_OLDEST
+    uint64_t dropped;    // Posted messages dropped by DROP_NEWEST
+};
+
+/**
+ * @brief Publisher moves publishing off the threads producing messages. Any
+ * thread posts messages to a lock-free queue per priority class, a single
+ * publisher thread drains the queues and publishes the messages in batches
+ * through the gateway. Messages of a priority class are published in the
+ * order they were posted. While the thread is not running messages are
+ * published right away on the posting thread. Should not be used by
+ * external clients.
+ */
+class Publisher {
+   public:
+    /**
+     * @brief Construct a new Publisher.
+     *
+     * @param gateway The gateway to publish with
+     * @param options The queue options
+     */
+    Publisher(gateway_ptr gateway, const PublisherOptions& options);
+
+    virtual ~Publisher();
+
+    /**
+     * @brief Start the publisher thread.
+     */
+    void Start();
+
+    /**
+     * @brief Stop the publisher thread. Messages already queued are published
+     * before Stop() returns.
+     */
+    void Stop();
+
+    /**
+     * @brief Post a message to the queue of its priority class, applying the
+     * overflow policy of the class if the queue is full.
+     *
+     * @param topic The topic to publish to
+     * @param msg The message
+     * @param priority The priority class
+     * @return PublishStatus
+     */
+    PublishStatus Post(const std::string& topic, const std::string& msg, PublishPriority priority = PublishPriority::NORMAL);
+
+    /**
+     * @brief Get a snapshot of the counters of each priority class, indexed
+     * by PublishPriority.
+     *
+     * @return std::vector<PublisherStats>
+     */
+    std::vector<PublisherStats> GetStats() const;
+
+   private:
+    static constexpr size_t MAX_BATCH_SIZE = 64;
+
+    struct Message {
+        std::string topic;
+        std::string msg;
+    };
+
+    struct Class {
+        Class(size_t capacity, PublisherOptions::Overflow overflow);
+
+        BoundedQueue<Message> queue;
+        const PublisherOptions::Overflow overflow;
+
+        std::atomic<uint64_t> published{0};
+        std::atomic<uint64_t> throttled{0};
+        std::atomic<uint64_t> displaced{0};
+        std::atomic<uint64_t> dropped{0};
+    };
+
+    void Run();
+
+    // Wait until the message fits into the queue of a BLOCK class
+    PublishStatus PushBlocking(Class& c, Message& message);
+
+    // Take up to MAX_BATCH_SIZE entries, the higher priorities first
+    void Drain(std::vector<PublishEntry>& batch);
+    void Publish(std::vector<PublishEntry>& batch);
+
+    void WakeConsumer();
+    void WakeProducers();
+    bool IsEmpty() const;
+
+    gateway_ptr gateway_;
+    std::vector<std::unique_ptr<Class>> classes_;
+
+    std::atomic_bool running_;
+    std::atomic<size_t> producers_;  // Posting right now
+    std::mutex start_mutex_;
+    std::thread thread_;
+
+    // The publisher thread sleeps on cv_ while the queues are empty
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::atomic_bool sleeping_;
+
+    // Producers of BLOCK classes wait on space_cv_ while their queue is full
+    std::mutex space_mutex_;
+    std::condition_variable space_cv_;
+    std::atomic<size_t> waiters_;
+};
+
+using publisher_ptr = std::shared_ptr<Publisher>;
+
+}  // namespace core
+}  // namespace iotea
+
+#endif // SRC_SDK_CPP_LIB_INCLUDE_PUBLISHER_HPP_
@@ -0,0 +1,146 @@
+/*****************************************************************************
+ * Copyright (c) 2021 Bosch.IO GmbH
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * SPDX-License-Identifier: MPL-2.0
+ ****************************************************************************/
+
+#ifndef SRC_SDK_CPP_LIB_INCLUDE_RAW_JSON_HPP_
+#define SRC_SDK_CPP_LIB_INCLUDE_RAW_JSON_HPP_
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "nlohmann/json.hpp"
+
+#include "interface.hpp"
+
+using json = nlohmann::json;
+
+namespace iotea {
+namespace core {
+
+/**
+ * @brief RawJsonObject keeps the text of a JSON object and an index of its
+ * top level members without decoding them. The text is shared rather than
+ * copied, e.g. with the buffer a message was received into, and the members
+ * are indexed by their offsets within it. Nested values are skipped by
+ * matching brackets and quotes but not validated, decoding a member may
+ * therefore still fail. Should not be used by external clients.
+ */
+class RawJsonObject {
+   public:
+    /**
+     * @brief The location of a member within the text.
+     */
+    struct Member {
+        size_t key_pos;
+        size_t key_size;
+        size_t value_pos;
+        size_t value_size;
+    };
+
+    RawJsonObject() = default;
+
+    /**
+     * @brief Index the members of a JSON object held in a shared buffer. The
+     * buffer is kept, not copied.
+     *
+     * @param text The JSON text
+     */
+    explicit RawJsonObject(payload_ptr text);
+
+    /**
+     * @brief Index the members of a JSON object, taking ownership of the
+     * text. Meant for tests and callers that own their buffer, received
+     * payloads should be passed as payload_ptr.
+     *
+     * @param text The JSON text
+     */
+    explicit RawJsonObject(std::string text);
+
+    /**
+     * @brief Return whether the text is a well formed JSON object at the top
+     * level.
+     *
+     * @return bool
+     */
+    bool IsValid() const;
+
+    /**
+     * @brief Get the JSON text.
+     *
+     * @return const std::string&
+     */
+    const std::string& GetText() const;
+
+    /**
+     * @brief Get the buffer holding the JSON text.
+     *
+     * @return const payload_ptr&
+     */
+    const payload_ptr& GetPayload() const;
+
+    /**
+     * @brief Find a member. Keys containing escape sequences are compared
+     * verbatim.
+     *
+     * @param key The key of the member
+     * @return A pointer to the member or nullptr if there is no such member
+     */
+    const Member* Find(const std::string& key) const;
+
+    /**
+     * @brief Decode a member. Throws json::parse_error if the value is
+     * malformed.
+     *
+     * @param key The key of the member
+     * @return json The value or null if there is no such member
+     */
+    json Decode(const std::string& key) const;
+
+    /**
+     * @brief Decode a member. Throws json::parse_error if the value is
+     * malformed.
+     *
+     * @param member The member
+     * @return json
+     */
+    json Decode(const Member& member) const;
+
+    /**
+     * @brief Decode a string member. Strings without escape sequences are
+     * copied from the text directly. Throws json::type_error if the value is
+     * not a string.
+     *
+     * @param member The member
+     * @return std::string
+     */
+    std::string DecodeString(const Member& member) const;
+
+    /**
+     * @brief Decode an integer member. Throws json::type_error if the value
+     * is not a number.
+     *
+     * @param member The member
+     * @return int64_t
+     */
+    int64_t DecodeInt(const Member& member) const;
+
+   private:
+    void Index();
+
+    payload_ptr text_;
+    std::vector<Member> members_;
+    bool valid_ = false;
+};
+
+}  // namespace core
+}  // namespace iotea
+
+#endif // SRC_SDK_CPP_LIB_INCLUDE_RAW_JSON_HPP_
@@ -0,0 +1,208 @@
+/*****************************************************************************
+ * Copyright (c) 2021 Bosch.IO GmbH
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * SPDX-License-Identifier: MPL-2.0
+ ****************************************************************************/
+
+#ifndef SRC_SDK_CPP_LIB_INCLUDE_SERIALIZER_HPP_
+#define SRC_SDK_CPP_LIB_INCLUDE_SERIALIZER_HPP_
+
+#include <cstdint>
+#include <string>
+#include <type_traits>
+
+#include "nlohmann/json.hpp"
+
+using json = nlohmann::json;
+
+namespace iotea {
+namespace core {
+
+/**
+ * @brief ScopedBuffer lends the calling thread a cleared string to build an
+ * outgoing message in. The strings are kept per thread and reused so that
+ * their memory is only allocated once. Nested ScopedBuffers on the same
+ * thread receive distinct strings. Should not be used by external clients.
+ */
+class ScopedBuffer {
+   public:
+    ScopedBuffer();
+    ~ScopedBuffer();
+
+    ScopedBuffer(const ScopedBuffer&) = delete;
+    ScopedBuffer& operator=(const ScopedBuffer&) = delete;
+
+    std::string& Get();
+
+   private:
+    std::string* buffer_;
+};
+
+/**
+ * @brief JsonWriter appends JSON to a string without building a json DOM
+ * first. The output is identical to json::dump() provided that the members
+ * of each object are written in the sorted order in which nlohmann::json
+ * keeps them. Strings are expected to be valid UTF-8. Should not be used by
+ * external clients.
+ */
+class JsonWriter {
+   public:
+    /**
+     * @brief Construct a new JsonWriter.
+     *
+     * @param out The string to append to
+     */
+    explicit JsonWriter(std::string& out);
+
+    void BeginObject();
+    void EndObject();
+    void BeginArray();
+    void EndArray();
+
+    /**
+     * @brief Write the key of the next member of the current object.
+     *
+     * @param key The key, written without escaping
+     */
+    void Key(const char* key);
+
+    /**
+     * @brief Write a string concatenated from several parts.
+     *
+     * @param parts Any number of std::string or const char*
+     */
+    template <typename... Parts>
+    void String(const Parts&... parts) {
+        Separate();
+        out_.push_back('"');
+        // Expands to one Escape() call per part
+        int expand[] = {0, (Escape(parts), 0)...};
+        (void)expand;
+        out_.push_back('"');
+    }
+
+    void Int(int64_t value);
+    void Bool(bool value);
+    void Json(const json& value);
+
+    /**
+     * @brief Write a value. Strings, booleans and integers are written
+     * directly, other types are converted with nlohmann::json's to_json().
+     *
+     * @param value The value
+     */
+    template <typename T>
+    void Value(const T& value) {
+        WriteValue(value, std::integral_constant<bool, std::is_integral<T>::value && !std::is_same<T, bool>::value>{});
+    }
+
+    void Value(const json& value) { Json(value); }
+    void Value(const std::string& value) { String(value); }
+    void Value(const char* value) { String(value); }
+    void Value(bool value) { Bool(value); }
+
+   private:
+    template <typename T>
+    void WriteValue(const T& value, std::true_type /* integral */) {
+        if (std::is_signed<T>::value) {
+            Int(static_cast<int64_t>(value));
+        } else {
+            Json(json(value));
+        }
+    }
+
+    template <typename T>
+    void WriteValue(const T& value, std::false_type /* integral */) {
+        Json(json(value));
+    }
+
+    void Separate();
+    void Escape(const std::string& s);
+    void Escape(const char* s);
+    void Escape(const char* s, size_t size);
+
+    std::string& out_;
+
+    // One bit per nesting level, set once the level has a first element
+    uint64_t has_elements_ = 0;
+    int depth_ = 0;
+    bool after_key_ = false;
+};
+
+/**
+ * @brief Serialize an outgoing event. Equivalent to
+ * OutgoingEvent<T>{...}.Json().dump() without copying the value.
+ *
+ * @param out The string to append to
+ * @param subject The name of the subject
+ * @param feature The name of the feature
+ * @param value The value of the event
+ * @param type The name of the type
+ * @param instance The name of the instance
+ * @param when The time since the epoch in ms
+ */
+template <typename T>
+void SerializeEvent(std::string& out, const std::string& subject, const std::string& feature, const T& value,
+                    const std::string& type, const std::string& instance, int64_t when) {
+    JsonWriter w{out};
+    w.BeginObject();
+    w.Key("feature");
+    w.String(feature);
+    w.Key("instance");
+    w.String(instance);
+    w.Key("subject");
+    w.String(subject);
+    w.Key("type");
+    w.String(type);
+    w.Key("value");
+    w.Value(value);
+    w.Key("whenMs");
+    w.Int(when);
+    w.EndObject();
+}
+
+/**
+ * @brief Serialize an outgoing call. Equivalent to OutgoingCall{...}.Json().dump().
+ *
+ * @param out The string to append to
+ * @param talent_id The ID of the Talent providing the function
+ * @param channel_id The ID of the channel of the caller
+ * @param call_id The ID of the call
+ * @param func The name of the function
+ * @param args The arguments, wrapped in an array unless already an array
+ * @param subject The name of the subject
+ * @param type The name of the type associated with the function
+ * @param timeout The number of ms to wait for a reply
+ * @param when The time since the epoch in ms
+ */
+void SerializeCall(std::string& out, const std::string& talent_id, const std::string& channel_id,
+                   const std::string& call_id, const std::string& func, const json& args, const std::string& subject,
+                   const std::string& type, int64_t timeout, int64_t when);
+
+/**
+ * @brief Serialize the reply to a call, i.e. an outgoing event of the feature
+ * "<talent_id>.<feature>" carrying the result.
+ *
+ * @param out The string to append to
+ * @param talent_id The ID of the replying Talent
+ * @param feature The name of the function
+ * @param channel_id The channel ID of the call
+ * @param call_id The ID of the call
+ * @param value The result of the call
+ * @param subject The name of the subject
+ * @param type The name of the type
+ * @param instance The name of the instance
+ * @param when The time since the epoch in ms
+ */
+void SerializeReply(std::string& out, const std::string& talent_id, const std::string& feature,
+                    const std::string& channel_id, const std::string& call_id, const json& value,
+                    const std::string& subject, const std::string& type, const std::string& instance, int64_t when);
+
+}  // namespace core
+}  // namespace iotea
+
+#endif // SRC_SDK_CPP_LIB_INCLUDE_SERIALIZER_HPP_
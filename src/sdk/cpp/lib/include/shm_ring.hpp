@@ -0,0 +1,114 @@
+/*****************************************************************************
+ * Copyright (c) 2021 Bosch.IO GmbH
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * SPDX-License-Identifier: MPL-2.0
+ ****************************************************************************/
+
+#ifndef SRC_SDK_CPP_LIB_INCLUDE_SHM_RING_HPP_
+#define SRC_SDK_CPP_LIB_INCLUDE_SHM_RING_HPP_
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace iotea {
+namespace core {
+
+/**
+ * @brief ShmRing is a ring of variable sized messages in memory shared
+ * between processes, e.g. a POSIX shared memory object. Any number of
+ * threads and processes may push messages, a single consumer pops them.
+ * Producers are serialized by a robust process-shared mutex so that a
+ * producer dying while pushing does not block the others. The consumer
+ * sleeps on a futex while the ring is empty. ShmRing does not own the
+ * memory and should not be used by external clients.
+ */
+class ShmRing {
+   public:
+    /**
+     * @brief Get the size of the memory needed for a ring.
+     *
+     * @param capacity The number of bytes available for messages
+     * @return size_t
+     */
+    static size_t Size(size_t capacity);
+
+    /**
+     * @brief Create an empty ring in memory of the given size, e.g. a shared
+     * memory object. Must not be called while the memory is in use.
+     *
+     * @param mem The memory
+     * @param size The size of the memory, see Size()
+     * @return true if the ring was created
+     */
+    bool Create(void* mem, size_t size);
+
+    /**
+     * @brief Attach to a ring created by another process.
+     *
+     * @param mem The memory
+     * @param size The size of the memory
+     * @return false if the memory does not hold a ring (yet)
+     */
+    bool Attach(void* mem, size_t size);
+
+    /**
+     * @brief Push a message and wake the consumer. May be called by any
+     * thread of any process.
+     *
+     * @param tag A number passed along with the message
+     * @param topic The topic
+     * @param payload The payload
+     * @param payload_size The size of the payload
+     * @return false if the ring is full and the message was dropped
+     */
+    bool Push(uint32_t tag, const std::string& topic, const char* payload, size_t payload_size);
+
+    /**
+     * @brief Pop the oldest message. Must only be called by the consumer.
+     *
+     * @param tag The tag of the message
+     * @param topic The string to read the topic into
+     * @param payload The string to read the payload into
+     * @return false if the ring is empty
+     */
+    bool Pop(uint32_t& tag, std::string& topic, std::string& payload);
+
+    /**
+     * @brief Wait until the ring is not empty, Wake() is called or the
+     * timeout expires. Must only be called by the consumer.
+     *
+     * @param timeout The maximum time to wait
+     * @return true if the ring is not empty
+     */
+    bool Wait(std::chrono::milliseconds timeout);
+
+    /**
+     * @brief Make a waiting (or the next) Wait() return.
+     */
+    void Wake();
+
+    /**
+     * @brief Get the number of messages dropped because the ring was full.
+     *
+     * @return uint64_t
+     */
+    uint64_t Dropped() const;
+
+   private:
+    struct Header;
+
+    char* Data() const;
+
+    Header* header_ = nullptr;
+};
+
+}  // namespace core
+}  // namespace iotea
+
+#endif // SRC_SDK_CPP_LIB_INCLUDE_SHM_RING_HPP_
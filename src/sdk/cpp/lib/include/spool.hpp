@@ -0,0 +1,120 @@
+/*****************************************************************************
+ * Copyright (c) 2021 Bosch.IO GmbH
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * SPDX-License-Identifier: MPL-2.0
+ ****************************************************************************/
+
+#ifndef SRC_SDK_CPP_LIB_INCLUDE_SPOOL_HPP_
+#define SRC_SDK_CPP_LIB_INCLUDE_SPOOL_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace iotea {
+namespace core {
+
+/**
+ * @brief SpoolRecord is a message kept in a Spool.
+ */
+struct SpoolRecord {
+    std::string topic;
+    std::string payload;
+    int qos = 0;
+    bool retain = false;
+};
+
+/**
+ * @brief Spool stores messages in a memory-mapped file of fixed size until
+ * they can be published. Records are appended to a ring inside the file;
+ * when the ring is full the oldest records are dropped to make room. An
+ * existing spool file is reused if it was created with the same capacity so
+ * that spooled messages survive a restart. Spool is not thread safe and
+ * should not be used by external clients.
+ */
+class Spool {
+   public:
+    Spool() = default;
+    ~Spool();
+
+    Spool(const Spool&) = delete;
+    Spool& operator=(const Spool&) = delete;
+
+    /**
+     * @brief Open or create a spool file.
+     *
+     * @param path The path of the file
+     * @param capacity The number of bytes available for records
+     * @return true if the spool was opened
+     */
+    bool Open(const std::string& path, size_t capacity);
+
+    /**
+     * @brief Unmap and close the spool file.
+     */
+    void Close();
+
+    bool IsOpen() const;
+
+    /**
+     * @brief Append a message, dropping the oldest messages if the spool is
+     * full.
+     *
+     * @param topic The topic of the message
+     * @param payload The payload of the message
+     * @param qos The QoS to publish the message with
+     * @param retain Whether to retain the message
+     * @return false if the spool is closed or the message can never fit
+     */
+    bool Append(const std::string& topic, const std::string& payload, int qos, bool retain);
+
+    /**
+     * @brief Read the oldest message without removing it.
+     *
+     * @param record The record to read into, its strings are reused
+     * @return false if the spool is empty
+     */
+    bool Peek(SpoolRecord& record) const;
+
+    /**
+     * @brief Remove the oldest message.
+     */
+    void Pop();
+
+    /**
+     * @brief Get the number of spooled messages.
+     *
+     * @return uint64_t
+     */
+    uint64_t Count() const;
+
+    /**
+     * @brief Get the number of messages dropped to make room since the spool
+     * file was created.
+     *
+     * @return uint64_t
+     */
+    uint64_t Dropped() const;
+
+   private:
+    struct Header;
+
+    void Reset();
+    void Normalize();
+    void DropOldest();
+    char* Data() const;
+
+    int fd_ = -1;
+    void* map_ = nullptr;
+    size_t map_size_ = 0;
+    Header* header_ = nullptr;
+};
+
+}  // namespace core
+}  // namespace iotea
+
+#endif // SRC_SDK_CPP_LIB_INCLUDE_SPOOL_HPP_
@@ -13,11 +13,13 @@
 
 #include <functional>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 #include "event.hpp"
 #include "call.hpp"
 #include "context.hpp"
+#include "emit_shaper.hpp"
 
 using iotea::core::logging::Logger;
 using iotea::core::logging::NamedLogger;
@@ -31,6 +33,17 @@ using on_event_func_ptr = std::function<void(event_ptr, event_ctx_ptr)>;
 
 using function_map = std::unordered_map<std::string, func_ptr>;
 
+/**
+ * @brief FunctionEntry describes a function provided by a FunctionTalent.
+ */
+struct FunctionEntry {
+    std::string name;
+    std::string output_feature;
+    func_ptr func;
+};
+
+using function_index = std::unordered_map<std::string, FunctionEntry>;
+
 /**
  * @brief A Talent is the base class for producers and consumers of events.
  *
@@ -277,6 +290,14 @@ class Talent {
      */
     NamedLogger GetLogger() const;
 
+    /**
+     * @brief Get the emit policies of the output features. Should not be
+     * used by external subclasses.
+     *
+     * @return const std::unordered_map<std::string, EmitPolicy>&
+     */
+    const std::unordered_map<std::string, EmitPolicy>& GetEmitPolicies() const;
+
    protected:
     std::vector<Callee> callees_;
     schema::Talent schema_;
@@ -290,6 +311,21 @@ class Talent {
      */
     virtual void AddOutput(const std::string& feature, const schema::Metadata& metadata);
 
+    /**
+     * @brief Register a feature provided by the Talent whose events are
+     * shaped by a policy before they are sent.
+     *
+     * @code
+       // Send the latest temperature at most once a second
+       AddOutput("temperature", metadata, EmitPolicy{}.Conflate(1000));
+     * @endcode
+     *
+     * @param feature The name of the feature
+     * @param metadata A description of the feature
+     * @param policy The policy to apply to the emitted events
+     */
+    virtual void AddOutput(const std::string& feature, const schema::Metadata& metadata, const EmitPolicy& policy);
+
     /**
      * @brief Create a new EventContext. Used for emitting the first event or
      * making the first function call in a context. If a new event is emitted
@@ -316,6 +352,7 @@ class Talent {
     context_generator_func_ptr context_gen_;
     uuid_generator_func_ptr uuid_gen_;
     schema::rule_ptr rules_ = nullptr;
+    std::unordered_map<std::string, EmitPolicy> emit_policies_;
 };
 
 /**
@@ -325,6 +362,7 @@ class Talent {
 class FunctionTalent : public Talent {
    private:
     function_map funcs_;
+    function_index index_;
 
    protected:
     /**
@@ -364,9 +402,19 @@ class FunctionTalent : public Talent {
     /**
      * @brief Get the functions provided functions.
      *
-     * @return function_map
+     * @return const function_map&
+     */
+    const function_map& GetFunctions() const;
+
+    /**
+     * @brief Find the function called by an event with the given feature,
+     * i.e. "<talent-id>.<function>-in".
+     *
+     * @param feature The name of the input feature
+     * @return const FunctionEntry* The function or nullptr if the feature
+     * does not refer to a function of this Talent
      */
-    function_map GetFunctions() const;
+    const FunctionEntry* FindFunction(const std::string& feature) const;
 };
 
 
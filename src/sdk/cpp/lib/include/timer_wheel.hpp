@@ -0,0 +1,129 @@
+/*****************************************************************************
+ * Copyright (c) 2021 Bosch.IO GmbH
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * SPDX-License-Identifier: MPL-2.0
+ ****************************************************************************/
+
+#ifndef SRC_SDK_CPP_LIB_INCLUDE_TIMER_WHEEL_HPP_
+#define SRC_SDK_CPP_LIB_INCLUDE_TIMER_WHEEL_HPP_
+
+#include <array>
+#include <cstdint>
+#include <list>
+#include <unordered_map>
+#include <vector>
+
+namespace iotea {
+namespace core {
+
+using timer_id_t = uint64_t;
+
+/**
+ * @brief TimerWheel is a hierarchical timing wheel keeping track of
+ * deadlines with a fixed resolution. Scheduling and cancelling a timer is
+ * O(1) and advancing the wheel costs O(1) per elapsed tick plus the number
+ * of expired timers. Timers never expire early and at most one resolution
+ * late. TimerWheel is not thread safe and should not be used by external
+ * clients.
+ */
+class TimerWheel {
+   public:
+    /**
+     * @brief Construct a new TimerWheel.
+     *
+     * @param resolution_ms The length of a tick in ms
+     */
+    explicit TimerWheel(int64_t resolution_ms);
+
+    /**
+     * @brief Change the resolution. Scheduled timers are kept.
+     *
+     * @param resolution_ms The length of a tick in ms
+     */
+    void SetResolution(int64_t resolution_ms);
+
+    /**
+     * @brief Get the resolution.
+     *
+     * @return int64_t The length of a tick in ms
+     */
+    int64_t GetResolution() const;
+
+    /**
+     * @brief Schedule a timer.
+     *
+     * @param deadline_ms The time in ms at which the timer expires
+     * @return timer_id_t The ID of the timer
+     */
+    timer_id_t Schedule(int64_t deadline_ms);
+
+    /**
+     * @brief Cancel a timer.
+     *
+     * @param id The ID of the timer
+     * @return true if the timer was pending
+     */
+    bool Cancel(timer_id_t id);
+
+    /**
+     * @brief Advance the wheel to the given time and remove the expired
+     * timers. The first call determines the starting point of the wheel,
+     * time must not go backwards after that.
+     *
+     * @param now_ms The current time in ms
+     * @return std::vector<timer_id_t> The IDs of the expired timers
+     */
+    std::vector<timer_id_t> Advance(int64_t now_ms);
+
+    /**
+     * @brief Get the number of pending timers.
+     *
+     * @return size_t
+     */
+    size_t Size() const;
+
+   private:
+    static constexpr size_t LEVELS = 4;
+    static constexpr size_t SLOT_BITS = 6;
+    static constexpr size_t SLOTS = 1 << SLOT_BITS;
+    static constexpr int64_t SLOT_MASK = SLOTS - 1;
+
+    struct Timer {
+        timer_id_t id;
+        int64_t deadline_ms;
+        int64_t expires;
+    };
+
+    using slot_t = std::list<Timer>;
+
+    struct Location {
+        slot_t* slot;
+        slot_t::iterator it;
+    };
+
+    int64_t ToTick(int64_t deadline_ms) const;
+    slot_t* SlotFor(int64_t expires);
+    void Place(slot_t& from, slot_t::iterator it);
+    void Cascade(size_t level);
+
+    int64_t resolution_ms_;
+    bool started_ = false;
+    int64_t current_ = 0;
+    timer_id_t next_id_ = 0;
+
+    // Timers scheduled before the first Advance() or already due
+    slot_t unplaced_;
+    slot_t due_;
+
+    std::array<std::array<slot_t, SLOTS>, LEVELS> wheel_;
+    std::unordered_map<timer_id_t, Location> timers_;
+};
+
+}  // namespace core
+}  // namespace iotea
+
+#endif // SRC_SDK_CPP_LIB_INCLUDE_TIMER_WHEEL_HPP_
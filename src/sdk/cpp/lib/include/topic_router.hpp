@@ -0,0 +1,113 @@
+/*****************************************************************************
+ * Copyright (c) 2021 Bosch.IO GmbH
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * SPDX-License-Identifier: MPL-2.0
+ ****************************************************************************/
+
+#ifndef SRC_SDK_CPP_LIB_INCLUDE_TOPIC_ROUTER_HPP_
+#define SRC_SDK_CPP_LIB_INCLUDE_TOPIC_ROUTER_HPP_
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+namespace iotea {
+namespace core {
+
+/**
+ * @brief TopicSlice is a non-owning reference to a part of a topic.
+ */
+struct TopicSlice {
+    const char* data = nullptr;
+    size_t size = 0;
+
+    TopicSlice() = default;
+    TopicSlice(const char* d, size_t s);
+    explicit TopicSlice(const std::string& s);
+
+    bool Empty() const;
+    std::string ToString() const;
+    bool operator==(const TopicSlice& other) const;
+    bool operator==(const char* other) const;
+};
+
+/**
+ * @brief TopicSliceHash hashes the characters referenced by a TopicSlice.
+ */
+struct TopicSliceHash {
+    size_t operator()(const TopicSlice& s) const;
+};
+
+/**
+ * @brief TopicRoute is the result of resolving a topic with the TopicRouter.
+ * The slices refer to the resolved topic which must outlive the route. If the
+ * talent (or channel) is known to the router the corresponding pointers refer
+ * to strings owned by the router, otherwise they are nullptr.
+ */
+struct TopicRoute {
+    enum class Type {
+        UNKNOWN,
+        EVENT,
+        CALL_REPLY,
+        DISCOVER,
+        PLATFORM_EVENT,
+    };
+
+    Type type = Type::UNKNOWN;
+
+    const std::string* talent_id = nullptr;
+    const std::string* channel_id = nullptr;
+
+    TopicSlice talent;
+    TopicSlice channel;
+    TopicSlice call;
+};
+
+/**
+ * @brief TopicRouter classifies incoming topics and extracts the talent ID,
+ * channel ID and call ID from them. The topic is split into levels in a
+ * single backwards pass and the known talent and channel IDs are resolved
+ * with a hash lookup. Should not be used by external clients.
+ */
+class TopicRouter {
+   public:
+    /**
+     * @brief Make the router aware of a talent and its channel.
+     *
+     * @param talent_id The ID of the talent
+     * @param channel_id The ID of the talent's channel, i.e. "<talent-id>.<uuid>"
+     */
+    void AddTalent(const std::string& talent_id, const std::string& channel_id);
+
+    /**
+     * @brief Resolve a topic.
+     *
+     * @param topic The topic
+     * @return TopicRoute
+     */
+    TopicRoute Resolve(const std::string& topic) const;
+
+   private:
+    struct Entry {
+        std::string key;
+        std::string talent_id;
+        std::string channel_id;
+    };
+
+    using entry_map = std::unordered_map<TopicSlice, std::unique_ptr<Entry>, TopicSliceHash>;
+
+    static void Insert(entry_map& map, std::unique_ptr<Entry> entry);
+    static const Entry* Find(const entry_map& map, const TopicSlice& key);
+
+    entry_map talents_;
+    entry_map channels_;
+};
+
+}  // namespace core
+}  // namespace iotea
+
+#endif // SRC_SDK_CPP_LIB_INCLUDE_TOPIC_ROUTER_HPP_
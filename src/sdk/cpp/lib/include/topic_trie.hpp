@@ -0,0 +1,200 @@
+/*****************************************************************************
+ * Copyright (c) 2021 Bosch.IO GmbH
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * SPDX-License-Identifier: MPL-2.0
+ ****************************************************************************/
+
+#ifndef SRC_SDK_CPP_LIB_INCLUDE_TOPIC_TRIE_HPP_
+#define SRC_SDK_CPP_LIB_INCLUDE_TOPIC_TRIE_HPP_
+
+#include <cstring>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "topic_router.hpp"
+
+namespace iotea {
+namespace core {
+
+/**
+ * @brief TopicTrie maps MQTT topic filters to values and finds the values of
+ * all filters matching a topic in a single walk over the levels of the topic.
+ *
+ * '+' matches exactly one level and a trailing '#' matches the parent level
+ * and any number of levels below it. Shared subscriptions, i.e.
+ * "$share/<group>/<filter>", are stored under their filter. Wildcards in the
+ * first level do not match topics starting with '$'. Should not be used by
+ * external clients.
+ *
+ * @tparam T The type of the values
+ */
+template <typename T>
+class TopicTrie {
+   public:
+    /**
+     * @brief Add a value for a topic filter. A filter may be added several
+     * times, each of its values is reported on a match.
+     *
+     * @param filter The topic filter
+     * @param value The value
+     */
+    void Insert(const std::string& filter, T value) {
+        auto f = StripShare(filter);
+        auto node = &root_;
+
+        size_t pos = 0;
+        for (;;) {
+            auto end = f.find('/', pos);
+            if (end == std::string::npos) {
+                end = f.size();
+            }
+
+            auto level = TopicSlice{f.data() + pos, end - pos};
+
+            // '#' must be the last level, anything following it is ignored
+            if (level == "#") {
+                node->multi_level_values.push_back(std::move(value));
+                size_++;
+                return;
+            }
+
+            node = level == "+" ? SingleLevelChild(*node) : Child(*node, level);
+
+            if (end == f.size()) {
+                break;
+            }
+
+            pos = end + 1;
+        }
+
+        node->values.push_back(std::move(value));
+        size_++;
+    }
+
+    /**
+     * @brief Call func with each value whose filter matches the topic.
+     *
+     * @param topic The topic
+     * @param func Called with a const T& for every match
+     */
+    template <typename Func>
+    void Match(const std::string& topic, Func&& func) const {
+        auto begin = topic.data();
+        auto wildcards = topic.empty() || topic[0] != '$';
+
+        Match(root_, begin, begin + topic.size(), wildcards, func);
+    }
+
+    /**
+     * @brief Get the number of values in the trie.
+     *
+     * @return size_t
+     */
+    size_t Size() const { return size_; }
+
+   private:
+    struct Node;
+
+    // The keys refer to the level strings owned by the child nodes
+    using node_map = std::unordered_map<TopicSlice, std::unique_ptr<Node>, TopicSliceHash>;
+
+    struct Node {
+        std::string level;
+        node_map children;
+        std::unique_ptr<Node> single_level;
+        std::vector<T> values;
+        std::vector<T> multi_level_values;
+    };
+
+    static std::string StripShare(const std::string& filter) {
+        static constexpr char SHARE_PREFIX[] = "$share/";
+        static constexpr size_t SHARE_PREFIX_LEN = sizeof(SHARE_PREFIX) - 1;
+
+        if (filter.compare(0, SHARE_PREFIX_LEN, SHARE_PREFIX) != 0) {
+            return filter;
+        }
+
+        auto end = filter.find('/', SHARE_PREFIX_LEN);
+        return end == std::string::npos ? std::string{} : filter.substr(end + 1);
+    }
+
+    static Node* Child(Node& node, const TopicSlice& level) {
+        auto it = node.children.find(level);
+        if (it != node.children.end()) {
+            return it->second.get();
+        }
+
+        auto child = std::make_unique<Node>();
+        child->level = level.ToString();
+
+        auto ptr = child.get();
+        node.children.emplace(TopicSlice{ptr->level}, std::move(child));
+        return ptr;
+    }
+
+    static Node* SingleLevelChild(Node& node) {
+        if (!node.single_level) {
+            node.single_level = std::make_unique<Node>();
+        }
+
+        return node.single_level.get();
+    }
+
+    // Match the level starting at begin against the children of node
+    template <typename Func>
+    static void Match(const Node& node, const char* begin, const char* end, bool wildcards, Func& func) {
+        if (wildcards) {
+            for (const auto& v : node.multi_level_values) {
+                func(v);
+            }
+        }
+
+        auto sep = static_cast<const char*>(std::memchr(begin, '/', static_cast<size_t>(end - begin)));
+        if (sep == nullptr) {
+            sep = end;
+        }
+
+        auto it = node.children.find(TopicSlice{begin, static_cast<size_t>(sep - begin)});
+        if (it != node.children.end()) {
+            Descend(*it->second, sep, end, func);
+        }
+
+        if (wildcards && node.single_level) {
+            Descend(*node.single_level, sep, end, func);
+        }
+    }
+
+    // Continue with the level following sep or report the values of node if
+    // the topic has no more levels
+    template <typename Func>
+    static void Descend(const Node& node, const char* sep, const char* end, Func& func) {
+        if (sep != end) {
+            Match(node, sep + 1, end, true, func);
+            return;
+        }
+
+        for (const auto& v : node.values) {
+            func(v);
+        }
+
+        // "a/#" also matches "a"
+        for (const auto& v : node.multi_level_values) {
+            func(v);
+        }
+    }
+
+    Node root_;
+    size_t size_ = 0;
+};
+
+}  // namespace core
+}  // namespace iotea
+
+#endif // SRC_SDK_CPP_LIB_INCLUDE_TOPIC_TRIE_HPP_
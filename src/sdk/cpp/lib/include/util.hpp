@@ -11,7 +11,6 @@
 #ifndef SRC_SDK_CPP_LIB_INCLUDE_UTIL_HPP_
 #define SRC_SDK_CPP_LIB_INCLUDE_UTIL_HPP_
 
-#include <regex>
 #include <string>
 
 namespace iotea {
@@ -37,6 +36,11 @@ class Uuid4 {
     std::string str_;
 };
 
+/**
+ * @brief TopicExprMatcher matches topics against a topic expression in which
+ * '+' matches one or more characters other than '/' and a trailing '#'
+ * matches any remainder of the topic. All other characters match themselves.
+ */
 class TopicExprMatcher {
    public:
     TopicExprMatcher(std::string topic_expr);
@@ -44,9 +48,9 @@ class TopicExprMatcher {
     bool Match(const std::string& topic) const;
 
    private:
-    void ReplaceAll(std::string& s, const std::string& what, const std::string& with);
+    static bool Match(const char* expr, const char* expr_end, const char* topic, const char* topic_end);
 
-    std::regex expr_;
+    std::string expr_;
 };
 
 std::string GetEnv(const std::string& name, const std::string& defval = "");
@@ -10,6 +10,7 @@
 
 #include "call.hpp"
 #include "logging.hpp"
+#include "serializer.hpp"
 
 using iotea::core::logging::NamedLogger;
 
@@ -98,6 +99,14 @@ bool Gatherer::Wants(const call_id_t& id) const {
     return ids_.find(id) != ids_.end();
 }
 
+const std::set<call_id_t>& Gatherer::GetIds() const {
+    return ids_;
+}
+
+int64_t Gatherer::GetDeadline() const {
+    return timeout_;
+}
+
 bool Gatherer::IsReady() const {
     return ids_.size() == replies_.size();
 }
@@ -141,29 +150,37 @@ PreparedFunctionReply::PreparedFunctionReply(const std::string& talent_id,
         const std::string& feature,
         event_ptr event,
         const std::string& return_topic,
-        gateway_ptr gateway)
+        gateway_ptr gateway,
+        outbox_ptr outbox,
+        publisher_ptr publisher)
     : talent_id_{talent_id}
     , feature_{feature}
     , event_{event}
     , return_topic_{return_topic}
-    , gateway_{gateway} {}
+    , gateway_{gateway}
+    , outbox_{outbox}
+    , publisher_{publisher} {}
 
 void PreparedFunctionReply::Reply(const json& value) const {
 
-    auto channel = event_->GetValue()["chnl"].get<std::string>();
-    auto call = event_->GetValue()["call"].get<std::string>();
-    auto result = json{
-        {"$tsuffix", std::string("/") + channel + "/" + call},
-        {"$vpath", "value"},
-        {"value", value}
-    };
+    const auto& call = event_->GetValue();
+
+    ScopedBuffer buffer;
+    SerializeReply(buffer.Get(), talent_id_, feature_, call.at("chnl").get_ref<const std::string&>(),
+                   call.at("call").get_ref<const std::string&>(), value, event_->GetSubject(), event_->GetType(),
+                   event_->GetInstance(), GetEpochTimeMs());
 
-    auto subject = event_->GetSubject();
-    auto type = event_->GetType();
-    auto instance = event_->GetInstance();
-    auto event = OutgoingEvent<json>{subject, talent_id_, talent_id_ + "." + feature_, result, type, instance};
+    if (outbox_) {
+        outbox_->Post(return_topic_, buffer.Get());
+        return;
+    }
 
-    gateway_->Publish(return_topic_, event.Json().dump());
+    if (publisher_) {
+        publisher_->Post(return_topic_, buffer.Get(), PublishPriority::HIGH);
+        return;
+    }
+
+    gateway_->Publish(return_topic_, buffer.Get());
 }
 
 //
@@ -213,42 +230,138 @@ bool Callee::operator==(const Callee& other) const {
 //
 // ReplyHandler
 //
+static auto reply_handler_logger = NamedLogger("ReplyHandler");
+
+ReplyHandler::ReplyHandler(size_t max_pending, int64_t resolution_ms)
+    : max_pending_{max_pending}
+    , wheel_{resolution_ms} {}
+
+void ReplyHandler::SetMaxPending(size_t max_pending) {
+    max_pending_.store(max_pending);
+}
+
+void ReplyHandler::SetResolution(int64_t resolution_ms) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    wheel_.SetResolution(resolution_ms);
+}
+
+int64_t ReplyHandler::GetResolution() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return wheel_.GetResolution();
+}
+
 void ReplyHandler::AddGatherer(std::shared_ptr<Gatherer> gatherer) {
-    gatherers_.push_back(gatherer);
+    std::vector<std::shared_ptr<Gatherer>> evicted;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+
+        if (pending_.find(gatherer.get()) != pending_.end()) {
+            return;
+        }
+
+        auto order = order_.insert(order_.end(), gatherer);
+        auto timer = wheel_.Schedule(gatherer->GetDeadline());
+        timers_.emplace(timer, gatherer.get());
+        pending_.emplace(gatherer.get(), Pending{order, timer});
+
+        for (const auto& id : gatherer->GetIds()) {
+            index_[id] = gatherer.get();
+        }
+
+        auto max_pending = max_pending_.load();
+        while (max_pending > 0 && order_.size() > max_pending) {
+            evicted.push_back(Remove(order_.front().get()));
+        }
+    }
+
+    // Time out the evicted gatherers without holding the lock since the
+    // timeout functions may issue new calls.
+    for (const auto& g : evicted) {
+        reply_handler_logger.Warn() << "Too many pending calls, timing out the oldest";
+        g->TimeOut();
+    }
+}
+
+std::shared_ptr<Gatherer> ReplyHandler::Remove(Gatherer* gatherer) {
+    auto it = pending_.find(gatherer);
+    if (it == pending_.end()) {
+        return nullptr;
+    }
+
+    for (const auto& id : gatherer->GetIds()) {
+        auto index_it = index_.find(id);
+
+        // Several gatherers may (erroneously) wait for the same ID, only
+        // remove the entry if it refers to this one.
+        if (index_it != index_.end() && index_it->second == gatherer) {
+            index_.erase(index_it);
+        }
+    }
+
+    auto g = *it->second.order;
+    order_.erase(it->second.order);
+    wheel_.Cancel(it->second.timer);
+    timers_.erase(it->second.timer);
+    pending_.erase(it);
+
+    return g;
 }
 
 std::shared_ptr<Gatherer> ReplyHandler::ExtractGatherer(const call_id_t& call_id) {
-    auto it = std::find_if(gatherers_.begin(), gatherers_.end(), [call_id](const auto& g) {
-        return g->Wants(call_id);
-    });
+    std::lock_guard<std::mutex> lock(mutex_);
 
-    if (it == gatherers_.end()) {
+    auto it = index_.find(call_id);
+    if (it == index_.end()) {
         return nullptr;
     }
 
-    auto g = *it;
-    gatherers_.erase(it);
+    return Remove(it->second);
+}
+
+std::shared_ptr<Gatherer> ReplyHandler::GatherReply(const call_id_t& call_id, const json& reply) {
+    std::lock_guard<std::mutex> lock(mutex_);
 
-    return g;
+    auto it = index_.find(call_id);
+    if (it == index_.end()) {
+        IOTEA_LOG_DEBUG(reply_handler_logger) << "Could not find gatherer of call id " << call_id;
+        return nullptr;
+    }
+
+    auto gatherer = it->second;
+
+    // The gatherer is only ever modified while holding the lock
+    index_.erase(it);
+    gatherer->Gather(call_id, reply);
+
+    if (!gatherer->IsReady()) {
+        // The gatherer expects additional replies
+        return nullptr;
+    }
+
+    return Remove(gatherer);
 }
 
 std::vector<std::shared_ptr<Gatherer>> ReplyHandler::ExtractTimedOut(int64_t ts) {
+    std::lock_guard<std::mutex> lock(mutex_);
     std::vector<std::shared_ptr<Gatherer>> timed_out;
 
-    auto it_end = std::remove_if(gatherers_.begin(), gatherers_.end(), [&timed_out, ts](const auto& g) {
-            auto has_timed_out = g->HasTimedOut(ts);
+    for (auto timer : wheel_.Advance(ts)) {
+        auto it = timers_.find(timer);
 
-            if (has_timed_out) {
-                timed_out.push_back(g);
-            }
-
-            return has_timed_out;
-        });
-
-    gatherers_.erase(it_end, gatherers_.end());
+        if (it != timers_.end()) {
+            timed_out.push_back(Remove(it->second));
+        }
+    }
 
     return timed_out;
 }
+
+size_t ReplyHandler::GetPendingCount() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return pending_.size();
+}
+
 }  // namespace core
 }  // namespace iotea
 
@@ -10,11 +10,13 @@
 
 #include <algorithm>
 #include <chrono>
-#include <regex>
+#include <unordered_set>
+#include <utility>
 
 #include "event.hpp"
 #include "client.hpp"
 #include "logging.hpp"
+#include "raw_json.hpp"
 #include "util.hpp"
 
 namespace iotea {
@@ -24,8 +26,6 @@ static constexpr char INGESTION_EVENTS_TOPIC[] = R"(ingestion/events)";
 static constexpr char PLATFORM_EVENTS_TOPIC[] = R"(platform/$events)";
 static constexpr char TALENTS_DISCOVERY_TOPIC[] = R"(configManager/talents/discover)";
 
-using namespace std::chrono_literals;
-
 //
 // Service
 //
@@ -70,67 +70,192 @@ void CalleeTalent::AddCallees(const std::vector<Callee>& callees) {
 //
 static auto logger = NamedLogger("Client");
 
-Client::Client(gateway_ptr gateway)
+Client::Client(gateway_ptr gateway, const DispatchOptions& dispatch_options)
     : gateway_{gateway}
     , callee_talent_(new CalleeTalent{GenerateUUID()})
-    , reply_handler_{std::make_shared<ReplyHandler>()} {
+    , reply_handler_{std::make_shared<ReplyHandler>()}
+    , dispatch_options_{dispatch_options}
+    , dispatcher_{std::make_unique<Dispatcher>(dispatch_options)}
+    , uuid_gen_{GenerateUUID} {
         ticker_is_running_.store(false);
+        frozen_.store(false);
     }
 
 Client::Client(gateway_ptr gateway,
         std::shared_ptr<CalleeTalent> callee_talent,
-        reply_handler_ptr reply_handler)
+        reply_handler_ptr reply_handler,
+        const DispatchOptions& dispatch_options)
     : gateway_{gateway}
     , callee_talent_{callee_talent}
-    , reply_handler_{reply_handler} {
+    , reply_handler_{reply_handler}
+    , dispatch_options_{dispatch_options}
+    , dispatcher_{std::make_unique<Dispatcher>(dispatch_options)}
+    , uuid_gen_{GenerateUUID} {
         ticker_is_running_.store(false);
+        frozen_.store(false);
     }
 
 Client::~Client() {
     if (ticker_thread_.joinable()) {
         ticker_thread_.join();
     }
+
+    dispatcher_->Stop();
 }
 
 void Client::Start() {
+    // The talent table is read concurrently from here on
+    frozen_.store(true);
+
     gateway_->Initialize();
-    callee_talent_->Initialize(reply_handler_, nullptr, GenerateUUID);
+    callee_talent_->Initialize(reply_handler_, nullptr, uuid_gen_);
     SubscribeInternal(callee_talent_);
+    CreateShaper();
+
+    if (outbox_) {
+        outbox_->SetPublisher(publisher_);
+    }
 
     static auto context_creator = [this](const std::string& subject) {
         return std::make_shared<EventContext>(callee_talent_->GetId(),
             callee_talent_->GetChannelId(), subject, INGESTION_EVENTS_TOPIC,
-            reply_handler_, gateway_, GenerateUUID);
+            reply_handler_, gateway_, uuid_gen_, outbox_, shaper_, publisher_);
     };
 
     for (const auto& ft_pair : function_talents_) {
-        ft_pair.second->Initialize(reply_handler_, context_creator, GenerateUUID);
+        ft_pair.second->Initialize(reply_handler_, context_creator, uuid_gen_);
         SubscribeInternal(ft_pair.second);
     }
     for (const auto& st_pair : subscription_talents_) {
-        st_pair.second->Initialize(reply_handler_, context_creator, GenerateUUID);
+        st_pair.second->Initialize(reply_handler_, context_creator, uuid_gen_);
         SubscribeInternal(st_pair.second);
     }
 
+    if (publisher_) {
+        publisher_->Start();
+    }
+
     StartTicker();
+    dispatcher_->Start();
     gateway_->Start();
+
+    // The gateway has stopped, finish handling the messages already received
+    dispatcher_->Stop();
+
+    FlushEmitted();
+}
+
+void Client::CreateShaper() {
+    // Feature name -> (declaring talent, policy)
+    std::unordered_map<std::string, std::pair<std::string, EmitPolicy>> policies;
+    std::unordered_set<std::string> conflicts;
+
+    auto add_policies = [&policies, &conflicts](const Talent& talent) {
+        for (const auto& p : talent.GetEmitPolicies()) {
+            auto inserted = policies.emplace(p.first, std::make_pair(talent.GetId(), p.second));
+            const auto& declared = inserted.first->second;
+
+            if (!inserted.second && declared.second != p.second) {
+                logger.Error() << "Talents " << declared.first << " and " << talent.GetId()
+                    << " declare different emit policies for output " << p.first << ", its events are not shaped";
+                conflicts.insert(p.first);
+            }
+        }
+    };
+
+    for (const auto& ft_pair : function_talents_) {
+        add_policies(*ft_pair.second);
+    }
+    for (const auto& st_pair : subscription_talents_) {
+        add_policies(*st_pair.second);
+    }
+
+    auto shaper = std::make_shared<EmitShaper>();
+    auto found = false;
+
+    for (const auto& p : policies) {
+        if (conflicts.count(p.first) == 0) {
+            shaper->SetPolicy(p.first, p.second.second);
+            found = true;
+        }
+    }
+
+    shaper_ = found ? shaper : nullptr;
+}
+
+void Client::SendShaped(const std::string& topic, const std::string& msg) {
+    if (outbox_) {
+        outbox_->Post(topic, msg);
+        return;
+    }
+
+    if (publisher_) {
+        publisher_->Post(topic, msg);
+        return;
+    }
+
+    gateway_->Publish(topic, msg);
+}
+
+void Client::FlushEmitted() {
+    // Held back events go through the outbox, flush them first
+    if (shaper_) {
+        shaper_->Flush([this](const std::string& topic, const std::string& msg) { SendShaped(topic, msg); });
+    }
+
+    if (outbox_) {
+        outbox_->Flush();
+    }
+
+    // Publish what is still queued
+    if (publisher_) {
+        publisher_->Stop();
+    }
 }
 
 void Client::StartTicker() {
+    ticker_is_running_.store(true);
+
     ticker_thread_ = std::thread{[this]{
-            ticker_is_running_.store(true);
-            while (ticker_is_running_.load()) {
-                auto ts = GetEpochTimeMs();
-                UpdateTime(ts);
+            std::unique_lock<std::mutex> lock{ticker_mutex_};
 
-                std::this_thread::sleep_for(1s);
+            while (ticker_is_running_.load()) {
+                lock.unlock();
+                auto now = GetEpochTimeMs();
+                UpdateTime(now);
+
+                if (shaper_) {
+                    shaper_->FlushExpired(now, [this](const std::string& topic, const std::string& msg) { SendShaped(topic, msg); });
+                }
+
+                if (outbox_) {
+                    outbox_->FlushExpired(now);
+                }
+                lock.lock();
+
+                // Wake up once per timer tick, or more often to publish held
+                // back events in time, or as soon as the ticker is stopped
+                auto resolution = std::chrono::milliseconds{reply_handler_->GetResolution()};
+                if (outbox_) {
+                    resolution = std::min(resolution, std::chrono::milliseconds{std::max<int64_t>(outbox_->GetMaxDelay(), 1)});
+                }
+                if (shaper_ && shaper_->GetMinConflationWindow() > 0) {
+                    resolution = std::min(resolution, std::chrono::milliseconds{shaper_->GetMinConflationWindow()});
+                }
+                ticker_cv_.wait_for(lock, resolution, [this] { return !ticker_is_running_.load(); });
             }
         }
     };
 }
 
 void Client::StopTicker() {
-    ticker_is_running_.store(false);
+    {
+        std::lock_guard<std::mutex> lock{ticker_mutex_};
+        ticker_is_running_.store(false);
+    }
+
+    ticker_cv_.notify_all();
+
     if (ticker_thread_.joinable()) {
         ticker_thread_.join();
     }
@@ -138,34 +263,58 @@ void Client::StopTicker() {
 
 void Client::Stop() {
     StopTicker();
+    FlushEmitted();
+
     gateway_->Stop();
 }
 
+bool Client::IsFrozen(const std::string& talent_id) const {
+    if (frozen_.load()) {
+        logger.Error() << "Cannot register talent " << talent_id << " after the client has been started";
+        return true;
+    }
+
+    return false;
+}
+
 void Client::Register(const Service& service) {
-    auto t = service.GetTalent();
-    function_talents_[t->GetId()] = t;
+    RegisterFunctionTalent(service.GetTalent());
 }
 
 void Client::RegisterFunctionTalent(std::shared_ptr<FunctionTalent> t) {
-    function_talents_[t->GetId()] = t;
+    auto talent_id = t->GetId();
+    if (IsFrozen(talent_id)) {
+        return;
+    }
+
+    function_talents_[talent_id] = t;
+    talents_[talent_id].function_talent = t;
 }
 
 void Client::RegisterTalent(std::shared_ptr<Talent> t) {
-    subscription_talents_[t->GetId()] = t;
+    auto talent_id = t->GetId();
+    if (IsFrozen(talent_id)) {
+        return;
+    }
+
+    subscription_talents_[talent_id] = t;
+    talents_[talent_id].subscription_talent = t;
 }
 
 void Client::SubscribeInternal(std::shared_ptr<Talent> t) {
     auto talent_id = t->GetId();
     auto channel_id = t->GetChannelId();
 
-    auto on_msg = [this](const std::string& topic, const std::string& message, const std::string& adapter) {
+    router_.AddTalent(talent_id, channel_id);
+
+    auto on_msg = [this](const std::string& topic, const payload_ptr& message, const std::string& adapter) {
         Receive(topic, message, adapter);
     };
-    gateway_->SubscribeShared(talent_id, TALENTS_DISCOVERY_TOPIC, on_msg);
-    gateway_->SubscribeShared(talent_id, PLATFORM_EVENTS_TOPIC, on_msg);
+    gateway_->SubscribeSharedPayload(talent_id, TALENTS_DISCOVERY_TOPIC, on_msg);
+    gateway_->SubscribeSharedPayload(talent_id, PLATFORM_EVENTS_TOPIC, on_msg);
 
-    gateway_->SubscribeShared(talent_id, "talent/" + talent_id + "/events", on_msg);
-    gateway_->Subscribe("talent/" + talent_id + "/events/" + channel_id + "/+", on_msg);
+    gateway_->SubscribeSharedPayload(talent_id, "talent/" + talent_id + "/events", on_msg);
+    gateway_->SubscribePayload("talent/" + talent_id + "/events/" + channel_id + "/+", on_msg);
 }
 
 Callee Client::CreateCallee(const std::string& talent_id, const std::string& func, const std::string& type) {
@@ -178,8 +327,63 @@ void Client::Subscribe(schema::rule_ptr rules, const OnEvent callback) {
     RegisterTalent(t);
 }
 
+void Client::SetIdGenerator(uuid_generator_func_ptr uuid_gen) {
+    if (frozen_.load()) {
+        logger.Error() << "Cannot change the ID generator after the client has been started";
+        return;
+    }
+
+    uuid_gen_ = uuid_gen;
+}
+
+void Client::SetMaxPendingCalls(size_t max_pending) {
+    reply_handler_->SetMaxPending(max_pending);
+}
+
+void Client::SetTimerResolution(int64_t resolution_ms) {
+    reply_handler_->SetResolution(resolution_ms);
+}
+
+void Client::SetEmitBatching(size_t max_events, int64_t max_delay_ms) {
+    if (frozen_.load()) {
+        logger.Error() << "Cannot change the emit batching after the client has been started";
+        return;
+    }
+
+    outbox_ = max_events > 1 ? std::make_shared<Outbox>(gateway_, max_events, max_delay_ms) : nullptr;
+}
+
+std::vector<DispatchStats> Client::GetDispatchStats() const {
+    return dispatcher_->GetStats();
+}
+
+void Client::SetAsyncPublishing(const PublisherOptions& options) {
+    if (frozen_.load()) {
+        logger.Error() << "Cannot enable asynchronous publishing after the client has been started";
+        return;
+    }
+
+    publisher_ = std::make_shared<Publisher>(gateway_, options);
+}
+
+std::vector<PublisherStats> Client::GetPublisherStats() const {
+    if (!publisher_) {
+        return {};
+    }
+
+    return publisher_->GetStats();
+}
+
+std::unordered_map<std::string, EmitStats> Client::GetEmitStats() const {
+    if (!shaper_) {
+        return {};
+    }
+
+    return shaper_->GetStats();
+}
+
 void Client::HandleDiscover(const std::string& msg) {
-    logger.Debug() << "Received discovery message.";
+    IOTEA_LOG_DEBUG(logger) << "Received discovery message.";
     auto payload = json::parse(msg);
     auto dmsg = DiscoverMessage::FromJson(payload);
     auto return_topic = dmsg->GetReturnTopic();
@@ -209,7 +413,7 @@ void Client::HandleDiscover(const std::string& msg) {
 }
 
 void Client::HandlePlatformEvent(const std::string& msg) {
-    logger.Debug() << "Received platform message.";
+    IOTEA_LOG_DEBUG(logger) << "Received platform message.";
     auto payload = json::parse(msg);
     auto event = PlatformEvent::FromJson(payload);
 
@@ -241,12 +445,9 @@ void Client::HandleError(error_message_ptr err) {
 
 bool Client::HandleAsCall(std::shared_ptr<FunctionTalent> t, event_ptr event) {
     // Find function matching the event feature name
-    auto funcs = t->GetFunctions();
-    auto it = std::find_if(funcs.begin(), funcs.end(), [t, event](const auto& p) {
-        return t->GetInputName(t->GetId(), p.first) == event->GetFeature();
-    });
+    auto function = t->FindFunction(event->GetFeature());
 
-    if (it == funcs.end()) {
+    if (!function) {
         // No function found
         return false;
     }
@@ -254,35 +455,53 @@ bool Client::HandleAsCall(std::shared_ptr<FunctionTalent> t, event_ptr event) {
     // Invoke the callback function corresponding to the feature name
     auto ctx = std::make_shared<CallContext>(t->GetId(),
             t->GetChannelId(),
-            t->GetOutputName(it->first),
+            function->output_feature,
             event,
             reply_handler_,
             gateway_,
-            GenerateUUID);
-    auto args = event->GetValue()["args"];
-    it->second(args, ctx);
+            uuid_gen_,
+            outbox_,
+            shaper_,
+            publisher_);
+    auto args = event->GetValue().value("args", json{});
+    function->func(args, ctx);
     return true;
 }
 
-void Client::HandleEvent(const std::string& talent_id, const std::string& raw) {
+void Client::HandleEvent(const std::string& talent_id, const payload_ptr& raw) {
     event_ptr event;
 
     try {
-        logger.Debug() << "Parse payload.";
-        auto payload = json::parse(raw);
+        IOTEA_LOG_DEBUG(logger) << "Parse payload.";
+        auto payload = RawJsonObject{raw};
+        if (!payload.IsValid()) {
+            logger.Error() << "Failed to parse event message.";
+            return;
+        }
 
         // First check if this is an error message
-        auto msg = Message::FromJson(payload);
-        if (msg->IsError()) {
-            logger.Debug() << "Create error message from payload.";
-            auto err = ErrorMessage::FromJson(payload);
+        if (payload.Decode("msgType").get<Message::Type>() == Message::Type::ERROR) {
+            IOTEA_LOG_DEBUG(logger) << "Create error message from payload.";
+            auto err = ErrorMessage::FromJson(json::parse(payload.GetText()));
 
             HandleError(err);
             return;
         }
 
-        logger.Debug() << "Create event from payload.";
-        event = Event::FromJson(payload);
+        // Only the header fields are decoded here, the value and the
+        // features are decoded when the talent accesses them.
+        IOTEA_LOG_DEBUG(logger) << "Create event from payload.";
+        event = Event::FromRaw(std::move(payload));
+        if (!event) {
+            logger.Error() << "Unexpected content in event message: missing field";
+            return;
+        }
+
+        // Decode the header fields and the value so that malformed events
+        // are rejected here. The index only matched the brackets of nested
+        // values, their content is checked when they are decoded.
+        event->GetFeature();
+        event->GetValue();
     } catch (const json::parse_error& e) {
         logger.Error() << "Failed to parse event message.";
         return;
@@ -291,16 +510,15 @@ void Client::HandleEvent(const std::string& talent_id, const std::string& raw) {
         return;
     }
 
-    logger.Debug() << "HandleEvent, talent_id=" << talent_id << ", feature=" << event->GetFeature();
+    IOTEA_LOG_DEBUG(logger) << "HandleEvent, talent_id=" << talent_id << ", feature=" << event->GetFeature();
 
-    // Is it a function talent?
-    auto ft_iter = std::find_if(function_talents_.begin(), function_talents_.end(), [talent_id](const auto& item) {
-        return item.first == talent_id;
-    });
+    auto entry_iter = talents_.find(talent_id);
+    auto entry = entry_iter == talents_.end() ? nullptr : &entry_iter->second;
 
-    if (ft_iter != function_talents_.end()) {
+    // Is it a function talent?
+    if (entry && entry->function_talent) {
         // Attempt to treat the event as a function call
-        if (HandleAsCall(ft_iter->second, event)) {
+        if (HandleAsCall(entry->function_talent, event)) {
             return;
         }
 
@@ -311,25 +529,27 @@ void Client::HandleEvent(const std::string& talent_id, const std::string& raw) {
                 event->GetReturnTopic(),
                 reply_handler_,
                 gateway_,
-                GenerateUUID);
-        ft_iter->second->OnEvent(event, ctx);
+                uuid_gen_,
+                outbox_,
+                shaper_,
+                publisher_);
+        entry->function_talent->OnEvent(event, ctx);
         return;
     }
 
-    auto st_iter = std::find_if(subscription_talents_.begin(), subscription_talents_.end(), [talent_id](const auto& item) {
-        return item.first == talent_id;
-    });
-
-    if (st_iter != subscription_talents_.end()) {
+    if (entry && entry->subscription_talent) {
         // Found event handler
-        auto t = st_iter->second;
+        auto t = entry->subscription_talent;
         auto ctx = std::make_shared<EventContext>(callee_talent_->GetId(),
                 callee_talent_->GetChannelId(),
                 event->GetSubject(),
                 event->GetReturnTopic(),
                 reply_handler_,
                 gateway_,
-                GenerateUUID);
+                uuid_gen_,
+                outbox_,
+                shaper_,
+                publisher_);
         t->OnEvent(event, ctx);
         return;
     }
@@ -341,7 +561,10 @@ void Client::HandleEvent(const std::string& talent_id, const std::string& raw) {
                 event->GetReturnTopic(),
                 reply_handler_,
                 gateway_,
-                GenerateUUID);
+                uuid_gen_,
+                outbox_,
+                shaper_,
+                publisher_);
         callee_talent_->OnEvent(event, ctx);
         return;
     }
@@ -350,24 +573,27 @@ void Client::HandleEvent(const std::string& talent_id, const std::string& raw) {
 }
 
 void Client::HandleCallReply(const std::string& talent_id, const std::string&
-        channel_id, const call_id_t& call_id, const std::string& msg) {
-    logger.Debug() << "Received reply, talent_id: " << talent_id << ", channel_id=" << channel_id << " call_id=" << call_id;
+        channel_id, const call_id_t& call_id, const payload_ptr& msg) {
+    IOTEA_LOG_DEBUG(logger) << "Received reply, talent_id: " << talent_id << ", channel_id=" << channel_id << " call_id=" << call_id;
 
-    auto payload = json::parse(msg);
-    auto event = Event::FromJson(payload);
-    auto value = event->GetValue()["value"];
+    json value;
 
-    auto gatherer = reply_handler_->ExtractGatherer(call_id);
-    if (!gatherer) {
-        logger.Debug() << "Could not find gatherer of call id " << call_id;
+    try {
+        auto event = Event::FromRaw(RawJsonObject{msg});
+        if (!event) {
+            logger.Error() << "Failed to parse reply message.";
+            return;
+        }
+
+        value = event->GetValue().value("value", json{});
+    } catch (const json::exception& e) {
+        logger.Error() << "Failed to parse reply message: " << e.what();
         return;
     }
 
-    gatherer->Gather(call_id, value);
-
-    if (!gatherer->IsReady()) {
-        // The gatherer expects additional replies, re-insert it.
-        reply_handler_->AddGatherer(gatherer);
+    auto gatherer = reply_handler_->GatherReply(call_id, value);
+    if (!gatherer) {
+        // Unknown call or the gatherer expects additional replies
         return;
     }
 
@@ -376,56 +602,198 @@ void Client::HandleCallReply(const std::string& talent_id, const std::string&
 }
 
 void Client::Receive(const std::string& topic, const std::string& msg, const std::string& adapter_id) {
-    logger.Debug() << "Message arrived.";
-    logger.Debug() << "\ttopic: '" << topic << "'";
-    logger.Debug() << "\tpayload: " << msg;
-    logger.Debug() << "\tadapter: " << adapter_id;
-
-    std::cmatch m;
-
-    // TODO make the lock more granular
-    std::lock_guard<std::mutex> lock(mutex_);
-
-    // Forward event
-    // Received events look like this {MQTT_TOPIC_NS}/talent/<talentId>/events
-    // In the regex below we assume that both instance of <talentId> are the same
-    static const auto event_expr = std::regex{R"(.*/talent/([^/]+)/events$)"};
-    if (std::regex_match(topic.c_str(), m, event_expr)) {
-        auto talent_id = m[1];
-        HandleEvent(talent_id, msg);
-        return;
+    // Events keep their payload beyond this call, it has to be owned
+    Receive(topic, std::make_shared<const std::string>(msg), adapter_id);
+}
+
+void Client::Receive(const std::string& topic, const payload_ptr& payload, const std::string& adapter_id) {
+    const auto& msg = *payload;
+
+    IOTEA_LOG_DEBUG(logger) << "Message arrived.";
+    IOTEA_LOG_DEBUG(logger) << "\ttopic: '" << topic << "'";
+    IOTEA_LOG_DEBUG(logger) << "\tpayload: " << msg;
+    IOTEA_LOG_DEBUG(logger) << "\tadapter: " << adapter_id;
+
+    auto route = router_.Resolve(topic);
+
+    switch (route.type) {
+        case TopicRoute::Type::EVENT: {
+            // Forward event
+            // Received events look like this {MQTT_TOPIC_NS}/talent/<talentId>/events
+            //
+            // IDs of talents known to the router refer to strings owned by
+            // the router, the others have to be copied out of the topic.
+            if (route.talent_id) {
+                auto talent_id = route.talent_id;
+                Dispatch(GetShardKey(*talent_id, msg), false, payload, [this, talent_id](const payload_ptr& m) {
+                    HandleEvent(*talent_id, m);
+                });
+            } else {
+                auto talent_id = route.talent.ToString();
+                auto key = GetShardKey(talent_id, msg);
+                Dispatch(key, false, payload, [this, talent_id = std::move(talent_id)](const payload_ptr& m) {
+                    HandleEvent(talent_id, m);
+                });
+            }
+            return;
+        }
+        case TopicRoute::Type::CALL_REPLY: {
+            // Forward deferred call response
+            // talent/<talentId>/events/<talentId>.<callChannelId>/<callId>
+            auto talent_id = route.talent_id ? *route.talent_id : route.talent.ToString();
+            auto channel_id = route.channel_id ? *route.channel_id : route.channel.ToString();
+            auto call_id = call_id_t{route.call.ToString()};
+            auto key = GetShardKey(talent_id, msg);
+
+            Dispatch(key, false, payload, [this, talent_id = std::move(talent_id), channel_id = std::move(channel_id),
+                    call_id = std::move(call_id)](const payload_ptr& m) {
+                HandleCallReply(talent_id, channel_id, call_id, m);
+            });
+            return;
+        }
+        case TopicRoute::Type::DISCOVER:
+            // Forward discovery request
+            Dispatch(Dispatcher::Hash(topic), true, payload, [this](const payload_ptr& m) {
+                HandleDiscover(*m);
+            });
+            return;
+        case TopicRoute::Type::PLATFORM_EVENT:
+            Dispatch(Dispatcher::Hash(topic), false, payload, [this](const payload_ptr& m) {
+                HandlePlatformEvent(*m);
+            });
+            return;
+        default:
+            break;
     }
-    // iotea/talent/event_consumer/events/channel/callid
-    // Forward deferred call response
-    // talent/<talentId>/events/<callChannelId>.<deferredCallId>
-    // talent/<talentId>/events/<talentId>.<callChannelId>/<callId>
-    static const auto call_expr =
-        std::regex{R"(.*/talent/[^/]+/events/([^\.]+)\.([^/]+)/(.+)$)"};
-    if (std::regex_match(topic.c_str(), m, call_expr)) {
-        std::string talent_id{m[1]};
-        std::string channel_id{m[2]};
-        call_id_t call_id{m[3]};
-
-        HandleCallReply(talent_id, channel_id, call_id, msg);
+
+    logger.Error() << "Unexpected topic: << " << topic;
+}
+
+void Client::Dispatch(size_t key, bool exclusive, const payload_ptr& msg, msg_handler_func_ptr handler) {
+    if (!dispatcher_->IsParallel()) {
+        // All messages are handled on the receiving thread. Lazily decoded
+        // parts of an event (e.g. "$features") may still turn out malformed
+        // in a handler, which must not escape into the adapter.
+        std::lock_guard<std::mutex> lock(mutex_);
+        try {
+            handler(msg);
+        } catch (const json::exception& e) {
+            logger.Error() << "Failed to handle message: " << e.what();
+        }
         return;
     }
 
-    // Forward discovery request
-    if (topic.find(TALENTS_DISCOVERY_TOPIC) != std::string::npos) {
-        HandleDiscover(msg);
+    if (exclusive) {
+        dispatcher_->Post(key, [this, handler, msg] {
+            std::lock_guard<std::mutex> lock(mutex_);
+            handler(msg);
+        });
         return;
     }
 
-    if (topic.find(PLATFORM_EVENTS_TOPIC) != std::string::npos) {
-        HandlePlatformEvent(msg);
-        return;
+    dispatcher_->Post(key, [handler, msg] {
+        handler(msg);
+    });
+}
+
+/**
+ * @brief ShardKeyScanner is a SAX handler extracting the value of a single
+ * top level string property from a JSON payload. Parsing is aborted as soon
+ * as the property has been found so that the remainder of the payload (e.g.
+ * large "$features" objects) is never scanned.
+ */
+class ShardKeyScanner : public nlohmann::json_sax<json> {
+   public:
+    explicit ShardKeyScanner(const std::string& name)
+        : name_{name} {}
+
+    bool null() override { return Value(); }
+    bool boolean(bool) override { return Value(); }
+    bool number_integer(number_integer_t) override { return Value(); }
+    bool number_unsigned(number_unsigned_t) override { return Value(); }
+    bool number_float(number_float_t, const string_t&) override { return Value(); }
+    bool binary(binary_t&) override { return Value(); }
+
+    bool string(string_t& val) override {
+        if (depth_ == 1 && match_) {
+            value_ = val;
+            return false;
+        }
+
+        return Value();
     }
 
-    logger.Error() << "Unexpected topic: << " << topic;
+    bool start_object(std::size_t) override {
+        match_ = false;
+        depth_++;
+        return true;
+    }
+
+    bool end_object() override {
+        depth_--;
+        return true;
+    }
+
+    bool start_array(std::size_t) override {
+        match_ = false;
+        depth_++;
+        return true;
+    }
+
+    bool end_array() override {
+        depth_--;
+        return true;
+    }
+
+    bool key(string_t& val) override {
+        match_ = depth_ == 1 && val == name_;
+        return true;
+    }
+
+    bool parse_error(std::size_t, const std::string&, const nlohmann::detail::exception&) override {
+        return false;
+    }
+
+    const std::string& GetValue() const { return value_; }
+
+   private:
+    bool Value() {
+        match_ = false;
+        return true;
+    }
+
+    const std::string& name_;
+    std::string value_;
+    int depth_ = 0;
+    bool match_ = false;
+};
+
+size_t Client::GetShardKey(const std::string& talent_id, const std::string& msg) const {
+    static const std::string subject_property{"subject"};
+    static const std::string instance_property{"instance"};
+
+    if (!dispatcher_->IsParallel()) {
+        return 0;
+    }
+
+    switch (dispatch_options_.GetShardKey()) {
+        case DispatchOptions::ShardKey::TALENT:
+            return Dispatcher::Hash(talent_id);
+        case DispatchOptions::ShardKey::INSTANCE: {
+            ShardKeyScanner scanner{instance_property};
+            json::sax_parse(msg, &scanner);
+            return Dispatcher::Hash(scanner.GetValue());
+        }
+        case DispatchOptions::ShardKey::SUBJECT:
+        default: {
+            ShardKeyScanner scanner{subject_property};
+            json::sax_parse(msg, &scanner);
+            return Dispatcher::Hash(scanner.GetValue());
+        }
+    }
 }
 
 void Client::UpdateTime(int64_t ts) {
-    std::lock_guard<std::mutex> lock(mutex_);
     auto timed_out = reply_handler_->ExtractTimedOut(ts);
 
     std::for_each(timed_out.begin(), timed_out.end(), [](const auto& g) {
@@ -8,6 +8,8 @@
  * SPDX-License-Identifier: MPL-2.0
  ****************************************************************************/
 
+#include <algorithm>
+
 #include "common.hpp"
 #include "context.hpp"
 #include "logging.hpp"
@@ -19,14 +21,18 @@ namespace core {
 // EventContext
 //
 EventContext::EventContext(const std::string& talent_id, const std::string& channel_id, const std::string& subject,
-                           const std::string& return_topic, reply_handler_ptr reply_handler, gateway_ptr gateway, uuid_generator_func_ptr uuid_gen)
+                           const std::string& return_topic, reply_handler_ptr reply_handler, gateway_ptr gateway, uuid_generator_func_ptr uuid_gen,
+                           outbox_ptr outbox, emit_shaper_ptr shaper, publisher_ptr publisher)
     : talent_id_{talent_id}
     , channel_id_{channel_id}
     , subject_{subject}
     , return_topic_{return_topic}
     , reply_handler_{reply_handler}
     , gateway_{gateway}
-    , uuid_gen_{uuid_gen} {}
+    , uuid_gen_{uuid_gen}
+    , outbox_{outbox}
+    , shaper_{shaper}
+    , publisher_{publisher} {}
 
 std::string EventContext::GetChannelId() const { return channel_id_; }
 
@@ -36,6 +42,79 @@ std::string EventContext::GetReturnTopic() const {
     return return_topic_;
 }
 
+PublishStatus EventContext::EmitBatch(const std::vector<FeatureValue>& values) const {
+    auto now_ms = GetEpochTimeMs();
+    auto status = PublishStatus::OK;
+
+    ScopedBuffer buffer;
+    auto& out = buffer.Get();
+    size_t count = 0;
+
+    for (const auto& v : values) {
+        auto decision = Shape(v.feature, v.value, v.type, v.instance, now_ms);
+        if (decision == EmitShaper::Decision::SUPPRESS) {
+            continue;
+        }
+
+        // Coalesced by the Outbox or held back on their own
+        if (outbox_ || decision == EmitShaper::Decision::HOLD) {
+            ScopedBuffer event;
+            SerializeEvent(event.Get(), subject_, v.feature, v.value, v.type, v.instance, now_ms);
+            status = std::max(status, Deliver(decision, v.feature, v.type, v.instance, event.Get()));
+            continue;
+        }
+
+        if (count > 0) {
+            out.push_back(',');
+        }
+
+        SerializeEvent(out, subject_, v.feature, v.value, v.type, v.instance, now_ms);
+        count++;
+    }
+
+    if (count == 0) {
+        return status;
+    }
+
+    if (count > 1) {
+        out.insert(out.begin(), '[');
+        out.push_back(']');
+    }
+
+    return std::max(status, Send(out));
+}
+
+PublishStatus EventContext::Send(const std::string& msg, PublishPriority priority) const {
+    if (outbox_) {
+        return outbox_->Post(return_topic_, msg);
+    }
+
+    if (publisher_) {
+        return publisher_->Post(return_topic_, msg, priority);
+    }
+
+    return gateway_->Publish(return_topic_, msg) ? PublishStatus::OK : PublishStatus::DROPPED;
+}
+
+PublishStatus EventContext::Deliver(EmitShaper::Decision decision, const std::string& feature, const std::string& type,
+                                    const std::string& instance, const std::string& msg) const {
+    if (decision == EmitShaper::Decision::HOLD) {
+        shaper_->Hold(subject_, feature, type, instance, return_topic_, msg);
+        return PublishStatus::OK;
+    }
+
+    return Send(msg);
+}
+
+bool EventContext::AsNumber(const json& value, double& number) {
+    if (!value.is_number()) {
+        return false;
+    }
+
+    number = value.get<double>();
+    return true;
+}
+
 static auto call_token_logger = iotea::core::logging::NamedLogger("CallToken");
 
 CallToken EventContext::Call(const Callee& callee, const json& args, int64_t timeout) const {
@@ -56,10 +135,16 @@ CallToken EventContext::Call(const Callee& callee, const json& args, int64_t tim
 
 CallToken EventContext::CallInternal(const Callee& callee, const json& args, int64_t timeout) const {
     auto call_id = uuid_gen_();
-    auto j = args.is_array() ? args : json::array({args});
-    auto c = OutgoingCall{callee.GetTalentId(), GetChannelId(), call_id, callee.GetFunc(), j, GetSubject(), callee.GetType(), timeout};
 
-    gateway_->Publish(GetReturnTopic(), c.Json().dump());
+    ScopedBuffer buffer;
+    SerializeCall(buffer.Get(), callee.GetTalentId(), channel_id_, call_id, callee.GetFunc(), args, subject_,
+                  callee.GetType(), timeout, GetEpochTimeMs());
+
+    if (publisher_) {
+        publisher_->Post(return_topic_, buffer.Get(), PublishPriority::HIGH);
+    } else {
+        gateway_->Publish(return_topic_, buffer.Get());
+    }
 
     return CallToken{call_id, timeout};
 }
@@ -69,13 +154,14 @@ CallToken EventContext::CallInternal(const Callee& callee, const json& args, int
 // CallContext
 //
 CallContext::CallContext(const std::string& talent_id, const std::string& channel_id, const std::string& feature,
-                         event_ptr event, reply_handler_ptr reply_handler, gateway_ptr gateway, uuid_generator_func_ptr uuid_gen)
-    : EventContext{talent_id, channel_id, event->GetSubject(), event->GetReturnTopic(), reply_handler, gateway, uuid_gen}
+                         event_ptr event, reply_handler_ptr reply_handler, gateway_ptr gateway, uuid_generator_func_ptr uuid_gen,
+                         outbox_ptr outbox, emit_shaper_ptr shaper, publisher_ptr publisher)
+    : EventContext{talent_id, channel_id, event->GetSubject(), event->GetReturnTopic(), reply_handler, gateway, uuid_gen, outbox, shaper, publisher}
     , event_{event}
     , feature_{feature}
-    , channel_{event->GetValue()["chnl"].get<std::string>()}
-    , call_{event->GetValue()["call"].get<std::string>()}
-    , timeout_at_ms_{event->GetValue()["timeoutAtMs"].get<int64_t>()} {}
+    , channel_{event->GetValue().at("chnl").get<std::string>()}
+    , call_{event->GetValue().at("call").get<std::string>()}
+    , timeout_at_ms_{event->GetValue().at("timeoutAtMs").get<int64_t>()} {}
 
 
 CallToken CallContext::Call(const Callee& callee, const json& args, int64_t timeout) const {
@@ -105,20 +191,13 @@ CallToken CallContext::Call(const Callee& callee, const json& args, int64_t time
 }
 
 void CallContext::Reply(const json& value) const {
-    auto channel = event_->GetValue()["chnl"].get<std::string>();
-    auto call = event_->GetValue()["call"].get<std::string>();
-    auto result = json{
-        {"$tsuffix", std::string("/") + channel + "/" + call},
-        {"$vpath", "value"},
-        {"value", value}
-    };
-
-    auto subject = event_->GetSubject();
-    auto type = event_->GetType();
-    auto instance = event_->GetInstance();
-    auto event = OutgoingEvent<json>{subject, talent_id_, talent_id_ + "." + feature_, result, type, instance};
-
-    gateway_->Publish(return_topic_, event.Json().dump());
+    const auto& call = event_->GetValue();
+
+    ScopedBuffer buffer;
+    SerializeReply(buffer.Get(), talent_id_, feature_, call.at("chnl").get_ref<const std::string&>(),
+                   call.at("call").get_ref<const std::string&>(), value, event_->GetSubject(), event_->GetType(),
+                   event_->GetInstance(), GetEpochTimeMs());
+    Send(buffer.Get(), PublishPriority::HIGH);
 }
 
 }  // namespace core
@@ -0,0 +1,187 @@
+/*****************************************************************************
+ * Copyright (c) 2021 Bosch.IO GmbH
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * SPDX-License-Identifier: MPL-2.0
+ ****************************************************************************/
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#include <algorithm>
+
+#include "dispatcher.hpp"
+#include "logging.hpp"
+
+namespace iotea {
+namespace core {
+
+static auto logger = logging::NamedLogger{"Dispatcher"};
+
+/////////////////////
+// DispatchOptions //
+/////////////////////
+DispatchOptions::DispatchOptions(size_t workers, ShardKey shard_key, const std::vector<int>& cpus)
+    : workers_{workers}
+    , shard_key_{shard_key}
+    , cpus_(cpus) {}
+
+size_t DispatchOptions::GetWorkers() const { return workers_; }
+
+DispatchOptions::ShardKey DispatchOptions::GetShardKey() const { return shard_key_; }
+
+const std::vector<int>& DispatchOptions::GetCpus() const { return cpus_; }
+
+////////////////
+// Dispatcher //
+////////////////
+Dispatcher::Dispatcher(const DispatchOptions& options)
+    : options_{options} {
+    stopped_.store(false);
+
+    for (size_t i = 0; i < options_.GetWorkers(); i++) {
+        shards_.push_back(std::make_unique<Shard>());
+    }
+}
+
+Dispatcher::~Dispatcher() {
+    Stop();
+}
+
+void Dispatcher::Start() {
+    for (size_t i = 0; i < shards_.size(); i++) {
+        auto shard = shards_[i].get();
+        if (shard->thread.joinable()) {
+            continue;
+        }
+
+        shard->thread = std::thread{&Dispatcher::Run, this, shard};
+        Pin(shard->thread, i);
+    }
+}
+
+void Dispatcher::Stop() {
+    stopped_.store(true);
+
+    for (auto& shard : shards_) {
+        {
+            std::lock_guard<std::mutex> lock(shard->mutex);
+            shard->stopped = true;
+        }
+        shard->cv.notify_one();
+    }
+
+    for (auto& shard : shards_) {
+        if (shard->thread.joinable() && shard->thread.get_id() != std::this_thread::get_id()) {
+            shard->thread.join();
+        }
+    }
+}
+
+bool Dispatcher::IsParallel() const {
+    return !shards_.empty();
+}
+
+void Dispatcher::Post(size_t key, task_func_ptr task) {
+    if (shards_.empty() || stopped_.load()) {
+        task();
+        return;
+    }
+
+    auto shard = shards_[key % shards_.size()].get();
+
+    {
+        std::lock_guard<std::mutex> lock(shard->mutex);
+        if (shard->stopped) {
+            // Fall through and run the task below without holding the lock
+            shard = nullptr;
+        } else {
+            shard->queue.push_back(std::move(task));
+
+            auto depth = shard->queue.size();
+            shard->depth.store(depth);
+            if (depth > shard->max_depth.load()) {
+                shard->max_depth.store(depth);
+            }
+        }
+    }
+
+    if (!shard) {
+        task();
+        return;
+    }
+
+    shard->cv.notify_one();
+}
+
+std::vector<DispatchStats> Dispatcher::GetStats() const {
+    std::vector<DispatchStats> stats;
+
+    for (const auto& shard : shards_) {
+        stats.push_back(DispatchStats{shard->depth.load(), shard->max_depth.load(), shard->processed.load()});
+    }
+
+    return stats;
+}
+
+size_t Dispatcher::Hash(const std::string& key) {
+    return std::hash<std::string>{}(key);
+}
+
+void Dispatcher::Run(Shard* shard) {
+    while (true) {
+        task_func_ptr task;
+
+        {
+            std::unique_lock<std::mutex> lock(shard->mutex);
+            shard->cv.wait(lock, [shard] { return shard->stopped || !shard->queue.empty(); });
+
+            if (shard->queue.empty()) {
+                // Stopped and drained
+                return;
+            }
+
+            task = std::move(shard->queue.front());
+            shard->queue.pop_front();
+            shard->depth.store(shard->queue.size());
+        }
+
+        try {
+            task();
+        } catch (const std::exception& e) {
+            logger.Error() << "Unhandled exception in dispatched task: " << e.what();
+        }
+
+        shard->processed++;
+    }
+}
+
+void Dispatcher::Pin(std::thread& thread, size_t index) const {
+    const auto& cpus = options_.GetCpus();
+    if (cpus.empty()) {
+        return;
+    }
+
+#ifdef __linux__
+    auto cpu = cpus[index % cpus.size()];
+
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+
+    if (pthread_setaffinity_np(thread.native_handle(), sizeof(set), &set) != 0) {
+        logger.Warn() << "Failed to pin worker " << index << " to CPU " << cpu;
+    }
+#else
+    (void)thread;
+    logger.Warn() << "Pinning worker " << index << " is not supported on this platform";
+#endif
+}
+
+}  // namespace core
+}  // namespace iotea
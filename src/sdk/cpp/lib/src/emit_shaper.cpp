@@ -0,0 +1,228 @@
+/*****************************************************************************
+ * Copyright (c) 2021 Bosch.IO GmbH
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * SPDX-License-Identifier: MPL-2.0
+ ****************************************************************************/
+
+#include "emit_shaper.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <utility>
+#include <vector>
+
+namespace iotea {
+namespace core {
+
+////////////////
+// EmitPolicy //
+////////////////
+EmitPolicy& EmitPolicy::Conflate(int64_t window_ms) {
+    window_ms_ = std::max<int64_t>(window_ms, 0);
+    return *this;
+}
+
+EmitPolicy& EmitPolicy::Deadband(double absolute, double relative) {
+    absolute_ = std::max(absolute, 0.0);
+    relative_ = std::max(relative, 0.0);
+    return *this;
+}
+
+EmitPolicy& EmitPolicy::RateLimit(double per_second, double burst) {
+    rate_ = std::max(per_second, 0.0);
+    burst_ = std::max(burst, 1.0);
+    return *this;
+}
+
+int64_t EmitPolicy::GetConflationWindow() const { return window_ms_; }
+
+double EmitPolicy::GetAbsoluteDeadband() const { return absolute_; }
+
+double EmitPolicy::GetRelativeDeadband() const { return relative_; }
+
+double EmitPolicy::GetRate() const { return rate_; }
+
+double EmitPolicy::GetBurst() const { return burst_; }
+
+bool EmitPolicy::operator==(const EmitPolicy& other) const {
+    return window_ms_ == other.window_ms_ &&
+        absolute_ == other.absolute_ &&
+        relative_ == other.relative_ &&
+        rate_ == other.rate_ &&
+        burst_ == other.burst_;
+}
+
+bool EmitPolicy::operator!=(const EmitPolicy& other) const {
+    return !(*this == other);
+}
+
+////////////////
+// EmitShaper //
+////////////////
+EmitShaper::Feature::Feature(const EmitPolicy& policy)
+    : policy{policy} {}
+
+static std::string StateKey(const std::string& subject, const std::string& type, const std::string& instance) {
+    std::string key;
+    key.reserve(subject.size() + type.size() + instance.size() + 2);
+    key.append(subject).push_back('\0');
+    key.append(type).push_back('\0');
+    key.append(instance);
+    return key;
+}
+
+void EmitShaper::SetPolicy(const std::string& feature, const EmitPolicy& policy) {
+    features_[feature] = std::make_unique<Feature>(policy);
+}
+
+EmitShaper::Decision EmitShaper::Admit(const std::string& subject, const std::string& feature, const std::string& type,
+                                       const std::string& instance, const double* number, int64_t now_ms) {
+    auto it = features_.find(feature);
+    if (it == features_.end()) {
+        return Decision::SEND;
+    }
+
+    auto& f = *it->second;
+    const auto& policy = f.policy;
+
+    std::lock_guard<std::mutex> lock{f.mutex};
+    auto& state = f.states[StateKey(subject, type, instance)];
+
+    // Compare against the last value that was sent or is held back
+    if (number && state.has_last) {
+        auto delta = std::fabs(*number - state.last);
+
+        if (delta < policy.GetAbsoluteDeadband() || delta < policy.GetRelativeDeadband() * std::fabs(state.last)) {
+            f.stats.suppressed++;
+            return Decision::SUPPRESS;
+        }
+    }
+
+    if (policy.GetConflationWindow() > 0) {
+        if (state.holding) {
+            f.stats.conflated++;
+        } else {
+            state.holding = true;
+            state.hold_until_ms = now_ms + policy.GetConflationWindow();
+        }
+    } else if (policy.GetRate() > 0) {
+        if (state.refilled_ms == 0) {
+            state.tokens = policy.GetBurst();
+        } else {
+            auto elapsed = static_cast<double>(std::max<int64_t>(now_ms - state.refilled_ms, 0)) / 1000;
+            state.tokens = std::min(state.tokens + elapsed * policy.GetRate(), policy.GetBurst());
+        }
+
+        state.refilled_ms = now_ms;
+
+        if (state.tokens < 1) {
+            f.stats.suppressed++;
+            return Decision::SUPPRESS;
+        }
+
+        state.tokens -= 1;
+    }
+
+    if (number) {
+        state.has_last = true;
+        state.last = *number;
+    }
+
+    if (state.holding) {
+        return Decision::HOLD;
+    }
+
+    f.stats.sent++;
+    return Decision::SEND;
+}
+
+void EmitShaper::Hold(const std::string& subject, const std::string& feature, const std::string& type,
+                      const std::string& instance, const std::string& topic, const std::string& msg) {
+    auto it = features_.find(feature);
+    if (it == features_.end()) {
+        return;
+    }
+
+    auto& f = *it->second;
+
+    std::lock_guard<std::mutex> lock{f.mutex};
+    auto& state = f.states[StateKey(subject, type, instance)];
+
+    // The window may have been flushed since Admit(), send with the next flush
+    state.holding = true;
+    state.topic = topic;
+    state.msg = msg;
+}
+
+void EmitShaper::FlushExpired(int64_t now_ms, const emit_sink_func_ptr& sink) {
+    Flush(now_ms, false, sink);
+}
+
+void EmitShaper::Flush(const emit_sink_func_ptr& sink) {
+    Flush(0, true, sink);
+}
+
+void EmitShaper::Flush(int64_t now_ms, bool all, const emit_sink_func_ptr& sink) {
+    std::vector<std::pair<std::string, std::string>> expired;
+
+    for (auto& p : features_) {
+        auto& f = *p.second;
+
+        if (f.policy.GetConflationWindow() == 0) {
+            continue;
+        }
+
+        std::lock_guard<std::mutex> lock{f.mutex};
+
+        for (auto& s : f.states) {
+            auto& state = s.second;
+
+            // Skip events whose Hold() has not been called yet
+            if (!state.holding || state.msg.empty() || (!all && state.hold_until_ms > now_ms)) {
+                continue;
+            }
+
+            state.holding = false;
+            expired.emplace_back(std::move(state.topic), std::move(state.msg));
+            state.msg.clear();
+            f.stats.sent++;
+        }
+    }
+
+    // Sent without holding a lock, the sink may block
+    for (const auto& e : expired) {
+        sink(e.first, e.second);
+    }
+}
+
+int64_t EmitShaper::GetMinConflationWindow() const {
+    int64_t window = 0;
+
+    for (const auto& p : features_) {
+        auto w = p.second->policy.GetConflationWindow();
+
+        if (w > 0 && (window == 0 || w < window)) {
+            window = w;
+        }
+    }
+
+    return window;
+}
+
+std::unordered_map<std::string, EmitStats> EmitShaper::GetStats() const {
+    std::unordered_map<std::string, EmitStats> stats;
+
+    for (const auto& p : features_) {
+        std::lock_guard<std::mutex> lock{p.second->mutex};
+        stats[p.first] = p.second->stats;
+    }
+
+    return stats;
+}
+
+}  // namespace core
+}  // namespace iotea
@@ -11,6 +11,7 @@
 #include "event.hpp"
 
 #include <limits>
+#include <mutex>
 #include <regex>
 #include <utility>
 #include <vector>
@@ -144,32 +145,101 @@ error_message_ptr ErrorMessage::FromJson(const json& j) {
 //
 // Event
 //
+struct Event::State {
+    // Events created from fields are fully decoded
+    bool lazy = false;
+    RawJsonObject raw;
+
+    std::once_flag header_once;
+    std::once_flag value_once;
+    std::once_flag features_once;
+
+    std::string return_topic;
+    std::string subject;
+    std::string feature;
+    json value;
+    json features;
+    std::string type;
+    std::string instance;
+    int64_t when = 0;
+};
+
+static const char EVENT_SUBJECT[] = "subject";
+static const char EVENT_FEATURE[] = "feature";
+static const char EVENT_VALUE[] = "value";
+static const char EVENT_FEATURES[] = "$features";
+static const char EVENT_TYPE[] = "type";
+static const char EVENT_INSTANCE[] = "instance";
+static const char EVENT_RETURN_TOPIC[] = "returnTopic";
+static const char EVENT_WHEN[] = "whenMs";
+
 Event::Event(const std::string& subject, const std::string& feature, const json& value, const json& features,
              const std::string& type, const std::string& instance, const std::string& return_topic, int64_t when)
-    : return_topic_{return_topic}
-    , subject_{subject}
-    , feature_{feature}
-    , value_(value)
-    , features_(features)
-    , type_{type}
-    , instance_{instance}
-    , when_{when} {}
+    : state_{std::make_shared<State>()} {
+    state_->return_topic = return_topic;
+    state_->subject = subject;
+    state_->feature = feature;
+    state_->value = value;
+    state_->features = features;
+    state_->type = type;
+    state_->instance = instance;
+    state_->when = when;
+}
+
+Event::Event()
+    : state_{std::make_shared<State>()} {}
+
+const Event::State& Event::Header() const {
+    if (state_->lazy) {
+        std::call_once(state_->header_once, [this] {
+            auto& s = *state_;
+            const auto& raw = s.raw;
+
+            s.subject = raw.DecodeString(*raw.Find(EVENT_SUBJECT));
+            s.feature = raw.DecodeString(*raw.Find(EVENT_FEATURE));
+            s.type = raw.DecodeString(*raw.Find(EVENT_TYPE));
+            s.instance = raw.DecodeString(*raw.Find(EVENT_INSTANCE));
+            s.when = raw.DecodeInt(*raw.Find(EVENT_WHEN));
+
+            auto return_topic = raw.Find(EVENT_RETURN_TOPIC);
+            s.return_topic = return_topic ? raw.DecodeString(*return_topic) : "";
+        });
+    }
+
+    return *state_;
+}
 
-std::string Event::GetReturnTopic() const { return return_topic_; }
+const std::string& Event::GetReturnTopic() const { return Header().return_topic; }
 
-std::string Event::GetSubject() const { return subject_; }
+const std::string& Event::GetSubject() const { return Header().subject; }
+
+const std::string& Event::GetFeature() const { return Header().feature; }
+
+const json& Event::GetValue() const {
+    if (state_->lazy) {
+        std::call_once(state_->value_once, [this] {
+            state_->value = state_->raw.Decode(EVENT_VALUE);
+        });
+    }
 
-std::string Event::GetFeature() const { return feature_; }
+    return state_->value;
+}
 
-json Event::GetValue() const { return value_; }
+const json& Event::GetFeatures() const {
+    if (state_->lazy) {
+        std::call_once(state_->features_once, [this] {
+            state_->features = state_->raw.Decode(EVENT_FEATURES);
+        });
+    }
 
-json Event::GetFeatures() const { return features_; }
+    return state_->features;
+}
 
-std::string Event::GetType() const { return type_; }
+const std::string& Event::GetType() const { return Header().type; }
 
-std::string Event::GetInstance() const { return instance_; }
+const std::string& Event::GetInstance() const { return Header().instance; }
 
-int64_t Event::GetWhen() const { return when_; }
+int64_t Event::GetWhen() const { return Header().when; }
 
 bool Event::operator==(const Event& other) const {
     return GetSubject() == other.GetSubject()
@@ -183,13 +253,13 @@ bool Event::operator==(const Event& other) const {
 
 json Event::Json() const {
     return json{
-        {"subject", subject_},
-        {"feature", feature_},
-        {"value", value_},
-        {"$features", features_},
-        {"type", type_},
-        {"instance", instance_},
-        {"whenMs", when_}
+        {EVENT_SUBJECT, GetSubject()},
+        {EVENT_FEATURE, GetFeature()},
+        {EVENT_VALUE, GetValue()},
+        {EVENT_FEATURES, GetFeatures()},
+        {EVENT_TYPE, GetType()},
+        {EVENT_INSTANCE, GetInstance()},
+        {EVENT_WHEN, GetWhen()}
     };
 }
 
@@ -206,6 +276,28 @@ event_ptr Event::FromJson(const json& j) {
     return std::make_shared<Event>(subject, feature, value, features, type, instance, return_topic, when_ms);
 }
 
+event_ptr Event::FromRaw(RawJsonObject raw) {
+    if (!raw.IsValid()) {
+        return nullptr;
+    }
+
+    for (auto key : {EVENT_SUBJECT, EVENT_FEATURE, EVENT_TYPE, EVENT_INSTANCE, EVENT_WHEN}) {
+        if (!raw.Find(key)) {
+            return nullptr;
+        }
+    }
+
+    auto event = std::make_shared<Event>();
+    event->state_->lazy = true;
+    event->state_->raw = std::move(raw);
+
+    return event;
+}
+
+const payload_ptr& Event::GetPayload() const {
+    return state_->raw.GetPayload();
+}
+
 
 }  // namespace core
 }  // namespace iotea
@@ -0,0 +1,130 @@
+/*****************************************************************************
+ * Copyright (c) 2021 Bosch.IO GmbH
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * SPDX-License-Identifier: MPL-2.0
+ ****************************************************************************/
+
+#include <atomic>
+#include <cstring>
+#include <random>
+
+#include "id_generator.hpp"
+
+namespace iotea {
+namespace core {
+
+/**
+ * @brief HexTable maps each octet to its two hex digits.
+ */
+struct HexTable {
+    char pairs[256][2];
+
+    HexTable() {
+        static constexpr char chars[] = "0123456789abcdef";
+
+        for (int i = 0; i < 256; i++) {
+            pairs[i][0] = chars[i >> 4];
+            pairs[i][1] = chars[i & 0x0f];
+        }
+    }
+};
+
+static const HexTable hex_table;
+
+static char* WriteHex(char* out, const uint8_t* bits, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        std::memcpy(out, hex_table.pairs[bits[i]], 2);
+        out += 2;
+    }
+
+    return out;
+}
+
+static std::mt19937_64& GetEngine() {
+    // Seeding is expensive (std::random_device may read from the kernel) and
+    // is therefore only done once per thread.
+    thread_local std::mt19937_64 engine{[] {
+        std::random_device rd;
+        std::seed_seq seq{rd(), rd(), rd(), rd(), rd(), rd(), rd(), rd()};
+        return std::mt19937_64{seq};
+    }()};
+
+    return engine;
+}
+
+void GenerateUUID4Bits(uint8_t bits[16]) {
+    auto& engine = GetEngine();
+
+    uint64_t hi = engine();
+    uint64_t lo = engine();
+    std::memcpy(bits, &hi, sizeof(hi));
+    std::memcpy(bits + 8, &lo, sizeof(lo));
+
+    // RFC 4122, section 4.4: the four most significant bits of
+    // time_hi_and_version (octet 6) hold the version number (4) and the two
+    // most significant bits of clock_seq_hi_and_reserved (octet 8) are set to
+    // one and zero.
+    bits[6] = (bits[6] & 0x0f) | 0x40;
+    bits[8] = (bits[8] & 0x3f) | 0x80;
+}
+
+std::string FormatUUID(const uint8_t bits[16]) {
+    std::string s(36, '-');
+    auto out = &s[0];
+
+    out = WriteHex(out, bits, 4) + 1;
+    out = WriteHex(out, bits + 4, 2) + 1;
+    out = WriteHex(out, bits + 6, 2) + 1;
+    out = WriteHex(out, bits + 8, 2) + 1;
+    WriteHex(out, bits + 10, 6);
+
+    return s;
+}
+
+std::string GenerateUUID4() {
+    uint8_t bits[16];
+    GenerateUUID4Bits(bits);
+    return FormatUUID(bits);
+}
+
+std::string GenerateCompactId() {
+    static const std::string prefix = [] {
+        std::random_device rd;
+        uint8_t bits[8];
+
+        for (size_t i = 0; i < sizeof(bits); i += 4) {
+            auto r = static_cast<uint32_t>(rd());
+            std::memcpy(bits + i, &r, 4);
+        }
+
+        std::string p(16, '0');
+        WriteHex(&p[0], bits, sizeof(bits));
+        return p + "-";
+    }();
+
+    static std::atomic<uint64_t> counter{0};
+    auto n = counter.fetch_add(1, std::memory_order_relaxed);
+
+    // Hex encode the counter without leading zeros
+    char buf[16];
+    auto end = buf + sizeof(buf);
+    auto p = end;
+    do {
+        *--p = "0123456789abcdef"[n & 0x0f];
+        n >>= 4;
+    } while (n);
+
+    std::string id;
+    id.reserve(prefix.size() + (end - p));
+    id.append(prefix);
+    id.append(p, end);
+
+    return id;
+}
+
+}  // namespace core
+}  // namespace iotea
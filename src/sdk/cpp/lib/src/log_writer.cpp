@@ -0,0 +1,367 @@
+/*****************************************************************************
+ * Copyright (c) 2021 Bosch.IO GmbH
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * SPDX-License-Identifier: MPL-2.0
+ ****************************************************************************/
+
+#include <algorithm>
+#include <ctime>
+
+#include "log_writer.hpp"
+
+namespace iotea {
+namespace core {
+namespace logging {
+
+// The number of ms the writer sleeps if there is nothing to write
+static constexpr auto WRITER_IDLE_INTERVAL = std::chrono::milliseconds{10};
+
+// Batches are written as soon as they exceed this size
+static constexpr size_t MAX_BATCH_SIZE = 64 * 1024;
+
+static size_t RoundUpToPowerOfTwo(size_t n) {
+    size_t p = 1;
+    while (p < n) {
+        p <<= 1;
+    }
+
+    return p;
+}
+
+/////////////
+// LogRing //
+/////////////
+LogRing::LogRing(size_t capacity)
+    : records_(RoundUpToPowerOfTwo(std::max<size_t>(capacity, 2)))
+    , mask_{records_.size() - 1} {}
+
+bool LogRing::Push(LogRecord& record) {
+    auto tail = tail_.load(std::memory_order_relaxed);
+
+    if (tail - head_.load(std::memory_order_acquire) == records_.size()) {
+        return false;
+    }
+
+    records_[tail & mask_] = std::move(record);
+    tail_.store(tail + 1, std::memory_order_release);
+    return true;
+}
+
+bool LogRing::Pop(LogRecord& record) {
+    auto head = head_.load(std::memory_order_relaxed);
+
+    if (head == tail_.load(std::memory_order_acquire)) {
+        return false;
+    }
+
+    record = std::move(records_[head & mask_]);
+    head_.store(head + 1, std::memory_order_release);
+    return true;
+}
+
+void LogRing::Close() {
+    closed_.store(true, std::memory_order_release);
+}
+
+bool LogRing::IsClosed() const {
+    return closed_.load(std::memory_order_acquire);
+}
+
+////////////////////
+// AsyncLogWriter //
+////////////////////
+static std::atomic<uint64_t> next_writer_id{0};
+
+// Set once the rings of the current thread have been released
+static thread_local bool thread_exiting = false;
+
+AsyncLogWriter::AsyncLogWriter(size_t ring_capacity)
+    : id_{next_writer_id++}
+    , ring_capacity_{ring_capacity} {
+    thread_ = std::thread{&AsyncLogWriter::Run, this};
+}
+
+AsyncLogWriter::~AsyncLogWriter() {
+    Stop();
+
+    if (output_ != stdout) {
+        std::fclose(output_);
+    }
+}
+
+bool AsyncLogWriter::SetOutput(const std::string& path) {
+    FILE* output = stdout;
+
+    if (!path.empty()) {
+        output = std::fopen(path.c_str(), "a");
+        if (!output) {
+            return false;
+        }
+    }
+
+    std::lock_guard<std::mutex> lock{output_mutex_};
+    if (output_ != stdout) {
+        std::fclose(output_);
+    }
+
+    output_ = output;
+    return true;
+}
+
+void AsyncLogWriter::SetOverflowPolicy(OverflowPolicy policy) {
+    policy_.store(policy);
+}
+
+uint64_t AsyncLogWriter::GetDroppedCount() const {
+    return dropped_.load();
+}
+
+std::shared_ptr<LogRing> AsyncLogWriter::GetRing() {
+    // Each thread owns one ring per writer. The rings are closed when the
+    // thread terminates and the writer discards them once they are empty.
+    struct ThreadRings {
+        std::vector<std::pair<uint64_t, std::shared_ptr<LogRing>>> rings;
+
+        ~ThreadRings() {
+            thread_exiting = true;
+
+            for (auto& r : rings) {
+                r.second->Close();
+            }
+        }
+    };
+
+    thread_local ThreadRings thread_rings;
+
+    for (const auto& r : thread_rings.rings) {
+        if (r.first == id_) {
+            return r.second;
+        }
+    }
+
+    auto ring = std::make_shared<LogRing>(ring_capacity_);
+    thread_rings.rings.emplace_back(id_, ring);
+
+    std::lock_guard<std::mutex> lock{rings_mutex_};
+    rings_.push_back(ring);
+
+    return ring;
+}
+
+void AsyncLogWriter::Write(Level level, std::chrono::system_clock::time_point time, std::string&& text) {
+    LogRecord record{level, time, std::move(text)};
+
+    // Stop() waits for the writers that saw it running before its final
+    // Drain(), so that no pushed record is left behind
+    writers_.fetch_add(1);
+    auto queued = !stopped_.load() && !thread_exiting && Enqueue(record);
+    writers_.fetch_sub(1);
+
+    if (queued) {
+        return;
+    }
+
+    // The writer has been stopped or the thread is terminating, write
+    // synchronously
+    std::lock_guard<std::mutex> lock{output_mutex_};
+    std::string line;
+    Append(line, record);
+    Output(line);
+}
+
+bool AsyncLogWriter::Enqueue(LogRecord& record) {
+    auto ring = GetRing();
+
+    if (ring->Push(record)) {
+        return true;
+    }
+
+    if (policy_.load() == OverflowPolicy::DROP) {
+        dropped_++;
+        return true;
+    }
+
+    // Wake the writer and wait for it to make room
+    while (!stopped_.load()) {
+        {
+            std::lock_guard<std::mutex> lock{mutex_};
+            wake_ = true;
+        }
+        cv_.notify_one();
+        std::this_thread::yield();
+
+        if (ring->Push(record)) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void AsyncLogWriter::Flush() {
+    std::unique_lock<std::mutex> lock{mutex_};
+
+    if (stopped_.load()) {
+        return;
+    }
+
+    auto generation = ++flush_requested_;
+    wake_ = true;
+    cv_.notify_one();
+
+    flushed_cv_.wait(lock, [this, generation] { return flush_done_ >= generation || stopped_.load(); });
+}
+
+void AsyncLogWriter::Stop() {
+    {
+        std::lock_guard<std::mutex> lock{mutex_};
+        if (stopped_.load()) {
+            return;
+        }
+
+        stopped_.store(true);
+    }
+
+    cv_.notify_one();
+
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+
+    flushed_cv_.notify_all();
+
+    // Catch lines pushed while the writer was shutting down
+    while (writers_.load() > 0) {
+        std::this_thread::yield();
+    }
+
+    Drain();
+}
+
+void AsyncLogWriter::Run() {
+    std::unique_lock<std::mutex> lock{mutex_};
+
+    while (true) {
+        auto generation = flush_requested_;
+        lock.unlock();
+
+        auto n = Drain();
+
+        lock.lock();
+        if (n > 0) {
+            continue;
+        }
+
+        // Everything queued before the flush request has been written
+        flush_done_ = generation;
+        flushed_cv_.notify_all();
+
+        if (stopped_.load()) {
+            return;
+        }
+
+        cv_.wait_for(lock, WRITER_IDLE_INTERVAL, [this] { return wake_ || stopped_.load(); });
+        wake_ = false;
+    }
+}
+
+size_t AsyncLogWriter::Drain() {
+    std::vector<std::shared_ptr<LogRing>> rings;
+    {
+        std::lock_guard<std::mutex> lock{rings_mutex_};
+        rings = rings_;
+    }
+
+    std::lock_guard<std::mutex> lock{output_mutex_};
+
+    std::string batch;
+    LogRecord record;
+    size_t n = 0;
+    std::vector<std::shared_ptr<LogRing>> exhausted;
+
+    for (const auto& ring : rings) {
+        // A ring closed before it is drained receives no further records
+        auto closed = ring->IsClosed();
+
+        while (ring->Pop(record)) {
+            Append(batch, record);
+            n++;
+
+            if (batch.size() >= MAX_BATCH_SIZE) {
+                Output(batch);
+                batch.clear();
+            }
+        }
+
+        if (closed) {
+            exhausted.push_back(ring);
+        }
+    }
+
+    auto dropped = dropped_.load();
+    if (dropped != reported_dropped_) {
+        auto text = "[Logging] : Dropped " + std::to_string(dropped - reported_dropped_) + " log lines";
+        Append(batch, LogRecord{Level::WARNING, std::chrono::system_clock::now(), text});
+        reported_dropped_ = dropped;
+    }
+
+    if (!batch.empty()) {
+        Output(batch);
+    }
+
+    if (!exhausted.empty()) {
+        std::lock_guard<std::mutex> lock{rings_mutex_};
+        rings_.erase(std::remove_if(rings_.begin(), rings_.end(), [&exhausted](const auto& r) {
+            return std::find(exhausted.begin(), exhausted.end(), r) != exhausted.end();
+        }), rings_.end());
+    }
+
+    return n;
+}
+
+void AsyncLogWriter::Append(std::string& batch, const LogRecord& record) {
+    static const char* tags[]{
+        "   DEBUG ",
+        "    INFO ",
+        "    WARN ",
+        "   ERROR ",
+    };
+
+    auto since_epoch = record.time.time_since_epoch();
+    auto millis = std::chrono::duration_cast<std::chrono::milliseconds>(since_epoch).count();
+    auto second = millis / 1000;
+
+    // Only reformat the date and time when the second changes
+    if (second != cached_second_) {
+        auto ts = static_cast<std::time_t>(second);
+        std::tm tm;
+        gmtime_r(&ts, &tm);
+        std::strftime(cached_timestamp_, sizeof(cached_timestamp_), "%FT%T", &tm);
+        cached_second_ = second;
+    }
+
+    char fraction[6] = {'.', '0', '0', '0', 'Z', '\0'};
+    auto ms = millis % 1000;
+    fraction[1] = static_cast<char>('0' + ms / 100);
+    fraction[2] = static_cast<char>('0' + (ms / 10) % 10);
+    fraction[3] = static_cast<char>('0' + ms % 10);
+
+    batch.append(cached_timestamp_);
+    batch.append(fraction);
+    batch.append(tags[static_cast<int>(record.level)]);
+    batch.append(record.text);
+    batch.push_back('\n');
+}
+
+void AsyncLogWriter::Output(const std::string& batch) {
+    std::fwrite(batch.data(), 1, batch.size(), output_);
+    std::fflush(output_);
+}
+
+}  // namespace logging
+}  // namespace core
+}  // namespace iotea
@@ -9,10 +9,8 @@
  ****************************************************************************/
 
 #include <chrono>
-#include <iostream>
-#include <iomanip>
-#include <mutex>
-#include <sstream>
+#include <cstdlib>
+#include <memory>
 #include <string>
 
 #include "util.hpp"
@@ -54,45 +52,37 @@ Level GetLogLevel() {
 // InternalLogger
 //
 InternalLogger::InternalLogger()
-    : os_{std::cout.rdbuf()} {}
+    : writer_{new AsyncLogWriter} {
+    // The writer is never destroyed so that it can be used while other
+    // static objects are destroyed. Lines logged after the writer has been
+    // stopped are written synchronously.
+    std::atexit([] { InternalLogger::Get()->GetWriter()->Stop(); });
+}
 
 InternalLogger* InternalLogger::Get() {
-    static InternalLogger logger;
-    return &logger;
+    static auto logger = new InternalLogger;
+    return logger;
 }
 
-Level InternalLogger::GetLevel() const { return level_; }
+Level InternalLogger::GetLevel() const { return level_.load(std::memory_order_relaxed); }
 
-void InternalLogger::SetLevel(const Level level) { level_ = level; }
+void InternalLogger::SetLevel(const Level level) { level_.store(level); }
 
-std::ostream& InternalLogger::GetStream() { return os_; }
+AsyncLogWriter* InternalLogger::GetWriter() { return writer_; }
 
 //
 // Logger
 //
-Logger::Logger(InternalLogger* logger, const Level level, int call_depth)
-    : logger_{logger}
-    , level_{level}
-    , call_depth_{call_depth} {
-    logger->mutex_.lock();
-}
-
-Logger::Logger(InternalLogger* logger)
-    : Logger{logger, Level::INFO, 0} {}
-
-Logger::Logger(const Logger& other)
-    : Logger{other.logger_, other.level_, other.call_depth_ + 1} {}
+Logger::Logger(std::shared_ptr<Line> line)
+    : line_{std::move(line)} {}
 
-Logger::~Logger() {
-    if (call_depth_ == 0) {
-        *this << '\n';
-    }
-    logger_->mutex_.unlock();
+Logger::Line::~Line() {
+    InternalLogger::Get()->GetWriter()->Write(level, time, os.str());
 }
 
 Logger& Logger::operator<<(const std::ostream& (*f)(std::ostream&)) {
-    if (logger_->GetLevel() <= level_) {
-        logger_->GetStream() << f;
+    if (line_) {
+        line_->os << f;
     }
 
     return *this;
@@ -102,32 +92,41 @@ Logger& Logger::operator<<(const std::ostream& (*f)(std::ostream&)) {
 // Friend functions
 //
 void SetLevel(const Level level) {
-    Logger p{InternalLogger::Get()};
-    p.logger_->SetLevel(level);
+    InternalLogger::Get()->SetLevel(level);
 }
 
-Logger Log(const Level level) {
-    auto now = std::chrono::system_clock::now();
-    auto ts = std::chrono::system_clock::to_time_t(now);
-    auto duration = now.time_since_epoch();
-    auto millis = std::chrono::duration_cast<std::chrono::milliseconds>(duration).count();
+bool IsEnabled(const Level level) {
+    return InternalLogger::Get()->GetLevel() <= level;
+}
 
-    Logger p{InternalLogger::Get(), level};
+bool SetOutput(const std::string& path) {
+    return InternalLogger::Get()->GetWriter()->SetOutput(path);
+}
 
-    static const char* tags[]{
-        "   DEBUG ",
-        "    INFO ",
-        "    WARN ",
-        "   ERROR ",
-    };
+void SetOverflowPolicy(OverflowPolicy policy) {
+    InternalLogger::Get()->GetWriter()->SetOverflowPolicy(policy);
+}
+
+void Flush() {
+    InternalLogger::Get()->GetWriter()->Flush();
+}
 
+uint64_t GetDroppedCount() {
+    return InternalLogger::Get()->GetWriter()->GetDroppedCount();
+}
+
+Logger Log(const Level level) {
+    // Disabled levels produce a Logger without a line, the timestamp is
+    // formatted by the writer.
+    if (!IsEnabled(level)) {
+        return Logger{nullptr};
+    }
 
-    std::ostringstream ss;
-    ss << std::put_time(gmtime(&ts), "%FT%T");
-    ss << "." << std::setfill('0') << std::setw(3) << (millis % 1000) << "Z";
-    p <<  ss.str() << tags[static_cast<int>(level)];
+    auto line = std::make_shared<Logger::Line>();
+    line->level = level;
+    line->time = std::chrono::system_clock::now();
 
-    return p;
+    return Logger{std::move(line)};
 }
 
 Logger Debug() { return Log(Level::DEBUG); }
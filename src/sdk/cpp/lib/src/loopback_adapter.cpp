@@ -0,0 +1,164 @@
+/*****************************************************************************
+ * Copyright (c) 2021 Bosch.IO GmbH
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * SPDX-License-Identifier: MPL-2.0
+ ****************************************************************************/
+
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "common.hpp"
+#include "logging.hpp"
+#include "loopback_adapter.hpp"
+
+namespace iotea {
+namespace core {
+
+using namespace std::chrono_literals;
+
+static auto logger = iotea::core::logging::NamedLogger{"LoopbackAdapter"};
+
+constexpr size_t LoopbackAdapter::DEFAULT_RECEIVE_BATCH_SIZE;
+
+/////////////////
+// LoopbackBus //
+/////////////////
+std::shared_ptr<LoopbackBus> LoopbackBus::Get(const std::string& name) {
+    static std::mutex mutex;
+    static std::unordered_map<std::string, std::weak_ptr<LoopbackBus>> buses;
+
+    std::lock_guard<std::mutex> lock{mutex};
+
+    auto bus = buses[name].lock();
+    if (!bus) {
+        bus = std::make_shared<LoopbackBus>();
+        buses[name] = bus;
+    }
+
+    return bus;
+}
+
+void LoopbackBus::Subscribe(const std::string& filter, const inbox_ptr& inbox, on_payload_func_ptr on_msg) {
+    std::lock_guard<std::mutex> lock{mutex_};
+
+    std::shared_ptr<Group> group;
+
+    if (filter.compare(0, 7, "$share/") == 0) {
+        auto& share = shares_[filter];
+        if (!share) {
+            share = std::make_shared<Group>();
+            groups_.Insert(filter, share);
+        }
+
+        group = share;
+    } else {
+        group = std::make_shared<Group>();
+        groups_.Insert(filter, group);
+    }
+
+    group->subscribers.push_back(Subscriber{inbox, std::move(on_msg)});
+}
+
+void LoopbackBus::Publish(const std::string& topic, const payload_ptr& payload) {
+    std::lock_guard<std::mutex> lock{mutex_};
+
+    groups_.Match(topic, [&topic, &payload](const std::shared_ptr<Group>& group) {
+        auto n = group->subscribers.size();
+
+        // Hand the message to the next subscriber whose adapter still exists
+        for (size_t i = 0; i < n; i++) {
+            const auto& subscriber = group->subscribers[group->next++ % n];
+
+            auto inbox = subscriber.inbox.lock();
+            if (inbox) {
+                inbox->Push(Delivery{topic, payload, subscriber.on_msg});
+                return;
+            }
+        }
+    });
+}
+
+/////////////////////
+// LoopbackAdapter //
+/////////////////////
+LoopbackAdapter::LoopbackAdapter(const std::string& name, bool is_platform_proto, const json& config)
+    : Adapter{name, is_platform_proto}
+    , bus_{LoopbackBus::Get(config.value("bus", std::string{"default"}))}
+    , topic_ns_{config.value("topicNamespace", std::string{MQTT_TOPIC_NS} + "/")}
+    , batch_size_{std::max<size_t>(config.value("receiveBatchSize", DEFAULT_RECEIVE_BATCH_SIZE), 1)}
+    , inbox_{std::make_shared<BatchQueue<LoopbackBus::Delivery>>()} {}
+
+void LoopbackAdapter::Start() {
+    std::vector<LoopbackBus::Delivery> batch;
+
+    while (!stopped_.load()) {
+        inbox_->PopBatch(batch, batch_size_, 100ms);
+
+        for (const auto& d : batch) {
+            d.on_msg(d.topic, d.payload, name_);
+        }
+
+        batch.clear();
+    }
+
+    stopped_ = false;
+}
+
+void LoopbackAdapter::Stop() {
+    stopped_ = true;
+    inbox_->Wake();
+}
+
+bool LoopbackAdapter::Publish(const std::string& topic, const std::string& data, const PublishOptions&) {
+    // The only copy of the payload, all subscribers share it
+    Publish(topic, std::make_shared<const std::string>(data));
+    return true;
+}
+
+void LoopbackAdapter::Publish(const std::string& topic, const payload_ptr& payload) {
+    auto full_topic = topic_ns_ + topic;
+
+    IOTEA_LOG_DEBUG(logger) << "Publishing message.";
+    IOTEA_LOG_DEBUG(logger) << "\ttopic: '" << full_topic << "'";
+    IOTEA_LOG_DEBUG(logger) << "\tpayload: '" << *payload << "'";
+
+    bus_->Publish(full_topic, payload);
+}
+
+void LoopbackAdapter::Subscribe(const std::string& topic, on_msg_func_ptr on_msg, const SubscribeOptions& opts) {
+    SubscribePayload(topic, [on_msg](const std::string& t, const payload_ptr& m, const std::string& a) {
+        on_msg(t, *m, a);
+    }, opts);
+}
+
+void LoopbackAdapter::SubscribeShared(const std::string& group, const std::string& topic, on_msg_func_ptr on_msg, const SubscribeOptions& opts) {
+    SubscribeSharedPayload(group, topic, [on_msg](const std::string& t, const payload_ptr& m, const std::string& a) {
+        on_msg(t, *m, a);
+    }, opts);
+}
+
+void LoopbackAdapter::SubscribePayload(const std::string& topic, on_payload_func_ptr on_msg, const SubscribeOptions&) {
+    auto topic_with_ns = topic_ns_ + topic;
+
+    IOTEA_LOG_DEBUG(logger) << "Subscribing to " << topic_with_ns;
+    bus_->Subscribe(topic_with_ns, inbox_, std::move(on_msg));
+}
+
+void LoopbackAdapter::SubscribeSharedPayload(const std::string& group, const std::string& topic, on_payload_func_ptr on_msg, const SubscribeOptions&) {
+    auto shared_topic = std::string{"$share"} + "/" + group + "/" + topic_ns_ + topic;
+
+    IOTEA_LOG_DEBUG(logger) << "Subscribing to " << shared_topic;
+    bus_->Subscribe(shared_topic, inbox_, std::move(on_msg));
+}
+
+}  // namespace core
+}  // namespace iotea
@@ -0,0 +1,120 @@
+/*****************************************************************************
+ * Copyright (c) 2021 Bosch.IO GmbH
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * SPDX-License-Identifier: MPL-2.0
+ ****************************************************************************/
+
+#include "outbox.hpp"
+
+#include <algorithm>
+
+#include "logging.hpp"
+#include "util.hpp"
+
+namespace iotea {
+namespace core {
+
+static auto logger = logging::NamedLogger("Outbox");
+
+Outbox::Outbox(gateway_ptr gateway, size_t max_events, int64_t max_delay_ms)
+    : gateway_{gateway}
+    , max_events_{std::max<size_t>(max_events, 1)}
+    , max_delay_ms_{std::max<int64_t>(max_delay_ms, 0)} {}
+
+int64_t Outbox::GetMaxDelay() const {
+    return max_delay_ms_;
+}
+
+void Outbox::SetPublisher(publisher_ptr publisher) {
+    publisher_ = publisher;
+}
+
+PublishStatus Outbox::Post(const std::string& topic, const std::string& msg) {
+    std::lock_guard<std::mutex> lock{mutex_};
+
+    auto& pending = pending_[topic];
+
+    if (pending.count == 0) {
+        pending.since_ms = GetEpochTimeMs();
+    } else {
+        pending.msgs.push_back(',');
+    }
+
+    pending.msgs.append(msg);
+    pending.count++;
+
+    if (pending.count < max_events_) {
+        return PublishStatus::OK;
+    }
+
+    Take(topic, pending);
+    return PublishTaken();
+}
+
+void Outbox::FlushExpired(int64_t now_ms) {
+    std::lock_guard<std::mutex> lock{mutex_};
+
+    for (auto& p : pending_) {
+        if (p.second.count > 0 && now_ms - p.second.since_ms >= max_delay_ms_) {
+            Take(p.first, p.second);
+        }
+    }
+
+    PublishTaken();
+}
+
+void Outbox::Flush() {
+    std::lock_guard<std::mutex> lock{mutex_};
+
+    for (auto& p : pending_) {
+        if (p.second.count > 0) {
+            Take(p.first, p.second);
+        }
+    }
+
+    PublishTaken();
+}
+
+void Outbox::Take(const std::string& topic, Pending& pending) {
+    std::string msg;
+
+    if (pending.count == 1) {
+        msg.swap(pending.msgs);
+    } else {
+        msg.reserve(pending.msgs.size() + 2);
+        msg.push_back('[');
+        msg.append(pending.msgs);
+        msg.push_back(']');
+        pending.msgs.clear();
+    }
+
+    pending.count = 0;
+    entries_.push_back(PublishEntry{topic, std::move(msg), PublishOptions{false, ""}});
+}
+
+PublishStatus Outbox::PublishTaken() {
+    auto status = PublishStatus::OK;
+
+    if (entries_.empty()) {
+        return status;
+    }
+
+    if (publisher_) {
+        for (const auto& e : entries_) {
+            status = std::max(status, publisher_->Post(e.topic, e.msg));
+        }
+    } else if (!gateway_->PublishBatch(entries_)) {
+        logger.Warn() << "Failed to publish " << entries_.size() << " batches of events.";
+        status = PublishStatus::DROPPED;
+    }
+
+    entries_.clear();
+    return status;
+}
+
+}  // namespace core
+}  // namespace iotea
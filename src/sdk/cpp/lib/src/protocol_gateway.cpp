@@ -12,8 +12,12 @@
 #include <algorithm>
 #include <fstream>
 #include <iostream>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
 
 #include "logging.hpp"
+#include "loopback_adapter.hpp"
 #include "protocol_gateway.hpp"
 
 namespace iotea {
@@ -32,7 +36,7 @@ bool PubSubOptions::IsPlatformProtoOnly() const {
     return platform_proto_only_;
 }
 
-std::string PubSubOptions::GetAdapterId() const {
+const std::string& PubSubOptions::GetAdapterId() const {
     return adapter_id_;
 }
 
@@ -45,10 +49,13 @@ bool PubSubOptions::operator==(const PubSubOptions& other) const {
 ////////////////////
 // PublishOptions //
 ////////////////////
-PublishOptions::PublishOptions(bool platform_proto_only, const std::string& adapter_id)
+constexpr int PublishOptions::DEFAULT_QOS;
+
+PublishOptions::PublishOptions(bool platform_proto_only, const std::string& adapter_id, int qos)
     : PubSubOptions{platform_proto_only, adapter_id}
     , retain_{false}
-    , stash_{true} {}
+    , stash_{true}
+    , qos_{qos} {}
 
 bool PublishOptions::Retain() const {
     return retain_;
@@ -58,10 +65,15 @@ bool PublishOptions::Stash() const {
     return stash_;
 }
 
+int PublishOptions::Qos() const {
+    return qos_;
+}
+
 bool PublishOptions::operator==(const PublishOptions& other) const {
     return this->PubSubOptions::operator==(other) &&
         retain_ == other.retain_ &&
-        stash_ == other.stash_;
+        stash_ == other.stash_ &&
+        qos_ == other.qos_;
 }
 
 
@@ -90,6 +102,30 @@ bool Adapter::IsPlatformProto() const {
     return is_platform_proto_;
 }
 
+bool Adapter::PublishBatch(const PublishEntry* entries, size_t count) {
+    auto accepted = true;
+
+    for (size_t i = 0; i < count; i++) {
+        if (!Publish(entries[i].topic, entries[i].msg, entries[i].opts)) {
+            accepted = false;
+        }
+    }
+
+    return accepted;
+}
+
+void Adapter::SubscribePayload(const std::string& topic, on_payload_func_ptr on_msg, const SubscribeOptions& opts) {
+    Subscribe(topic, [on_msg](const std::string& t, const std::string& m, const std::string& a) {
+        on_msg(t, std::make_shared<const std::string>(m), a);
+    }, opts);
+}
+
+void Adapter::SubscribeSharedPayload(const std::string& group, const std::string& topic, on_payload_func_ptr on_msg, const SubscribeOptions& opts) {
+    SubscribeShared(group, topic, [on_msg](const std::string& t, const std::string& m, const std::string& a) {
+        on_msg(t, std::make_shared<const std::string>(m), a);
+    }, opts);
+}
+
 //////////////////////////////
 // ProtocolGatewayException //
 //////////////////////////////
@@ -115,7 +151,7 @@ const PublishOptions ProtocolGateway::DefaultPublishOptions{false, ""};
 const SubscribeOptions ProtocolGateway::DefaultSubscribeOptions{false, ""};
 
 void ProtocolGateway::ValidateConfig(const json& config, bool platform_proto_only) {
-    logger.Debug() << "ProtocolGateway config: \n" << config.dump(2);
+    IOTEA_LOG_DEBUG(logger) << "ProtocolGateway config: \n" << config.dump(2);
     auto adapters = config.find("adapters");
     if (adapters == config.end()) {
         throw ProtocolGatewayException(R"(Invalid ProtocolGateway configuration. Field "adapters" is missing.)", ProtocolGatewayException::Code::INVALID_CONFIGURATION);
@@ -152,6 +188,24 @@ json ProtocolGateway::CreateConfig(json adaptor_configs) {
     };
 }
 
+// Adapters linked into the application, by module name
+static std::mutex builtin_mutex;
+
+static std::unordered_map<std::string, adapter_loader_func_ptr>& BuiltinAdapters() {
+    static std::unordered_map<std::string, adapter_loader_func_ptr> builtins{
+        {"loopback", [](const std::string& name, bool is_platform_proto, const json& config) {
+            return std::make_shared<LoopbackAdapter>(name, is_platform_proto, config);
+        }},
+    };
+
+    return builtins;
+}
+
+void ProtocolGateway::Register(const std::string& module_name, adapter_loader_func_ptr load) {
+    std::lock_guard<std::mutex> lock{builtin_mutex};
+    BuiltinAdapters()[module_name] = std::move(load);
+}
+
 ProtocolGateway::ProtocolGateway(const json& config, const std::string& display_name, bool platform_proto_only)
     : config_(config)
     , display_name_{display_name}
@@ -165,13 +219,32 @@ ProtocolGateway::ProtocolGateway(const std::string& display_name, bool platform_
     , platform_proto_only_{platform_proto_only} {}
 
 void ProtocolGateway::Initialize() {
-    logger.Debug() << "Loading adapters";
+    IOTEA_LOG_DEBUG(logger) << "Loading adapters";
     for (const auto& c : config_["adapters"]) {
         auto is_platform_proto = c["platform"].get<bool>();
         auto module_name = c["module"]["name"].get<std::string>();
         auto module_config = c["config"];
 
-        logger.Debug() << "Loading adapter from " << module_name;
+        adapter_loader_func_ptr builtin;
+        {
+            std::lock_guard<std::mutex> lock{builtin_mutex};
+            auto it = BuiltinAdapters().find(module_name);
+            if (it != BuiltinAdapters().end()) {
+                builtin = it->second;
+            }
+        }
+
+        if (builtin) {
+            IOTEA_LOG_DEBUG(logger) << "Creating builtin adapter " << module_name;
+
+            if (!Add(builtin(module_name, is_platform_proto, module_config))) {
+                logger.Error() << "Failed to add adapter " << module_name;
+            }
+
+            continue;
+        }
+
+        IOTEA_LOG_DEBUG(logger) << "Loading adapter from " << module_name;
 
         auto handle = dlopen(module_name.c_str(), RTLD_LAZY);
         if (handle == nullptr) {
@@ -201,50 +274,122 @@ bool ProtocolGateway::Add(std::shared_ptr<Adapter> adapter) {
 
     adapters_.push_back(adapter);
 
+    // Options addressing only platform protocol adapters skip the others
+    auto platform_proto = adapter->IsPlatformProto();
+    auto& named = named_routes_[adapter->GetName()];
+
+    for (auto platform_proto_only : {false, true}) {
+        if (platform_proto_only && !platform_proto) {
+            continue;
+        }
+
+        all_routes_[platform_proto_only].push_back(adapter.get());
+        named[platform_proto_only].push_back(adapter.get());
+    }
+
     return true;
 }
 
+void ProtocolGateway::RunConcurrently(const std::function<void(Adapter&)>& func) {
+    if (adapters_.empty()) {
+        return;
+    }
+
+    std::vector<std::thread> threads;
+
+    for (size_t i = 1; i < adapters_.size(); i++) {
+        threads.emplace_back([&func, adapter = adapters_[i]] { func(*adapter); });
+    }
+
+    // The calling thread takes the first adapter
+    func(*adapters_[0]);
+
+    for (auto& t : threads) {
+        t.join();
+    }
+}
+
 void ProtocolGateway::Start() {
-    std::for_each(adapters_.begin(), adapters_.end(), [](std::shared_ptr<Adapter> adapter) {
-        adapter->Start();
-    });
+    RunConcurrently([](Adapter& adapter) { adapter.Start(); });
 }
 
 void ProtocolGateway::Stop() {
-    std::for_each(adapters_.begin(), adapters_.end(), [](std::shared_ptr<Adapter> adapter) {
-        adapter->Stop();
-    });
+    RunConcurrently([](Adapter& adapter) { adapter.Stop(); });
 }
 
-bool ProtocolGateway::IsValidOperation(std::shared_ptr<Adapter> adapter, const PubSubOptions& opts) const {
+const std::vector<Adapter*>& ProtocolGateway::Route(const PubSubOptions& opts) const {
+    static const std::vector<Adapter*> NO_ADAPTERS;
+
     auto platform_proto_only = &opts == &DefaultPublishOptions ? platform_proto_only_ : opts.IsPlatformProtoOnly();
-    auto id = opts.GetAdapterId();
-    return (!platform_proto_only || adapter->IsPlatformProto()) &&
-           (id.empty() || id == adapter->GetName());
+    const auto& id = opts.GetAdapterId();
+
+    if (id.empty()) {
+        return all_routes_[platform_proto_only];
+    }
+
+    auto it = named_routes_.find(id);
+    return it == named_routes_.end() ? NO_ADAPTERS : it->second[platform_proto_only];
 }
 
-void ProtocolGateway::Publish(const std::string& topic, const std::string& msg, const PublishOptions& opts) {
-    std::for_each(adapters_.begin(), adapters_.end(), [&](std::shared_ptr<Adapter> adapter) {
-        if (IsValidOperation(adapter, opts)) {
-            adapter->Publish(topic, msg, opts);
+bool ProtocolGateway::Publish(const std::string& topic, const std::string& msg, const PublishOptions& opts) {
+    auto accepted = true;
+
+    for (auto adapter : Route(opts)) {
+        if (!adapter->Publish(topic, msg, opts)) {
+            accepted = false;
         }
-    });
+    }
+
+    return accepted;
 }
 
-void ProtocolGateway::Subscribe(const std::string& topic, on_msg_func_ptr on_msg, const SubscribeOptions& opts) {
-    std::for_each(adapters_.begin(), adapters_.end(), [&](std::shared_ptr<Adapter> adapter) {
-        if (IsValidOperation(adapter, opts)) {
-            adapter->Subscribe(topic, on_msg, opts);
+bool ProtocolGateway::PublishBatch(const std::vector<PublishEntry>& entries) {
+    auto accepted = true;
+
+    size_t begin = 0;
+    while (begin < entries.size()) {
+        const auto& route = Route(entries[begin].opts);
+
+        // Extend the run while the messages go to the same adapters
+        auto end = begin + 1;
+        while (end < entries.size() && &Route(entries[end].opts) == &route) {
+            end++;
         }
-    });
+
+        for (auto adapter : route) {
+            if (!adapter->PublishBatch(&entries[begin], end - begin)) {
+                accepted = false;
+            }
+        }
+
+        begin = end;
+    }
+
+    return accepted;
+}
+
+void ProtocolGateway::Subscribe(const std::string& topic, on_msg_func_ptr on_msg, const SubscribeOptions& opts) {
+    for (auto adapter : Route(opts)) {
+        adapter->Subscribe(topic, on_msg, opts);
+    }
 }
 
 void ProtocolGateway::SubscribeShared(const std::string& group, const std::string& topic, on_msg_func_ptr on_msg, const SubscribeOptions& opts) {
-    std::for_each(adapters_.begin(), adapters_.end(), [&](std::shared_ptr<Adapter> adapter) {
-        if (IsValidOperation(adapter, opts)) {
-            adapter->SubscribeShared(group, topic, on_msg, opts);
-        }
-    });
+    for (auto adapter : Route(opts)) {
+        adapter->SubscribeShared(group, topic, on_msg, opts);
+    }
+}
+
+void ProtocolGateway::SubscribePayload(const std::string& topic, on_payload_func_ptr on_msg, const SubscribeOptions& opts) {
+    for (auto adapter : Route(opts)) {
+        adapter->SubscribePayload(topic, on_msg, opts);
+    }
+}
+
+void ProtocolGateway::SubscribeSharedPayload(const std::string& group, const std::string& topic, on_payload_func_ptr on_msg, const SubscribeOptions& opts) {
+    for (auto adapter : Route(opts)) {
+        adapter->SubscribeSharedPayload(group, topic, on_msg, opts);
+    }
 }
 
 } // core
@@ -0,0 +1,281 @@
+/*****************************************************************************
+ * Copyright (c) 2021 Bosch.IO GmbH
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * SPDX-License-Identifier: MPL-2.0
+ ****************************************************************************/
+
+#include "publisher.hpp"
+
+#include <utility>
+
+#include "logging.hpp"
+
+namespace iotea {
+namespace core {
+
+static auto logger = logging::NamedLogger{"Publisher"};
+
+constexpr size_t PublisherOptions::DEFAULT_CAPACITY;
+constexpr size_t Publisher::MAX_BATCH_SIZE;
+
+static size_t IndexOf(PublishPriority priority) {
+    return static_cast<size_t>(priority);
+}
+
+//////////////////////
+// PublisherOptions //
+//////////////////////
+PublisherOptions::PublisherOptions()
+    : queues_{{DEFAULT_CAPACITY, Overflow::BLOCK}, {DEFAULT_CAPACITY, Overflow::BLOCK}} {}
+
+PublisherOptions& PublisherOptions::SetQueue(PublishPriority priority, size_t capacity, Overflow overflow) {
+    queues_[IndexOf(priority)] = Queue{capacity, overflow};
+    return *this;
+}
+
+size_t PublisherOptions::GetCapacity(PublishPriority priority) const {
+    return queues_[IndexOf(priority)].capacity;
+}
+
+PublisherOptions::Overflow PublisherOptions::GetOverflow(PublishPriority priority) const {
+    return queues_[IndexOf(priority)].overflow;
+}
+
+///////////////
+// Publisher //
+///////////////
+Publisher::Class::Class(size_t capacity, PublisherOptions::Overflow overflow)
+    : queue{capacity}
+    , overflow{overflow} {}
+
+Publisher::Publisher(gateway_ptr gateway, const PublisherOptions& options)
+    : gateway_{gateway} {
+    running_.store(false);
+    producers_.store(0);
+    sleeping_.store(false);
+    waiters_.store(0);
+
+    for (auto priority : {PublishPriority::HIGH, PublishPriority::NORMAL}) {
+        classes_.push_back(std::make_unique<Class>(options.GetCapacity(priority), options.GetOverflow(priority)));
+    }
+}
+
+Publisher::~Publisher() {
+    Stop();
+}
+
+void Publisher::Start() {
+    std::lock_guard<std::mutex> lock{start_mutex_};
+
+    if (thread_.joinable()) {
+        return;
+    }
+
+    running_.store(true);
+    thread_ = std::thread{[this] { Run(); }};
+}
+
+void Publisher::Stop() {
+    std::lock_guard<std::mutex> lock{start_mutex_};
+
+    if (!thread_.joinable()) {
+        return;
+    }
+
+    // From here on producers publish on their own thread
+    running_.store(false);
+    WakeConsumer();
+    WakeProducers();
+    thread_.join();
+
+    // Publish what producers queued while the thread was exiting
+    while (producers_.load() > 0) {
+        std::this_thread::yield();
+    }
+
+    std::vector<PublishEntry> batch;
+    for (Drain(batch); !batch.empty(); Drain(batch)) {
+        Publish(batch);
+    }
+}
+
+PublishStatus Publisher::Post(const std::string& topic, const std::string& msg, PublishPriority priority) {
+    auto& c = *classes_[IndexOf(priority)];
+
+    producers_.fetch_add(1);
+
+    if (!running_.load()) {
+        producers_.fetch_sub(1);
+
+        c.published++;
+        return gateway_->Publish(topic, msg) ? PublishStatus::OK : PublishStatus::DROPPED;
+    }
+
+    auto message = Message{topic, msg};
+    auto status = PublishStatus::OK;
+
+    if (!c.queue.Push(message)) {
+        switch (c.overflow) {
+            case PublisherOptions::Overflow::DROP_NEWEST:
+                c.dropped++;
+                status = PublishStatus::DROPPED;
+                break;
+            case PublisherOptions::Overflow::DROP_OLDEST: {
+                // The publisher thread may empty the queue in the meantime
+                Message oldest;
+                do {
+                    if (c.queue.Pop(oldest)) {
+                        c.displaced++;
+                        status = PublishStatus::DISPLACED;
+                    }
+                } while (!c.queue.Push(message));
+                break;
+            }
+            case PublisherOptions::Overflow::BLOCK:
+                status = PushBlocking(c, message);
+                break;
+        }
+    }
+
+    if (status != PublishStatus::DROPPED) {
+        WakeConsumer();
+    }
+
+    producers_.fetch_sub(1);
+    return status;
+}
+
+PublishStatus Publisher::PushBlocking(Class& c, Message& message) {
+    c.throttled++;
+
+    waiters_.fetch_add(1);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+
+    std::unique_lock<std::mutex> lock{space_mutex_};
+
+    while (!c.queue.Push(message)) {
+        if (!running_.load()) {
+            // The publisher thread may be gone, publish on this thread
+            lock.unlock();
+            waiters_.fetch_sub(1);
+
+            c.published++;
+            return gateway_->Publish(message.topic, message.msg) ? PublishStatus::THROTTLED : PublishStatus::DROPPED;
+        }
+
+        space_cv_.wait(lock);
+    }
+
+    waiters_.fetch_sub(1);
+    return PublishStatus::THROTTLED;
+}
+
+std::vector<PublisherStats> Publisher::GetStats() const {
+    std::vector<PublisherStats> stats;
+
+    for (const auto& c : classes_) {
+        stats.push_back(PublisherStats{c->queue.Size(), c->published.load(), c->throttled.load(), c->displaced.load(),
+                                       c->dropped.load()});
+    }
+
+    return stats;
+}
+
+void Publisher::Run() {
+    std::vector<PublishEntry> batch;
+    batch.reserve(MAX_BATCH_SIZE);
+
+    for (;;) {
+        Drain(batch);
+
+        if (!batch.empty()) {
+            Publish(batch);
+            continue;
+        }
+
+        // Only exit once the queues are empty
+        if (!running_.load()) {
+            return;
+        }
+
+        std::unique_lock<std::mutex> lock{mutex_};
+        sleeping_.store(true);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+
+        // A producer may have pushed before it could see sleeping_
+        if (!IsEmpty() || !running_.load()) {
+            sleeping_.store(false);
+            continue;
+        }
+
+        cv_.wait(lock, [this] { return !sleeping_.load(); });
+    }
+}
+
+void Publisher::Drain(std::vector<PublishEntry>& batch) {
+    for (auto& c : classes_) {
+        Message message;
+        uint64_t n = 0;
+
+        while (batch.size() < MAX_BATCH_SIZE && c->queue.Pop(message)) {
+            batch.push_back(PublishEntry{std::move(message.topic), std::move(message.msg), PublishOptions{false, ""}});
+            n++;
+        }
+
+        c->published += n;
+    }
+
+    // Make room for blocked producers
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (!batch.empty() && waiters_.load() > 0) {
+        WakeProducers();
+    }
+}
+
+void Publisher::Publish(std::vector<PublishEntry>& batch) {
+    if (!gateway_->PublishBatch(batch)) {
+        logger.Warn() << "Failed to publish " << batch.size() << " messages.";
+    }
+
+    batch.clear();
+}
+
+void Publisher::WakeConsumer() {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+
+    if (!sleeping_.load()) {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock{mutex_};
+        sleeping_.store(false);
+    }
+
+    cv_.notify_one();
+}
+
+void Publisher::WakeProducers() {
+    {
+        std::lock_guard<std::mutex> lock{space_mutex_};
+    }
+
+    space_cv_.notify_all();
+}
+
+bool Publisher::IsEmpty() const {
+    for (const auto& c : classes_) {
+        if (c->queue.Size() > 0) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+}  // namespace core
+}  // namespace iotea
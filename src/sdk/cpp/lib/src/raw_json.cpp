@@ -0,0 +1,230 @@
+/*****************************************************************************
+ * Copyright (c) 2021 Bosch.IO GmbH
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * SPDX-License-Identifier: MPL-2.0
+ ****************************************************************************/
+
+#include <cstring>
+#include <utility>
+
+#include "raw_json.hpp"
+
+namespace iotea {
+namespace core {
+
+static constexpr auto npos = std::string::npos;
+
+static size_t SkipWhitespace(const std::string& s, size_t i) {
+    while (i < s.size() && (s[i] == ' ' || s[i] == '\t' || s[i] == '\n' || s[i] == '\r')) {
+        i++;
+    }
+
+    return i;
+}
+
+// Return the position after the closing quote of the string starting at i
+static size_t SkipString(const std::string& s, size_t i) {
+    const auto* data = s.data();
+    i++;
+
+    while (i < s.size()) {
+        auto quote = static_cast<const char*>(std::memchr(data + i, '"', s.size() - i));
+        if (!quote) {
+            return npos;
+        }
+
+        // The quote is escaped if it is preceded by an odd number of backslashes
+        auto end = static_cast<size_t>(quote - data);
+        auto backslashes = 0;
+        for (auto j = end; j > i && data[j - 1] == '\\'; j--) {
+            backslashes++;
+        }
+
+        if (backslashes % 2 == 0) {
+            return end + 1;
+        }
+
+        i = end + 1;
+    }
+
+    return npos;
+}
+
+// Return the position after the value starting at i
+static size_t SkipValue(const std::string& s, size_t i) {
+    if (i >= s.size()) {
+        return npos;
+    }
+
+    if (s[i] == '"') {
+        return SkipString(s, i);
+    }
+
+    if (s[i] == '{' || s[i] == '[') {
+        std::string open;
+
+        while (i < s.size()) {
+            switch (s[i]) {
+                case '"':
+                    i = SkipString(s, i);
+                    if (i == npos) {
+                        return npos;
+                    }
+                    continue;
+                case '{':
+                    open.push_back('}');
+                    break;
+                case '[':
+                    open.push_back(']');
+                    break;
+                case '}':
+                case ']':
+                    if (open.back() != s[i]) {
+                        return npos;
+                    }
+
+                    open.pop_back();
+                    if (open.empty()) {
+                        return i + 1;
+                    }
+                    break;
+                default:
+                    break;
+            }
+
+            i++;
+        }
+
+        return npos;
+    }
+
+    // Number, true, false or null
+    auto begin = i;
+    while (i < s.size() && !std::strchr(",:}] \t\n\r\"{[", s[i])) {
+        i++;
+    }
+
+    return i == begin ? npos : i;
+}
+
+RawJsonObject::RawJsonObject(payload_ptr text)
+    : text_{std::move(text)} {
+    Index();
+}
+
+RawJsonObject::RawJsonObject(std::string text)
+    : RawJsonObject{std::make_shared<const std::string>(std::move(text))} {}
+
+void RawJsonObject::Index() {
+    if (!text_) {
+        return;
+    }
+
+    const auto& s = *text_;
+
+    auto i = SkipWhitespace(s, 0);
+    if (i == s.size() || s[i] != '{') {
+        return;
+    }
+
+    i = SkipWhitespace(s, i + 1);
+    if (i < s.size() && s[i] == '}') {
+        valid_ = SkipWhitespace(s, i + 1) == s.size();
+        return;
+    }
+
+    while (i < s.size()) {
+        if (s[i] != '"') {
+            return;
+        }
+
+        auto key_end = SkipString(s, i);
+        if (key_end == npos) {
+            return;
+        }
+
+        auto colon = SkipWhitespace(s, key_end);
+        if (colon == s.size() || s[colon] != ':') {
+            return;
+        }
+
+        auto value_pos = SkipWhitespace(s, colon + 1);
+        auto value_end = SkipValue(s, value_pos);
+        if (value_end == npos) {
+            return;
+        }
+
+        members_.push_back(Member{i + 1, key_end - i - 2, value_pos, value_end - value_pos});
+
+        i = SkipWhitespace(s, value_end);
+        if (i == s.size()) {
+            return;
+        }
+
+        if (s[i] == '}') {
+            valid_ = SkipWhitespace(s, i + 1) == s.size();
+            return;
+        }
+
+        if (s[i] != ',') {
+            return;
+        }
+
+        i = SkipWhitespace(s, i + 1);
+    }
+}
+
+bool RawJsonObject::IsValid() const {
+    return valid_;
+}
+
+const std::string& RawJsonObject::GetText() const {
+    static const std::string empty;
+    return text_ ? *text_ : empty;
+}
+
+const payload_ptr& RawJsonObject::GetPayload() const {
+    return text_;
+}
+
+const RawJsonObject::Member* RawJsonObject::Find(const std::string& key) const {
+    for (const auto& m : members_) {
+        if (m.key_size == key.size() && text_->compare(m.key_pos, m.key_size, key) == 0) {
+            return &m;
+        }
+    }
+
+    return nullptr;
+}
+
+json RawJsonObject::Decode(const std::string& key) const {
+    auto member = Find(key);
+    return member ? Decode(*member) : json{};
+}
+
+json RawJsonObject::Decode(const Member& member) const {
+    auto begin = text_->data() + member.value_pos;
+    return json::parse(begin, begin + member.value_size);
+}
+
+std::string RawJsonObject::DecodeString(const Member& member) const {
+    auto begin = text_->data() + member.value_pos;
+    auto size = member.value_size;
+
+    if (size >= 2 && begin[0] == '"' && !std::memchr(begin, '\\', size)) {
+        return std::string{begin + 1, size - 2};
+    }
+
+    return Decode(member).get<std::string>();
+}
+
+int64_t RawJsonObject::DecodeInt(const Member& member) const {
+    return Decode(member).get<int64_t>();
+}
+
+}  // namespace core
+}  // namespace iotea
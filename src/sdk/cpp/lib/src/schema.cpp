@@ -11,6 +11,7 @@
 #include "schema.hpp"
 
 #include <memory>
+#include <regex>
 #include <string>
 #include <utility>
 #include <vector>
@@ -0,0 +1,310 @@
+/*****************************************************************************
+ * Copyright (c) 2021 Bosch.IO GmbH
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * SPDX-License-Identifier: MPL-2.0
+ ****************************************************************************/
+
+#include <cstring>
+#include <memory>
+#include <ostream>
+#include <streambuf>
+#include <vector>
+
+#include "serializer.hpp"
+
+namespace iotea {
+namespace core {
+
+// Buffers that grew beyond this size are released instead of being reused
+static constexpr size_t MAX_RETAINED_BUFFER_SIZE = 1024 * 1024;
+
+//////////////////
+// ScopedBuffer //
+//////////////////
+struct ThreadBuffers {
+    std::vector<std::unique_ptr<std::string>> buffers;
+    size_t in_use = 0;
+};
+
+static thread_local ThreadBuffers thread_buffers;
+
+ScopedBuffer::ScopedBuffer() {
+    auto& tb = thread_buffers;
+
+    if (tb.in_use == tb.buffers.size()) {
+        tb.buffers.push_back(std::make_unique<std::string>());
+    }
+
+    buffer_ = tb.buffers[tb.in_use++].get();
+    buffer_->clear();
+}
+
+ScopedBuffer::~ScopedBuffer() {
+    if (buffer_->capacity() > MAX_RETAINED_BUFFER_SIZE) {
+        std::string{}.swap(*buffer_);
+    }
+
+    thread_buffers.in_use--;
+}
+
+std::string& ScopedBuffer::Get() {
+    return *buffer_;
+}
+
+////////////////////
+// StringAppender //
+////////////////////
+// Appends everything written to the stream to a string, without buffering
+class StringAppender : public std::streambuf {
+   public:
+    void SetTarget(std::string* target) {
+        target_ = target;
+    }
+
+   protected:
+    int_type overflow(int_type c) override {
+        if (!traits_type::eq_int_type(c, traits_type::eof())) {
+            target_->push_back(traits_type::to_char_type(c));
+        }
+
+        return traits_type::not_eof(c);
+    }
+
+    std::streamsize xsputn(const char* s, std::streamsize n) override {
+        target_->append(s, static_cast<size_t>(n));
+        return n;
+    }
+
+   private:
+    std::string* target_ = nullptr;
+};
+
+////////////////
+// JsonWriter //
+////////////////
+JsonWriter::JsonWriter(std::string& out)
+    : out_{out} {}
+
+void JsonWriter::Separate() {
+    if (after_key_) {
+        after_key_ = false;
+        return;
+    }
+
+    if (depth_ == 0) {
+        return;
+    }
+
+    auto bit = uint64_t{1} << (depth_ - 1);
+    if (has_elements_ & bit) {
+        out_.push_back(',');
+    } else {
+        has_elements_ |= bit;
+    }
+}
+
+void JsonWriter::BeginObject() {
+    Separate();
+    out_.push_back('{');
+    depth_++;
+    has_elements_ &= ~(uint64_t{1} << (depth_ - 1));
+}
+
+void JsonWriter::EndObject() {
+    out_.push_back('}');
+    depth_--;
+}
+
+void JsonWriter::BeginArray() {
+    Separate();
+    out_.push_back('[');
+    depth_++;
+    has_elements_ &= ~(uint64_t{1} << (depth_ - 1));
+}
+
+void JsonWriter::EndArray() {
+    out_.push_back(']');
+    depth_--;
+}
+
+void JsonWriter::Key(const char* key) {
+    Separate();
+    out_.push_back('"');
+    out_.append(key);
+    out_.append("\":");
+    after_key_ = true;
+}
+
+void JsonWriter::Int(int64_t value) {
+    Separate();
+
+    char digits[20];
+    auto n = 0;
+
+    // Work with the negative value so that INT64_MIN does not overflow
+    auto negative = value < 0;
+    auto v = negative ? value : -value;
+
+    do {
+        digits[n++] = static_cast<char>('0' - v % 10);
+        v /= 10;
+    } while (v != 0);
+
+    if (negative) {
+        out_.push_back('-');
+    }
+
+    while (n > 0) {
+        out_.push_back(digits[--n]);
+    }
+}
+
+void JsonWriter::Bool(bool value) {
+    Separate();
+    out_.append(value ? "true" : "false");
+}
+
+void JsonWriter::Json(const json& value) {
+    // Streamed through nlohmann's public operator<< straight into the output.
+    // The stream is kept per thread, only its target changes between calls.
+    struct Dumper {
+        StringAppender appender;
+        std::ostream stream{&appender};
+    };
+
+    static thread_local Dumper dumper;
+
+    Separate();
+
+    dumper.appender.SetTarget(&out_);
+    dumper.stream << value;
+    dumper.appender.SetTarget(nullptr);
+}
+
+void JsonWriter::Escape(const std::string& s) {
+    Escape(s.data(), s.size());
+}
+
+void JsonWriter::Escape(const char* s) {
+    Escape(s, std::strlen(s));
+}
+
+void JsonWriter::Escape(const char* s, size_t size) {
+    static const char hex[] = "0123456789abcdef";
+
+    // Copy runs of characters that need no escaping in one go
+    size_t run = 0;
+
+    for (size_t i = 0; i < size; i++) {
+        auto c = static_cast<unsigned char>(s[i]);
+
+        if (c >= 0x20 && c != '"' && c != '\\') {
+            continue;
+        }
+
+        out_.append(s + run, i - run);
+        run = i + 1;
+
+        switch (c) {
+            case '"':
+                out_.append("\\\"");
+                break;
+            case '\\':
+                out_.append("\\\\");
+                break;
+            case '\b':
+                out_.append("\\b");
+                break;
+            case '\f':
+                out_.append("\\f");
+                break;
+            case '\n':
+                out_.append("\\n");
+                break;
+            case '\r':
+                out_.append("\\r");
+                break;
+            case '\t':
+                out_.append("\\t");
+                break;
+            default: {
+                char u[] = {'\\', 'u', '0', '0', hex[c >> 4], hex[c & 0xf]};
+                out_.append(u, sizeof(u));
+            }
+        }
+    }
+
+    out_.append(s + run, size - run);
+}
+
+///////////////
+// Envelopes //
+///////////////
+void SerializeCall(std::string& out, const std::string& talent_id, const std::string& channel_id,
+                   const std::string& call_id, const std::string& func, const json& args, const std::string& subject,
+                   const std::string& type, int64_t timeout, int64_t when) {
+    JsonWriter w{out};
+    w.BeginObject();
+    w.Key("feature");
+    w.String(talent_id, ".", func, "-in");
+    w.Key("subject");
+    w.String(subject);
+    w.Key("type");
+    w.String(type);
+    w.Key("value");
+    w.BeginObject();
+    w.Key("args");
+    if (args.is_array()) {
+        w.Json(args);
+    } else {
+        w.BeginArray();
+        w.Json(args);
+        w.EndArray();
+    }
+    w.Key("call");
+    w.String(call_id);
+    w.Key("chnl");
+    w.String(channel_id);
+    w.Key("func");
+    w.String(func);
+    w.Key("timeoutAtMs");
+    w.Int(when + timeout);
+    w.EndObject();
+    w.Key("whenMs");
+    w.Int(when);
+    w.EndObject();
+}
+
+void SerializeReply(std::string& out, const std::string& talent_id, const std::string& feature,
+                    const std::string& channel_id, const std::string& call_id, const json& value,
+                    const std::string& subject, const std::string& type, const std::string& instance, int64_t when) {
+    JsonWriter w{out};
+    w.BeginObject();
+    w.Key("feature");
+    w.String(talent_id, ".", feature);
+    w.Key("instance");
+    w.String(instance);
+    w.Key("subject");
+    w.String(subject);
+    w.Key("type");
+    w.String(type);
+    w.Key("value");
+    w.BeginObject();
+    w.Key("$tsuffix");
+    w.String("/", channel_id, "/", call_id);
+    w.Key("$vpath");
+    w.String("value");
+    w.Key("value");
+    w.Json(value);
+    w.EndObject();
+    w.Key("whenMs");
+    w.Int(when);
+    w.EndObject();
+}
+
+}  // namespace core
+}  // namespace iotea
@@ -0,0 +1,254 @@
+/*****************************************************************************
+ * Copyright (c) 2021 Bosch.IO GmbH
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * SPDX-License-Identifier: MPL-2.0
+ ****************************************************************************/
+
+#include <linux/futex.h>
+#include <pthread.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+
+#include "logging.hpp"
+#include "shm_ring.hpp"
+
+namespace iotea {
+namespace core {
+
+static auto logger = logging::NamedLogger{"ShmRing"};
+
+static constexpr char RING_MAGIC[8] = {'I', 'O', 'T', 'E', 'A', 'R', 'B', '1'};
+
+// Written where the ring wraps, the rest of the ring is unused
+static constexpr uint32_t WRAP_MARKER = 0xffffffff;
+
+static_assert(ATOMIC_LLONG_LOCK_FREE == 2 && ATOMIC_INT_LOCK_FREE == 2,
+              "Atomics shared between processes must be lock free");
+
+// The memory starts with a Header followed by the ring of records. Each
+// record is a RecordHeader followed by the topic and the payload, padded to
+// a multiple of 8 bytes. head and tail count the bytes ever written and
+// read, their difference is the number of bytes in use.
+struct ShmRing::Header {
+    char magic[8];
+    uint64_t capacity;
+    pthread_mutex_t mutex;  // Serializes producers
+
+    alignas(64) std::atomic<uint64_t> head;  // Written by producers
+    std::atomic<uint64_t> dropped;
+
+    alignas(64) std::atomic<uint64_t> tail;  // Written by the consumer
+
+    alignas(64) std::atomic<uint32_t> seq;  // The futex, bumped by every push
+    std::atomic<uint32_t> waiting;          // Set while the consumer sleeps
+    std::atomic<uint32_t> woken;            // Set by Wake()
+    std::atomic<uint32_t> ready;            // Set once the ring is created
+};
+
+struct RingRecordHeader {
+    uint32_t size;  // Including the header and the padding, or WRAP_MARKER
+    uint32_t tag;
+    uint32_t topic_size;
+    uint32_t payload_size;
+};
+
+static_assert(sizeof(RingRecordHeader) == 16, "RingRecordHeader must be 16 bytes");
+
+static uint64_t RecordSize(uint64_t topic_size, uint64_t payload_size) {
+    return (sizeof(RingRecordHeader) + topic_size + payload_size + 7) & ~uint64_t{7};
+}
+
+static long Futex(std::atomic<uint32_t>* addr, int op, uint32_t val, const struct timespec* timeout) {
+    // Not FUTEX_PRIVATE_FLAG, the futex is shared between processes
+    return ::syscall(SYS_futex, reinterpret_cast<uint32_t*>(addr), op, val, timeout, nullptr, 0);
+}
+
+size_t ShmRing::Size(size_t capacity) {
+    return sizeof(Header) + ((capacity + 7) & ~size_t{7});
+}
+
+char* ShmRing::Data() const {
+    return reinterpret_cast<char*>(header_) + sizeof(Header);
+}
+
+bool ShmRing::Create(void* mem, size_t size) {
+    if (size < Size(sizeof(RingRecordHeader))) {
+        logger.Error() << "Ring of " << size << " bytes is too small.";
+        return false;
+    }
+
+    header_ = static_cast<Header*>(mem);
+    header_->capacity = (size - sizeof(Header)) & ~uint64_t{7};
+    header_->head.store(0);
+    header_->dropped.store(0);
+    header_->tail.store(0);
+    header_->seq.store(0);
+    header_->waiting.store(0);
+    header_->woken.store(0);
+
+    pthread_mutexattr_t attr;
+    pthread_mutexattr_init(&attr);
+    pthread_mutexattr_setpshared(&attr, PTHREAD_PROCESS_SHARED);
+    pthread_mutexattr_setrobust(&attr, PTHREAD_MUTEX_ROBUST);
+    auto rc = pthread_mutex_init(&header_->mutex, &attr);
+    pthread_mutexattr_destroy(&attr);
+
+    if (rc != 0) {
+        logger.Error() << "Failed to create ring mutex: " << std::strerror(rc);
+        header_ = nullptr;
+        return false;
+    }
+
+    std::memcpy(header_->magic, RING_MAGIC, sizeof(RING_MAGIC));
+    header_->ready.store(1, std::memory_order_release);
+
+    return true;
+}
+
+bool ShmRing::Attach(void* mem, size_t size) {
+    auto header = static_cast<Header*>(mem);
+
+    if (size < sizeof(Header) || header->ready.load(std::memory_order_acquire) == 0 ||
+        std::memcmp(header->magic, RING_MAGIC, sizeof(RING_MAGIC)) != 0 ||
+        header->capacity > size - sizeof(Header)) {
+        return false;
+    }
+
+    header_ = header;
+    return true;
+}
+
+bool ShmRing::Push(uint32_t tag, const std::string& topic, const char* payload, size_t payload_size) {
+    auto size = RecordSize(topic.size(), payload_size);
+    auto capacity = header_->capacity;
+
+    if (size > capacity || payload_size > UINT32_MAX) {
+        header_->dropped++;
+        return false;
+    }
+
+    auto rc = pthread_mutex_lock(&header_->mutex);
+    if (rc == EOWNERDEAD) {
+        // A producer died while holding the lock. Records only become
+        // visible once head is advanced, so a partial write is harmless.
+        pthread_mutex_consistent(&header_->mutex);
+    } else if (rc != 0) {
+        header_->dropped++;
+        return false;
+    }
+
+    auto head = header_->head.load(std::memory_order_relaxed);
+    auto tail = header_->tail.load(std::memory_order_acquire);
+
+    auto offset = head % capacity;
+    auto padding = capacity - offset < size ? capacity - offset : 0;
+
+    if (head + padding + size - tail > capacity) {
+        pthread_mutex_unlock(&header_->mutex);
+        header_->dropped++;
+        return false;
+    }
+
+    if (padding != 0) {
+        *reinterpret_cast<uint32_t*>(Data() + offset) = WRAP_MARKER;
+        offset = 0;
+    }
+
+    auto data = Data() + offset;
+    auto rh = reinterpret_cast<RingRecordHeader*>(data);
+    rh->size = static_cast<uint32_t>(size);
+    rh->tag = tag;
+    rh->topic_size = static_cast<uint32_t>(topic.size());
+    rh->payload_size = static_cast<uint32_t>(payload_size);
+    std::memcpy(data + sizeof(RingRecordHeader), topic.data(), topic.size());
+    std::memcpy(data + sizeof(RingRecordHeader) + topic.size(), payload, payload_size);
+
+    header_->head.store(head + padding + size, std::memory_order_seq_cst);
+
+    pthread_mutex_unlock(&header_->mutex);
+
+    header_->seq.fetch_add(1, std::memory_order_seq_cst);
+    if (header_->waiting.load(std::memory_order_seq_cst) != 0) {
+        Futex(&header_->seq, FUTEX_WAKE, 1, nullptr);
+    }
+
+    return true;
+}
+
+bool ShmRing::Pop(uint32_t& tag, std::string& topic, std::string& payload) {
+    auto capacity = header_->capacity;
+    auto tail = header_->tail.load(std::memory_order_relaxed);
+
+    for (;;) {
+        if (tail == header_->head.load(std::memory_order_acquire)) {
+            return false;
+        }
+
+        auto offset = tail % capacity;
+        auto data = Data() + offset;
+
+        if (*reinterpret_cast<const uint32_t*>(data) == WRAP_MARKER) {
+            tail += capacity - offset;
+            header_->tail.store(tail, std::memory_order_release);
+            continue;
+        }
+
+        auto rh = reinterpret_cast<const RingRecordHeader*>(data);
+        tag = rh->tag;
+        topic.assign(data + sizeof(RingRecordHeader), rh->topic_size);
+        payload.assign(data + sizeof(RingRecordHeader) + rh->topic_size, rh->payload_size);
+
+        header_->tail.store(tail + rh->size, std::memory_order_release);
+        return true;
+    }
+}
+
+bool ShmRing::Wait(std::chrono::milliseconds timeout) {
+    auto seq = header_->seq.load(std::memory_order_seq_cst);
+
+    auto non_empty = [this] {
+        return header_->tail.load(std::memory_order_relaxed) != header_->head.load(std::memory_order_seq_cst);
+    };
+
+    if (header_->woken.exchange(0) != 0 || non_empty()) {
+        return non_empty();
+    }
+
+    header_->waiting.store(1, std::memory_order_seq_cst);
+
+    // Pushes after this check change seq and fail the wait
+    if (!non_empty()) {
+        auto s = std::chrono::duration_cast<std::chrono::seconds>(timeout);
+        struct timespec ts;
+        ts.tv_sec = static_cast<time_t>(s.count());
+        ts.tv_nsec = static_cast<long>(std::chrono::duration_cast<std::chrono::nanoseconds>(timeout - s).count());
+
+        Futex(&header_->seq, FUTEX_WAIT, seq, &ts);
+    }
+
+    header_->waiting.store(0, std::memory_order_relaxed);
+
+    return non_empty();
+}
+
+void ShmRing::Wake() {
+    header_->woken.store(1, std::memory_order_seq_cst);
+    header_->seq.fetch_add(1, std::memory_order_seq_cst);
+    Futex(&header_->seq, FUTEX_WAKE, 1, nullptr);
+}
+
+uint64_t ShmRing::Dropped() const {
+    return header_->dropped.load();
+}
+
+}  // namespace core
+}  // namespace iotea
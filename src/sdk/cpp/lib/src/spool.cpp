@@ -0,0 +1,270 @@
+/*****************************************************************************
+ * Copyright (c) 2021 Bosch.IO GmbH
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * SPDX-License-Identifier: MPL-2.0
+ ****************************************************************************/
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+
+#include "logging.hpp"
+#include "spool.hpp"
+
+namespace iotea {
+namespace core {
+
+static auto logger = logging::NamedLogger{"Spool"};
+
+static constexpr char SPOOL_MAGIC[8] = {'I', 'O', 'T', 'E', 'A', 'S', 'P', '1'};
+
+// Written where the ring wraps, the rest of the ring is unused
+static constexpr uint32_t WRAP_MARKER = 0xffffffff;
+
+// The file starts with a Header followed by the ring of records. Each record
+// is a RecordHeader followed by the topic and the payload, padded to a
+// multiple of 8 bytes.
+struct Spool::Header {
+    char magic[8];
+    uint64_t capacity;  // The size of the ring
+    uint64_t head;      // The offset of the oldest record
+    uint64_t tail;      // The offset following the newest record
+    uint64_t used;      // The bytes used by records and the wrap padding
+    uint64_t count;
+    uint64_t dropped;
+    uint64_t reserved;
+};
+
+struct RecordHeader {
+    uint32_t topic_size;
+    uint32_t payload_size;
+    uint8_t qos;
+    uint8_t retain;
+    uint8_t reserved[6];
+};
+
+static_assert(sizeof(RecordHeader) == 16, "RecordHeader must be 16 bytes");
+
+static uint64_t RecordSize(uint64_t topic_size, uint64_t payload_size) {
+    return (sizeof(RecordHeader) + topic_size + payload_size + 7) & ~uint64_t{7};
+}
+
+Spool::~Spool() {
+    Close();
+}
+
+bool Spool::Open(const std::string& path, size_t capacity) {
+    Close();
+
+    capacity = (capacity + 7) & ~size_t{7};
+
+    fd_ = ::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+    if (fd_ < 0) {
+        logger.Error() << "Failed to open spool '" << path << "': " << std::strerror(errno);
+        return false;
+    }
+
+    struct stat st;
+    if (::fstat(fd_, &st) != 0) {
+        logger.Error() << "Failed to stat spool '" << path << "': " << std::strerror(errno);
+        Close();
+        return false;
+    }
+
+    map_size_ = sizeof(Header) + capacity;
+    auto existing = static_cast<size_t>(st.st_size) == map_size_;
+
+    if (!existing && ::ftruncate(fd_, static_cast<off_t>(map_size_)) != 0) {
+        logger.Error() << "Failed to resize spool '" << path << "': " << std::strerror(errno);
+        Close();
+        return false;
+    }
+
+    map_ = ::mmap(nullptr, map_size_, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+    if (map_ == MAP_FAILED) {
+        logger.Error() << "Failed to map spool '" << path << "': " << std::strerror(errno);
+        map_ = nullptr;
+        Close();
+        return false;
+    }
+
+    header_ = static_cast<Header*>(map_);
+
+    auto valid = existing && std::memcmp(header_->magic, SPOOL_MAGIC, sizeof(SPOOL_MAGIC)) == 0 &&
+                 header_->capacity == capacity && header_->head <= capacity && header_->tail <= capacity &&
+                 header_->used <= capacity;
+
+    if (valid) {
+        logger.Info() << "Reusing spool '" << path << "' holding " << header_->count << " messages.";
+    } else {
+        if (st.st_size != 0) {
+            logger.Warn() << "Discarding incompatible spool '" << path << "'.";
+        }
+
+        std::memcpy(header_->magic, SPOOL_MAGIC, sizeof(SPOOL_MAGIC));
+        header_->capacity = capacity;
+        header_->dropped = 0;
+        header_->reserved = 0;
+        Reset();
+    }
+
+    return true;
+}
+
+void Spool::Close() {
+    if (map_ != nullptr) {
+        ::munmap(map_, map_size_);
+        map_ = nullptr;
+        header_ = nullptr;
+    }
+
+    if (fd_ >= 0) {
+        ::close(fd_);
+        fd_ = -1;
+    }
+}
+
+bool Spool::IsOpen() const {
+    return header_ != nullptr;
+}
+
+char* Spool::Data() const {
+    return static_cast<char*>(map_) + sizeof(Header);
+}
+
+void Spool::Reset() {
+    header_->head = 0;
+    header_->tail = 0;
+    header_->used = 0;
+    header_->count = 0;
+}
+
+void Spool::Normalize() {
+    if (header_->count == 0) {
+        Reset();
+        return;
+    }
+
+    // Skip the unused end of the ring
+    auto head = header_->head;
+    uint32_t marker;
+    if (head == header_->capacity ||
+        (std::memcpy(&marker, Data() + head, sizeof(marker)), marker == WRAP_MARKER)) {
+        header_->used -= header_->capacity - head;
+        header_->head = 0;
+    }
+}
+
+void Spool::DropOldest() {
+    RecordHeader rh;
+    std::memcpy(&rh, Data() + header_->head, sizeof(rh));
+
+    auto size = RecordSize(rh.topic_size, rh.payload_size);
+    header_->head += size;
+    header_->used -= size;
+    header_->count--;
+
+    Normalize();
+}
+
+bool Spool::Append(const std::string& topic, const std::string& payload, int qos, bool retain) {
+    if (!IsOpen()) {
+        return false;
+    }
+
+    auto capacity = header_->capacity;
+    auto size = RecordSize(topic.size(), payload.size());
+
+    if (size > capacity) {
+        logger.Warn() << "Message of " << payload.size() << " bytes exceeds the spool capacity.";
+        return false;
+    }
+
+    // Drop the oldest records until the record (and the padding needed to
+    // wrap the ring) fits
+    bool wrap;
+    uint64_t padding;
+    for (;;) {
+        if (header_->count == 0) {
+            Reset();
+        }
+
+        wrap = header_->tail + size > capacity;
+        padding = wrap ? capacity - header_->tail : 0;
+        if (capacity - header_->used >= padding + size) {
+            break;
+        }
+
+        DropOldest();
+        header_->dropped++;
+    }
+
+    if (wrap) {
+        if (padding > 0) {
+            std::memcpy(Data() + header_->tail, &WRAP_MARKER, sizeof(WRAP_MARKER));
+        }
+
+        header_->used += padding;
+        header_->tail = 0;
+    }
+
+    RecordHeader rh{};
+    rh.topic_size = static_cast<uint32_t>(topic.size());
+    rh.payload_size = static_cast<uint32_t>(payload.size());
+    rh.qos = static_cast<uint8_t>(qos);
+    rh.retain = retain ? 1 : 0;
+
+    auto p = Data() + header_->tail;
+    std::memcpy(p, &rh, sizeof(rh));
+    std::memcpy(p + sizeof(rh), topic.data(), topic.size());
+    std::memcpy(p + sizeof(rh) + topic.size(), payload.data(), payload.size());
+
+    // Only account for the record once it has been written
+    header_->tail += size;
+    header_->used += size;
+    header_->count++;
+
+    return true;
+}
+
+bool Spool::Peek(SpoolRecord& record) const {
+    if (!IsOpen() || header_->count == 0) {
+        return false;
+    }
+
+    RecordHeader rh;
+    auto p = Data() + header_->head;
+    std::memcpy(&rh, p, sizeof(rh));
+
+    record.topic.assign(p + sizeof(rh), rh.topic_size);
+    record.payload.assign(p + sizeof(rh) + rh.topic_size, rh.payload_size);
+    record.qos = rh.qos;
+    record.retain = rh.retain != 0;
+
+    return true;
+}
+
+void Spool::Pop() {
+    if (IsOpen() && header_->count > 0) {
+        DropOldest();
+    }
+}
+
+uint64_t Spool::Count() const {
+    return IsOpen() ? header_->count : 0;
+}
+
+uint64_t Spool::Dropped() const {
+    return IsOpen() ? header_->dropped : 0;
+}
+
+}  // namespace core
+}  // namespace iotea
@@ -53,6 +53,15 @@ void Talent::AddOutput(const std::string& feature, const schema::Metadata& metad
     schema_.AddOutput(feature, metadata);
 }
 
+void Talent::AddOutput(const std::string& feature, const schema::Metadata& metadata, const EmitPolicy& policy) {
+    AddOutput(feature, metadata);
+    emit_policies_[feature] = policy;
+}
+
+const std::unordered_map<std::string, EmitPolicy>& Talent::GetEmitPolicies() const {
+    return emit_policies_;
+}
+
 event_ctx_ptr Talent::NewEventContext(const std::string& subject) {
     return context_gen_(subject);
 }
@@ -165,6 +174,10 @@ FunctionTalent::FunctionTalent(const std::string& id)
 void FunctionTalent::RegisterFunction(const std::string& name, const func_ptr func) {
     funcs_[name] = func;
 
+    // Index the function by the name of its input feature so that incoming
+    // calls are resolved without building any strings.
+    index_[GetInputName(GetId(), name)] = FunctionEntry{name, GetOutputName(name), func};
+
     AddOutput(name + "-in", schema::Metadata("Argument(s) for function " + name, 0, 0, "ONE",
                                              schema::OutputEncoding(schema::OutputEncoding::Type::Object)));
     AddOutput(name + "-out", schema::Metadata("Result of function " + name, 0, 0, "ONE",
@@ -255,9 +268,14 @@ schema::Schema FunctionTalent::GetSchema() const {
     return schema_.GetSchema(root);
 }
 
-function_map FunctionTalent::GetFunctions() const {
+const function_map& FunctionTalent::GetFunctions() const {
     return funcs_;
 }
 
+const FunctionEntry* FunctionTalent::FindFunction(const std::string& feature) const {
+    auto it = index_.find(feature);
+    return it == index_.end() ? nullptr : &it->second;
+}
+
 }  // namespace core
 }  // namespace iotea
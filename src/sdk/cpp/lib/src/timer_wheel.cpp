@@ -0,0 +1,187 @@
+/*****************************************************************************
+ * Copyright (c) 2021 Bosch.IO GmbH
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * SPDX-License-Identifier: MPL-2.0
+ ****************************************************************************/
+
+#include <algorithm>
+
+#include "timer_wheel.hpp"
+
+namespace iotea {
+namespace core {
+
+constexpr size_t TimerWheel::LEVELS;
+constexpr size_t TimerWheel::SLOT_BITS;
+constexpr size_t TimerWheel::SLOTS;
+constexpr int64_t TimerWheel::SLOT_MASK;
+
+TimerWheel::TimerWheel(int64_t resolution_ms)
+    : resolution_ms_{std::max<int64_t>(resolution_ms, 1)} {}
+
+void TimerWheel::SetResolution(int64_t resolution_ms) {
+    resolution_ms = std::max<int64_t>(resolution_ms, 1);
+
+    // Collect all timers, rescale the wheel and put the timers back
+    slot_t timers;
+    timers.splice(timers.end(), unplaced_);
+    timers.splice(timers.end(), due_);
+    for (auto& level : wheel_) {
+        for (auto& slot : level) {
+            timers.splice(timers.end(), slot);
+        }
+    }
+
+    current_ = current_ * resolution_ms_ / resolution_ms;
+    resolution_ms_ = resolution_ms;
+
+    while (!timers.empty()) {
+        auto it = timers.begin();
+        it->expires = ToTick(it->deadline_ms);
+
+        if (started_) {
+            Place(timers, it);
+        } else {
+            unplaced_.splice(unplaced_.end(), timers, it);
+            timers_[it->id].slot = &unplaced_;
+        }
+    }
+}
+
+int64_t TimerWheel::GetResolution() const {
+    return resolution_ms_;
+}
+
+int64_t TimerWheel::ToTick(int64_t deadline_ms) const {
+    // Round up so that timers never expire early
+    auto tick = deadline_ms / resolution_ms_;
+    if (deadline_ms > 0 && deadline_ms % resolution_ms_ != 0) {
+        tick++;
+    }
+
+    return tick;
+}
+
+TimerWheel::slot_t* TimerWheel::SlotFor(int64_t expires) {
+    auto delta = expires - current_;
+
+    if (delta <= 0) {
+        return &due_;
+    }
+
+    for (size_t level = 0; level < LEVELS; level++) {
+        auto shift = SLOT_BITS * level;
+
+        if (delta < (int64_t{1} << (shift + SLOT_BITS))) {
+            return &wheel_[level][(expires >> shift) & SLOT_MASK];
+        }
+    }
+
+    // Beyond the range of the wheel, park the timer in the farthest slot. It
+    // is placed again when the slot is cascaded.
+    auto shift = SLOT_BITS * (LEVELS - 1);
+    auto farthest = current_ + (int64_t{1} << (SLOT_BITS * LEVELS)) - 1;
+    return &wheel_[LEVELS - 1][(farthest >> shift) & SLOT_MASK];
+}
+
+void TimerWheel::Place(slot_t& from, slot_t::iterator it) {
+    auto slot = SlotFor(it->expires);
+
+    // Splicing keeps the iterator stored in timers_ valid
+    slot->splice(slot->end(), from, it);
+    timers_[it->id].slot = slot;
+}
+
+void TimerWheel::Cascade(size_t level) {
+    auto shift = SLOT_BITS * level;
+
+    slot_t timers;
+    timers.splice(timers.end(), wheel_[level][(current_ >> shift) & SLOT_MASK]);
+
+    while (!timers.empty()) {
+        Place(timers, timers.begin());
+    }
+}
+
+timer_id_t TimerWheel::Schedule(int64_t deadline_ms) {
+    auto id = next_id_++;
+    auto expires = ToTick(deadline_ms);
+    auto slot = started_ ? SlotFor(expires) : &unplaced_;
+
+    auto it = slot->insert(slot->end(), Timer{id, deadline_ms, expires});
+    timers_.emplace(id, Location{slot, it});
+
+    return id;
+}
+
+bool TimerWheel::Cancel(timer_id_t id) {
+    auto it = timers_.find(id);
+    if (it == timers_.end()) {
+        return false;
+    }
+
+    it->second.slot->erase(it->second.it);
+    timers_.erase(it);
+    return true;
+}
+
+std::vector<timer_id_t> TimerWheel::Advance(int64_t now_ms) {
+    auto target = now_ms / resolution_ms_;
+    if (now_ms < 0 && now_ms % resolution_ms_ != 0) {
+        target--;
+    }
+
+    if (!started_) {
+        started_ = true;
+        current_ = target;
+
+        while (!unplaced_.empty()) {
+            Place(unplaced_, unplaced_.begin());
+        }
+    }
+
+    while (current_ < target) {
+        if (timers_.size() == due_.size()) {
+            // Nothing left in the wheel, skip the remaining ticks
+            current_ = target;
+            break;
+        }
+
+        current_++;
+
+        // Move the timers of the next slot of the higher levels down when
+        // the lower level wraps around.
+        for (size_t level = 1; level < LEVELS; level++) {
+            if ((current_ & ((int64_t{1} << (SLOT_BITS * level)) - 1)) != 0) {
+                break;
+            }
+
+            Cascade(level);
+        }
+
+        due_.splice(due_.end(), wheel_[0][current_ & SLOT_MASK]);
+    }
+
+    std::vector<timer_id_t> expired;
+    expired.reserve(due_.size());
+
+    for (const auto& t : due_) {
+        expired.push_back(t.id);
+        timers_.erase(t.id);
+    }
+
+    due_.clear();
+
+    return expired;
+}
+
+size_t TimerWheel::Size() const {
+    return timers_.size();
+}
+
+}  // namespace core
+}  // namespace iotea
@@ -0,0 +1,230 @@
+/*****************************************************************************
+ * Copyright (c) 2021 Bosch.IO GmbH
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * SPDX-License-Identifier: MPL-2.0
+ ****************************************************************************/
+
+#include <cstring>
+
+#include "topic_router.hpp"
+
+namespace iotea {
+namespace core {
+
+////////////////
+// TopicSlice //
+////////////////
+TopicSlice::TopicSlice(const char* d, size_t s)
+    : data{d}
+    , size{s} {}
+
+TopicSlice::TopicSlice(const std::string& s)
+    : data{s.data()}
+    , size{s.size()} {}
+
+bool TopicSlice::Empty() const { return size == 0; }
+
+std::string TopicSlice::ToString() const { return std::string(data, size); }
+
+bool TopicSlice::operator==(const TopicSlice& other) const {
+    return size == other.size && (size == 0 || std::memcmp(data, other.data, size) == 0);
+}
+
+bool TopicSlice::operator==(const char* other) const {
+    return std::strlen(other) == size && std::memcmp(data, other, size) == 0;
+}
+
+////////////////////
+// TopicSliceHash //
+////////////////////
+size_t TopicSliceHash::operator()(const TopicSlice& s) const {
+    // FNV-1a
+    uint64_t h = 14695981039346656037ull;
+    for (size_t i = 0; i < s.size; i++) {
+        h ^= static_cast<unsigned char>(s.data[i]);
+        h *= 1099511628211ull;
+    }
+
+    return static_cast<size_t>(h);
+}
+
+/////////////////
+// TopicRouter //
+/////////////////
+void TopicRouter::Insert(entry_map& map, std::unique_ptr<Entry> entry) {
+    auto key = TopicSlice{entry->key};
+
+    // The key refers to the string owned by the entry, erase any previous
+    // entry (and its key) before inserting the new one.
+    map.erase(key);
+    map.emplace(key, std::move(entry));
+}
+
+const TopicRouter::Entry* TopicRouter::Find(const entry_map& map, const TopicSlice& key) {
+    auto it = map.find(key);
+    return it == map.end() ? nullptr : it->second.get();
+}
+
+void TopicRouter::AddTalent(const std::string& talent_id, const std::string& channel_id) {
+    auto talent = std::make_unique<Entry>();
+    talent->key = talent_id;
+    talent->talent_id = talent_id;
+    Insert(talents_, std::move(talent));
+
+    // Replies are sent to "<talent-id>.<uuid>" where the part before the first
+    // '.' is reported as the talent ID and the remainder as the channel ID.
+    auto dot = channel_id.find('.');
+    if (dot == std::string::npos) {
+        return;
+    }
+
+    auto channel = std::make_unique<Entry>();
+    channel->key = channel_id;
+    channel->talent_id = channel_id.substr(0, dot);
+    channel->channel_id = channel_id.substr(dot + 1);
+    Insert(channels_, std::move(channel));
+}
+
+// Split "<talentId>.<channelId>" at the first '.', both parts non-empty
+static bool SplitChannel(const TopicSlice& chan, TopicSlice& talent, TopicSlice& channel) {
+    auto dot = static_cast<const char*>(std::memchr(chan.data, '.', chan.size));
+
+    if (!dot || dot == chan.data || dot == chan.data + chan.size - 1) {
+        return false;
+    }
+
+    talent = TopicSlice{chan.data, static_cast<size_t>(dot - chan.data)};
+    channel = TopicSlice{dot + 1, static_cast<size_t>(chan.data + chan.size - dot - 1)};
+    return true;
+}
+
+// Find the call reply whose call ID spans several levels, i.e. the rightmost
+// "/talent/<talentId>/events/<talentId>.<channelId>/" followed by the call ID
+static bool FindCallReply(const std::string& topic, TopicSlice& chan, TopicSlice& call) {
+    static const std::string talent_level = "/talent/";
+    static const std::string events_level = "/events/";
+
+    auto pos = topic.rfind(talent_level);
+
+    while (pos != std::string::npos) {
+        auto talent_begin = pos + talent_level.size();
+        auto talent_end = topic.find('/', talent_begin);
+
+        if (talent_end != std::string::npos && talent_end != talent_begin &&
+                topic.compare(talent_end, events_level.size(), events_level) == 0) {
+            auto chan_begin = talent_end + events_level.size();
+            auto chan_end = topic.find('/', chan_begin);
+
+            if (chan_end != std::string::npos && chan_end != chan_begin && chan_end + 1 < topic.size()) {
+                chan = TopicSlice{topic.data() + chan_begin, chan_end - chan_begin};
+                call = TopicSlice{topic.data() + chan_end + 1, topic.size() - chan_end - 1};
+                return true;
+            }
+        }
+
+        if (pos == 0) {
+            break;
+        }
+
+        pos = topic.rfind(talent_level, pos - 1);
+    }
+
+    return false;
+}
+
+TopicRoute TopicRouter::Resolve(const std::string& topic) const {
+    // The routed topics are identified by their last (at most) six levels:
+    //
+    // <ns>/talent/<talentId>/events
+    // <ns>/talent/<talentId>/events/<talentId>.<channelId>/<callId>
+    //     (the call ID may span several levels)
+    // <ns>/configManager/talents/discover
+    // <ns>/platform/$events
+    //
+    // levels[0] holds the last level, levels[1] the one before and so on.
+    static constexpr size_t kMaxLevels = 6;
+
+    TopicSlice levels[kMaxLevels];
+    size_t n = 0;
+
+    const auto begin = topic.data();
+    auto end = begin + topic.size();
+
+    while (n < kMaxLevels) {
+        auto start = end;
+        while (start != begin && *(start - 1) != '/') {
+            start--;
+        }
+
+        levels[n++] = TopicSlice{start, static_cast<size_t>(end - start)};
+
+        if (start == begin) {
+            break;
+        }
+
+        end = start - 1;
+    }
+
+    TopicRoute route;
+
+    // A level must precede "talent", i.e. "talent" must be at index < n - 1
+    if (n >= 4 && levels[0] == "events" && !levels[1].Empty() && levels[2] == "talent") {
+        route.type = TopicRoute::Type::EVENT;
+        route.talent = levels[1];
+
+        auto talent = Find(talents_, levels[1]);
+        if (talent) {
+            route.talent_id = &talent->talent_id;
+        }
+
+        return route;
+    }
+
+    // The call ID usually is the last level. Call IDs supplied by
+    // Client::SetIdGenerator may contain '/', then the call ID is everything
+    // after the channel level.
+    TopicSlice chan;
+    TopicSlice call;
+
+    auto found = n >= 6 && !levels[0].Empty() && levels[2] == "events" && !levels[3].Empty() &&
+        levels[4] == "talent" && SplitChannel(levels[1], route.talent, route.channel);
+
+    if (found) {
+        chan = levels[1];
+        call = levels[0];
+    } else {
+        found = FindCallReply(topic, chan, call) && SplitChannel(chan, route.talent, route.channel);
+    }
+
+    if (found) {
+        route.type = TopicRoute::Type::CALL_REPLY;
+        route.call = call;
+
+        auto channel = Find(channels_, chan);
+        if (channel) {
+            route.talent_id = &channel->talent_id;
+            route.channel_id = &channel->channel_id;
+        }
+
+        return route;
+    }
+
+    if (n >= 3 && levels[0] == "discover" && levels[1] == "talents" && levels[2] == "configManager") {
+        route.type = TopicRoute::Type::DISCOVER;
+        return route;
+    }
+
+    if (n >= 2 && levels[0] == "$events" && levels[1] == "platform") {
+        route.type = TopicRoute::Type::PLATFORM_EVENT;
+        return route;
+    }
+
+    return route;
+}
+
+}  // namespace core
+}  // namespace iotea
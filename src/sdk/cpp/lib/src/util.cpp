@@ -9,10 +9,9 @@
  ****************************************************************************/
 
 #include <chrono>
-#include <iomanip>
-#include <random>
-#include <sstream>
+#include <utility>
 
+#include "id_generator.hpp"
 #include "util.hpp"
 
 namespace iotea {
@@ -38,120 +37,62 @@ Uuid4::operator std::string() const noexcept {
 }
 
 void Uuid4::Generate() {
-    std::random_device rd;
-    std::mt19937 gen(rd());
-    std::uniform_int_distribution<> dist(0, 255);
-
-    // From RFC4122:
-    //
-    // 4.4.  Algorithms for Creating a UUID from Truly Random or
-    // Pseudo-Random Numbers
-    //
-    // The version 4 UUID is meant for generating UUIDs from truly-random or
-    // pseudo-random numbers.
-    //
-    // The algorithm is as follows:
-    //
-    // o  Set the two most significant bits (bits 6 and 7) of the
-    //    clock_seq_hi_and_reserved to zero and one, respectively.
-    //
-    // o  Set the four most significant bits (bits 12 through 15) of the
-    //    time_hi_and_version field to the 4-bit version number from
-    //    Section 4.1.3.
-    //
-    // o  Set all the other bits to randomly (or pseudo-randomly) chosen
-    //    values.
-
-    for (int i = 0; i < 16; i++) {
-        bits_[i] = dist(gen);
-    }
-
-    // Field                  Data Type     Octet  Note
-    // clock_seq_hi_and_rese  unsigned 8    8      The high field of the
-    //                                             clock sequence
-    //                                             multiplexed with the
-    //                                             variant
-    bits_[7] &= 0xbf; // Clear bit 6
-    bits_[7] |= 0x80; // Set bit 7
-
-    // 4.1.3.  Version
-    //
-    // The version number is in the most significant 4 bits of the time
-    // stamp (bits 4 through 7 of the time_hi_and_version field).
-    //
-    // The following table lists the currently-defined versions for this
-    // UUID variant.
-    //
-    // Msb0  Msb1  Msb2  Msb3   Version  Description
-    //  0     1     0     0        4     The randomly or pseudo-
-    //                                   randomly generated version
-    //                                   specified in this document.
-
-    // Field                  Data Type     Octet  Note
-    // time_hi_and_version    unsigned 16   6-7    The high field of the
-    //                                             bit integer
-    //                                             timestamp multiplexed
-    //                                             with the version number
-    bits_[5] &= 0x4f; // Clear bits 7, 5 and 4
-    bits_[5] |= 0x40; // Set bit 6
+    GenerateUUID4Bits(bits_);
 }
 
 void Uuid4::Stringify() {
-    static constexpr char chars[] = "0123456789abcdef";
-    static constexpr int dash_indices[] = {4, 6, 8, 10};
-    const int* didx = dash_indices;
-
-    std::stringstream ss;
-
-    for (int i = 0; i < 16; i++) {
-        if (i == *didx) {
-            ss << "-";
-            didx++;
-        }
-
-        auto octet = bits_[i];
-        ss << chars[octet >> 4] << chars[octet & 0x0f];
-    }
-
-    str_ = ss.str();
+    str_ = FormatUUID(bits_);
 }
 
 std::string GenerateUUID() {
-    return Uuid4();
+    return GenerateUUID4();
 }
 
-void TopicExprMatcher::ReplaceAll(std::string& s, const std::string& what, const std::string& with) {
-    auto lwhat = what.size();
-    auto lwith = with.size();
+TopicExprMatcher::TopicExprMatcher(std::string topic_expr)
+    : expr_{std::move(topic_expr)} {}
 
-    for (auto p = s.find(what); p != std::string::npos; p = s.find(what, p)) {
-        s.replace(p, lwhat, with);
-        p += lwith;
-    }
+bool TopicExprMatcher::Match(const std::string& topic) const {
+    return Match(expr_.data(), expr_.data() + expr_.size(), topic.data(), topic.data() + topic.size());
 }
 
-TopicExprMatcher::TopicExprMatcher(std::string topic_expr) {
-    // '$' must be escaped
-    ReplaceAll(topic_expr, "$", R"(\$)");
-
-    // '.' must be escaped
-    ReplaceAll(topic_expr, ".", R"(\.)");
-
-    // '+' must be replaced with [^/]+
-    ReplaceAll(topic_expr, "+", R"([^/]+)");
+bool TopicExprMatcher::Match(const char* expr, const char* expr_end, const char* topic, const char* topic_end) {
+    while (expr != expr_end) {
+        switch (*expr) {
+            case '#':
+                // '#' may only appear at the end of the expression
+                if (expr + 1 == expr_end) {
+                    return true;
+                }
+                break;
+            case '+': {
+                // Try every non-empty part of the current level, the longest
+                // first. Only '+' within the same level requires backtracking.
+                auto level_end = topic;
+                while (level_end != topic_end && *level_end != '/') {
+                    level_end++;
+                }
+
+                for (auto p = level_end; p != topic; p--) {
+                    if (Match(expr + 1, expr_end, p, topic_end)) {
+                        return true;
+                    }
+                }
+
+                return false;
+            }
+            default:
+                break;
+        }
 
-    auto size = topic_expr.size();
+        if (topic == topic_end || *expr != *topic) {
+            return false;
+        }
 
-    // '#' may only appear at the end of the expression
-    if (topic_expr[size - 1] == '#') {
-        topic_expr.replace(size - 1, 1, ".*");
+        expr++;
+        topic++;
     }
 
-    expr_ = std::regex{topic_expr};
-}
-
-bool TopicExprMatcher::Match(const std::string& topic) const {
-    return std::regex_match(topic.c_str(), expr_);
+    return topic == topic_end;
 }
 
 }  // namespace core
@@ -215,7 +215,7 @@ TEST(call, ReplyGatherer_Gather) {
        public:
         TestProtocolGateway() : ProtocolGateway{test_config} {}
 
-        MOCK_METHOD(void, Publish, (const std::string&, const std::string&, const PublishOptions&), (override));
+        MOCK_METHOD(bool, Publish, (const std::string&, const std::string&, const PublishOptions&), (override));
     };
 
     auto tokens = std::vector<CallToken>{CallToken{"a"}, CallToken{"b"}, CallToken{"c"}};
@@ -255,31 +255,48 @@ TEST(call, ReplyGatherer_Gather) {
  * the Gatherer associated with a particular call_token_t
  */
 TEST(call, ReplyHandler_ExtractGatherer) {
-    class GathererMock : public Gatherer {
-       public:
-        GathererMock() : Gatherer(nullptr, {}) {}
-
-        MOCK_METHOD(bool, Wants, (const call_id_t&), (const override));
-        MOCK_METHOD(void, ForwardReplies, (const std::vector<json>&), (const override));
-    };
-
     ReplyHandler h;
 
-    auto g0 = std::make_shared<GathererMock>();
-    EXPECT_CALL(*g0, Wants("g1")).WillRepeatedly(::testing::Return(false));
-    EXPECT_CALL(*g0, Wants("g0")).WillOnce(::testing::Return(true));
+    auto g0 = std::make_shared<SinkGatherer>(nullptr, nullptr, std::vector<CallToken>{CallToken{"g0", 1000}});
     h.AddGatherer(g0);
 
-    auto g1 = std::make_shared<GathererMock>();
-    EXPECT_CALL(*g1, Wants("g0")).WillRepeatedly(::testing::Return(false));
-    EXPECT_CALL(*g1, Wants("g1")).WillOnce(::testing::Return(true));
+    auto g1 = std::make_shared<SinkGatherer>(nullptr, nullptr, std::vector<CallToken>{CallToken{"g1a", 1000}, CallToken{"g1b", 1000}});
     h.AddGatherer(g1);
 
-    ASSERT_NE(h.ExtractGatherer("g0"), nullptr);
+    ASSERT_EQ(h.GetPendingCount(), 2);
+
+    ASSERT_EQ(h.ExtractGatherer("g0"), g0);
     ASSERT_EQ(h.ExtractGatherer("g0"), nullptr);
 
-    ASSERT_NE(h.ExtractGatherer("g1"), nullptr);
-    ASSERT_EQ(h.ExtractGatherer("g1"), nullptr);
+    // Extracting a gatherer by any of its IDs removes it entirely
+    ASSERT_EQ(h.ExtractGatherer("g1b"), g1);
+    ASSERT_EQ(h.ExtractGatherer("g1a"), nullptr);
+    ASSERT_EQ(h.ExtractGatherer("g1b"), nullptr);
+
+    ASSERT_EQ(h.GetPendingCount(), 0);
+}
+
+/**
+ * @brief Verify that ReplyHandler::GatherReply only returns a Gatherer once
+ * it has gathered all its replies.
+ */
+TEST(call, ReplyHandler_GatherReply) {
+    ReplyHandler h;
+
+    auto g = std::make_shared<SinkGatherer>(nullptr, nullptr, std::vector<CallToken>{CallToken{"a", 1000}, CallToken{"b", 1000}});
+    h.AddGatherer(g);
+
+    ASSERT_EQ(h.GatherReply("unknown", json{}), nullptr);
+    ASSERT_EQ(h.GatherReply("a", json(1)), nullptr);
+    ASSERT_EQ(h.GetPendingCount(), 1);
+
+    // A duplicate reply is ignored
+    ASSERT_EQ(h.GatherReply("a", json(1)), nullptr);
+
+    ASSERT_EQ(h.GatherReply("b", json(2)), g);
+    ASSERT_EQ(g->GetReplies(), (std::vector<json>{json(1), json(2)}));
+    ASSERT_EQ(h.GetPendingCount(), 0);
+    ASSERT_EQ(h.GatherReply("b", json(2)), nullptr);
 }
 
 /**
@@ -287,41 +304,30 @@ TEST(call, ReplyHandler_ExtractGatherer) {
  * whose CallTokens have timed out.
  */
 TEST(call, ReplyHandler_ExtractTimedOut) {
-    class GathererMock : public Gatherer {
-       public:
-        GathererMock() : Gatherer(nullptr, {}) {}
-
-        MOCK_METHOD(bool, HasTimedOut, (int64_t), (const override));
-        MOCK_METHOD(void, ForwardReplies, (const std::vector<json>&), (const override));
+    auto make_gatherer = [](const std::vector<int64_t>& timeouts) {
+        std::vector<CallToken> tokens;
+        for (auto t : timeouts) {
+            tokens.emplace_back(std::to_string(t) + "-" + std::to_string(tokens.size()), t);
+        }
+        return std::make_shared<SinkGatherer>(nullptr, nullptr, tokens, 0);
     };
 
-    ReplyHandler h;
+    ReplyHandler h{0, 1};
 
     // Expected to timeout at t=3
-    auto g0 = std::make_shared<GathererMock>();
-    EXPECT_CALL(*g0, HasTimedOut(0)).WillOnce(::testing::Return(false));
-    EXPECT_CALL(*g0, HasTimedOut(1)).WillOnce(::testing::Return(false));
-    EXPECT_CALL(*g0, HasTimedOut(2)).WillOnce(::testing::Return(false));
-    EXPECT_CALL(*g0, HasTimedOut(3)).WillOnce(::testing::Return(true));
+    auto g0 = make_gatherer({3, 5});
     h.AddGatherer(g0);
 
     // Expected to timeout at t=2
-    auto g1 = std::make_shared<GathererMock>();
-    EXPECT_CALL(*g1, HasTimedOut(0)).WillOnce(::testing::Return(false));
-    EXPECT_CALL(*g1, HasTimedOut(1)).WillOnce(::testing::Return(false));
-    EXPECT_CALL(*g1, HasTimedOut(2)).WillOnce(::testing::Return(true));
+    auto g1 = make_gatherer({2});
     h.AddGatherer(g1);
 
-    // Expected to timeout at t=2
-    auto g2 = std::make_shared<GathererMock>();
-    EXPECT_CALL(*g2, HasTimedOut(0)).WillOnce(::testing::Return(false));
-    EXPECT_CALL(*g2, HasTimedOut(1)).WillOnce(::testing::Return(true));
+    // Expected to timeout at t=1
+    auto g2 = make_gatherer({4, 1});
     h.AddGatherer(g2);
 
-    // Expected to timeout at t=0
-    auto g3 = std::make_shared<GathererMock>();
-    EXPECT_CALL(*g3, HasTimedOut(0)).WillOnce(::testing::Return(false));
-    EXPECT_CALL(*g3, HasTimedOut(1)).WillOnce(::testing::Return(true));
+    // Expected to timeout at t=1
+    auto g3 = make_gatherer({1});
     h.AddGatherer(g3);
 
     // Expect nothing to timeout at t=0 and t=4
@@ -330,6 +336,37 @@ TEST(call, ReplyHandler_ExtractTimedOut) {
     ASSERT_EQ(h.ExtractTimedOut(2), std::vector<std::shared_ptr<Gatherer>>{g1});
     ASSERT_EQ(h.ExtractTimedOut(3), std::vector<std::shared_ptr<Gatherer>>{g0});
     ASSERT_EQ(h.ExtractTimedOut(4), std::vector<std::shared_ptr<Gatherer>>{});
+    ASSERT_EQ(h.GetPendingCount(), 0);
+}
+
+/**
+ * @brief Verify that ReplyHandler evicts and times out the oldest Gatherers
+ * when the number of pending Gatherers exceeds the limit.
+ */
+TEST(call, ReplyHandler_MaxPending) {
+    ReplyHandler h{2};
+
+    std::vector<std::string> timed_out;
+    auto make_gatherer = [&timed_out](const std::string& id) {
+        auto on_timeout = [&timed_out, id] { timed_out.push_back(id); };
+        return std::make_shared<SinkGatherer>(nullptr, on_timeout, std::vector<CallToken>{CallToken{id, 0}});
+    };
+
+    h.AddGatherer(make_gatherer("g0"));
+    h.AddGatherer(make_gatherer("g1"));
+    ASSERT_TRUE(timed_out.empty());
+
+    h.AddGatherer(make_gatherer("g2"));
+    ASSERT_EQ(timed_out, std::vector<std::string>{"g0"});
+    ASSERT_EQ(h.GetPendingCount(), 2);
+    ASSERT_EQ(h.ExtractGatherer("g0"), nullptr);
+
+    // Lowering the limit takes effect on the next addition
+    h.SetMaxPending(1);
+    h.AddGatherer(make_gatherer("g3"));
+    ASSERT_EQ(timed_out, (std::vector<std::string>{"g0", "g1", "g2"}));
+    ASSERT_EQ(h.GetPendingCount(), 1);
+    ASSERT_NE(h.ExtractGatherer("g3"), nullptr);
 }
 
 /**
@@ -39,7 +39,7 @@ class TestProtocolGateway : public ProtocolGateway {
    public:
     TestProtocolGateway() : ProtocolGateway{test_config, "", false} {}
 
-    MOCK_METHOD(void, Publish, (const std::string&, const std::string&, const PublishOptions&), (override));
+    MOCK_METHOD(bool, Publish, (const std::string&, const std::string&, const PublishOptions&), (override));
 
     MOCK_METHOD(void, Subscribe, (const std::string&, on_msg_func_ptr, const SubscribeOptions&), (override));
 
@@ -58,8 +58,8 @@ TEST(client, Client_Receive) {
                     std::make_shared<ReplyHandler>()) {}
 
         using Client::Receive;
-        MOCK_METHOD(void, HandleEvent, (const std::string&, const std::string&), (override));
-        MOCK_METHOD(void, HandleCallReply, (const std::string&, const std::string&, const call_id_t&, const std::string&), (override));
+        MOCK_METHOD(void, HandleEvent, (const std::string&, const payload_ptr&), (override));
+        MOCK_METHOD(void, HandleCallReply, (const std::string&, const std::string&, const call_id_t&, const payload_ptr&), (override));
         MOCK_METHOD(void, HandleDiscover, (const std::string&), (override));
         MOCK_METHOD(void, HandlePlatformEvent, (const std::string&), (override));
     };
@@ -67,11 +67,11 @@ TEST(client, Client_Receive) {
     TestClient client;
 
     // Verify that messages sent under the "event topic" get routed to HandleEvent
-    EXPECT_CALL(client, HandleEvent("talent-name", "some message"));
+    EXPECT_CALL(client, HandleEvent("talent-name", ::testing::Pointee(std::string{"some message"})));
     client.Receive("iotea/talent/talent-name/events", "some message", "");
 
     // Verify that messages sent under the "call reply topic" get routed to HandleCallReply
-    EXPECT_CALL(client, HandleCallReply("talent-name", "channel_id", call_id_t{"call_id"}, "some message"));
+    EXPECT_CALL(client, HandleCallReply("talent-name", "channel_id", call_id_t{"call_id"}, ::testing::Pointee(std::string{"some message"})));
     client.Receive("iotea/talent/talent-name/events/talent-name.channel_id/call_id", "some message", "");
 
     // Verify that messages sent under the "discover topic" get routed to HandleDiscover
@@ -83,6 +83,42 @@ TEST(client, Client_Receive) {
     client.Receive("iotea/platform/$events", "some message", "");
 }
 
+TEST(client, Client_ReceivePayload) {
+    class TestClient : public Client {
+       public:
+        explicit TestClient(const DispatchOptions& dispatch_options)
+            : Client(std::make_shared<TestProtocolGateway>(),
+                    std::make_shared<CalleeTalent>("00000000-0000-0000-0000-000000000000"),
+                    std::make_shared<ReplyHandler>(), dispatch_options) {}
+
+        using Client::Receive;
+        MOCK_METHOD(void, HandleEvent, (const std::string&, const payload_ptr&), (override));
+    };
+
+    auto payload = std::make_shared<const std::string>("some message");
+
+    // Verify that the payload is handed to the handler without being copied
+    {
+        TestClient client{DispatchOptions{}};
+
+        payload_ptr handled;
+        EXPECT_CALL(client, HandleEvent("talent-name", ::testing::Pointee(std::string{"some message"})))
+            .WillOnce(::testing::SaveArg<1>(&handled));
+        client.Receive("iotea/talent/talent-name/events", payload, "");
+
+        ASSERT_EQ(handled, payload);
+    }
+
+    // Verify that the dispatcher keeps a reference instead of a copy. The
+    // dispatcher is never started, the message stays queued.
+    {
+        TestClient client{DispatchOptions{2}};
+
+        client.Receive("iotea/talent/talent-name/events", payload, "");
+        ASSERT_EQ(payload.use_count(), 2);
+    }
+}
+
 TEST(client, Client_HandleAsCall) {
     class TestClient : public Client {
        public:
@@ -168,10 +204,10 @@ TEST(client, Client_HandleEvent) {
     // Errors should immediately be passed on to HandleError
     //
     EXPECT_CALL(client, HandleError(::testing::_));
-    client.HandleEvent("function_talent", R"({
+    client.HandleEvent("function_talent", std::make_shared<const std::string>(R"({
         "msgType": 4,
         "code": 4000
-    })");
+    })"));
 
 
     auto function_talent = std::make_shared<TestFunctionTalent>("function_talent");
@@ -184,7 +220,7 @@ TEST(client, Client_HandleEvent) {
     // Expect HandleAsCall to be called when a "function call event" is
     // handled. Handle event should return immediately if the call was handled.
     EXPECT_CALL(client, HandleAsCall(::testing::_, ::testing::_)).WillOnce(::testing::Return(true));
-    client.HandleEvent("function_talent", R"({
+    client.HandleEvent("function_talent", std::make_shared<const std::string>(R"({
         "msgType": 1,
         "subject": "subject",
         "feature": "function_talent.function-in",
@@ -198,7 +234,7 @@ TEST(client, Client_HandleEvent) {
         "instance": "instance",
         "returnTopic": "return_topic",
         "whenMs": 1234
-    })");
+    })"));
 
 
     // Expect HandleAsCall to be called when a "function call event" is
@@ -209,7 +245,7 @@ TEST(client, Client_HandleEvent) {
     // OnEvent method if HandleAsCall returns false.
     EXPECT_CALL(*function_talent, OnEvent(::testing::_, ::testing::_));
 
-    client.HandleEvent("function_talent", R"({
+    client.HandleEvent("function_talent", std::make_shared<const std::string>(R"({
         "msgType": 1,
         "subject": "subject",
         "feature": "feature",
@@ -218,7 +254,7 @@ TEST(client, Client_HandleEvent) {
         "type": "type",
         "instance": "instance",
         "whenMs": 1234
-    })");
+    })"));
 
 
     // We need a plain talent to test that events are properly forwarded.
@@ -227,7 +263,7 @@ TEST(client, Client_HandleEvent) {
 
     // Verify that the subscription talent's OnEvent methods was called
     EXPECT_CALL(*subscription_talent, OnEvent(::testing::_, ::testing::_));
-    client.HandleEvent("subscription_talent", R"({
+    client.HandleEvent("subscription_talent", std::make_shared<const std::string>(R"({
         "msgType": 1,
         "subject": "subject",
         "feature": "feature",
@@ -236,13 +272,13 @@ TEST(client, Client_HandleEvent) {
         "type": "type",
         "instance": "instance",
         "whenMs": 1234
-    })");
+    })"));
 
 
     // If event was not aimed at any of the user supplied talents then at least
     // it should be aimed at the interal CalleeTalent
     EXPECT_CALL(*callee_talent, OnEvent(::testing::_, ::testing::_));
-    client.HandleEvent("00000000-0000-0000-0000-000000000000", R"({
+    client.HandleEvent("00000000-0000-0000-0000-000000000000", std::make_shared<const std::string>(R"({
         "msgType": 1,
         "subject": "subject",
         "feature": "feature",
@@ -251,7 +287,183 @@ TEST(client, Client_HandleEvent) {
         "type": "type",
         "instance": "instance",
         "whenMs": 1234
+    })"));
+}
+
+/**
+ * @brief Verify that the event handed to a talent refers to the received
+ * payload instead of a copy of it.
+ */
+TEST(client, Client_HandleEvent_SharedPayload) {
+    class TestTalent : public Talent {
+       public:
+        explicit TestTalent(const std::string& name)
+            : Talent{name} {}
+
+        void OnEvent(event_ptr event, event_ctx_ptr) override {
+            received = event;
+        }
+
+        event_ptr received;
+    };
+
+    class TestClient : public Client {
+       public:
+        TestClient()
+            : Client(std::make_shared<TestProtocolGateway>(),
+                    std::make_shared<CalleeTalent>("00000000-0000-0000-0000-000000000000"),
+                    std::make_shared<ReplyHandler>()) {}
+
+        using Client::Receive;
+    };
+
+    TestClient client;
+    auto talent = std::make_shared<TestTalent>("subscription_talent");
+    client.RegisterTalent(talent);
+
+    auto payload = std::make_shared<const std::string>(R"({
+        "msgType": 1,
+        "subject": "subject",
+        "feature": "feature",
+        "value": "value",
+        "type": "type",
+        "instance": "instance",
+        "whenMs": 1234
     })");
+    client.Receive("iotea/talent/subscription_talent/events", payload, "");
+
+    ASSERT_TRUE(talent->received);
+    ASSERT_EQ(talent->received->GetPayload(), payload);
+    ASSERT_EQ(talent->received->GetPayload()->data(), payload->data());
+    ASSERT_EQ(talent->received->GetSubject(), "subject");
+}
+
+/**
+ * @brief Verify that events with malformed nested JSON are dropped and that
+ * the parse error does not escape from Receive.
+ */
+TEST(client, Client_Receive_MalformedNested) {
+    class TestTalent : public Talent {
+       public:
+        explicit TestTalent(const std::string& name)
+            : Talent{name} {}
+
+        MOCK_METHOD(void, OnEvent, (event_ptr, event_ctx_ptr), (override));
+    };
+
+    class TestClient : public Client {
+       public:
+        TestClient()
+            : Client(std::make_shared<TestProtocolGateway>(),
+                    std::make_shared<CalleeTalent>("00000000-0000-0000-0000-000000000000"),
+                    std::make_shared<ReplyHandler>()) {}
+
+        using Client::Receive;
+    };
+
+    TestClient client;
+    auto talent = std::make_shared<TestTalent>("subscription_talent");
+    client.RegisterTalent(talent);
+
+    // The value is rejected before the talent sees the event
+    EXPECT_CALL(*talent, OnEvent(::testing::_, ::testing::_)).Times(0);
+    ASSERT_NO_THROW(client.Receive("iotea/talent/subscription_talent/events", R"({
+        "msgType": 1,
+        "subject": "subject",
+        "feature": "feature",
+        "value": {"a": tru},
+        "type": "type",
+        "instance": "instance",
+        "whenMs": 1234
+    })", ""));
+    ::testing::Mock::VerifyAndClearExpectations(talent.get());
+
+    // The features are decoded by the talent, the error is caught
+    EXPECT_CALL(*talent, OnEvent(::testing::_, ::testing::_)).WillOnce(::testing::Invoke(
+        [](event_ptr event, event_ctx_ptr) { event->GetFeatures(); }));
+    ASSERT_NO_THROW(client.Receive("iotea/talent/subscription_talent/events", R"({
+        "msgType": 1,
+        "subject": "subject",
+        "feature": "feature",
+        "value": 1,
+        "$features": {"a": [1, 2,]},
+        "type": "type",
+        "instance": "instance",
+        "whenMs": 1234
+    })", ""));
+
+    // A malformed reply is dropped as well
+    ASSERT_NO_THROW(client.Receive("iotea/talent/subscription_talent/events/subscription_talent.channel_id/call_id", R"({
+        "msgType": 1,
+        "subject": "subject",
+        "feature": "feature",
+        "value": {"value": nul},
+        "type": "type",
+        "instance": "instance",
+        "whenMs": 1234
+    })", ""));
+}
+
+/**
+ * @brief Verify that an output declared with different emit policies by two
+ * talents is left unshaped instead of one policy applying to both.
+ */
+TEST(client, Client_CreateShaper) {
+    class TestTalent : public Talent {
+       public:
+        explicit TestTalent(const std::string& name)
+            : Talent{name} {}
+
+        using Talent::AddOutput;
+    };
+
+    class TestClient : public Client {
+       public:
+        TestClient()
+            : Client(std::make_shared<TestProtocolGateway>(),
+                    std::make_shared<CalleeTalent>("00000000-0000-0000-0000-000000000000"),
+                    std::make_shared<ReplyHandler>()) {}
+
+        using Client::CreateShaper;
+    };
+
+    TestClient client;
+
+    auto alpha = std::make_shared<TestTalent>("alpha");
+    alpha->AddOutput("temperature", schema::Metadata{"temperature"}, EmitPolicy{}.Deadband(1.0));
+    alpha->AddOutput("humidity", schema::Metadata{"humidity"}, EmitPolicy{}.Conflate(1000));
+    alpha->AddOutput("pressure", schema::Metadata{"pressure"}, EmitPolicy{}.RateLimit(1));
+    client.RegisterTalent(alpha);
+
+    auto beta = std::make_shared<TestTalent>("beta");
+    beta->AddOutput("temperature", schema::Metadata{"temperature"}, EmitPolicy{}.Deadband(5.0));
+    beta->AddOutput("pressure", schema::Metadata{"pressure"}, EmitPolicy{}.RateLimit(1));
+    client.RegisterTalent(beta);
+
+    client.CreateShaper();
+
+    // The conflicting policies of "temperature" are dropped, the same policy
+    // declared twice is kept
+    auto stats = client.GetEmitStats();
+    ASSERT_EQ(stats.size(), 2u);
+    ASSERT_EQ(stats.count("temperature"), 0u);
+    ASSERT_EQ(stats.count("humidity"), 1u);
+    ASSERT_EQ(stats.count("pressure"), 1u);
+
+    // Without any policy left there is no shaper at all
+    TestClient conflicting;
+
+    auto gamma = std::make_shared<TestTalent>("gamma");
+    gamma->AddOutput("temperature", schema::Metadata{"temperature"}, EmitPolicy{}.Deadband(1.0));
+    conflicting.RegisterTalent(gamma);
+    conflicting.RegisterTalent(beta);
+
+    auto delta = std::make_shared<TestTalent>("delta");
+    delta->AddOutput("pressure", schema::Metadata{"pressure"}, EmitPolicy{}.RateLimit(2));
+    conflicting.RegisterTalent(delta);
+
+    conflicting.CreateShaper();
+    ASSERT_TRUE(conflicting.GetEmitStats().empty());
 }
 
 TEST(client, Client_HandleDiscover) {
@@ -45,7 +45,7 @@ TEST(context, EventContext_Emit) {
        public:
         TestProtocolGateway() : ProtocolGateway{test_config} {}
 
-        MOCK_METHOD(void, Publish, (const std::string&, const std::string&, const PublishOptions&), (override));
+        MOCK_METHOD(bool, Publish, (const std::string&, const std::string&, const PublishOptions&), (override));
     };
 
     auto gateway = std::make_shared<TestProtocolGateway>();
@@ -57,7 +57,7 @@ TEST(context, EventContext_Emit) {
     // we have to store the output in a string, parse it as JSON and compare it
     // "semantically" to what we expect.
     std::string raw_published_event;
-    EXPECT_CALL(*gateway, Publish(::testing::_, ::testing::_, ::testing::_)).Times(1).WillOnce(::testing::SaveArg<1>(&raw_published_event));
+    EXPECT_CALL(*gateway, Publish(::testing::_, ::testing::_, ::testing::_)).Times(1).WillOnce(::testing::DoAll(::testing::SaveArg<1>(&raw_published_event), ::testing::Return(true)));
 
     ctx.Emit<std::string>("my_feature", "hello world", "my_type", "my_instance");
     auto published_event = json::parse(raw_published_event);
@@ -80,6 +80,110 @@ TEST(context, EventContext_Emit) {
     ASSERT_EQ(published_event, want);
 }
 
+/**
+ * @brief Verify that EventContext::EmitBatch sends the events as a single
+ * array, or hands them to the Outbox if there is one.
+ */
+TEST(context, EventContext_EmitBatch) {
+    class TestProtocolGateway : public ProtocolGateway {
+       public:
+        TestProtocolGateway() : ProtocolGateway{test_config} {}
+
+        MOCK_METHOD(bool, Publish, (const std::string&, const std::string&, const PublishOptions&), (override));
+        MOCK_METHOD(bool, PublishBatch, (const std::vector<PublishEntry>&), (override));
+    };
+
+    auto gateway = std::make_shared<TestProtocolGateway>();
+    auto ctx = EventContext{"my_talent_id", "my_channel_id", "my_subject", "my_return_topic", nullptr, gateway, []{ return ""; }};
+
+    std::string raw_published_events;
+    EXPECT_CALL(*gateway, Publish("my_return_topic", ::testing::_, ::testing::_)).Times(1).WillOnce(::testing::DoAll(::testing::SaveArg<1>(&raw_published_events), ::testing::Return(true)));
+
+    ctx.EmitBatch({
+        {"temperature", 20, "my_type", "my_instance"},
+        {"humidity", 0.5},
+    });
+
+    auto published_events = json::parse(raw_published_events);
+    ASSERT_TRUE(published_events.is_array());
+    ASSERT_EQ(published_events.size(), 2u);
+    ASSERT_EQ(published_events[0]["whenMs"], published_events[1]["whenMs"]);
+
+    for (auto& e : published_events) {
+        e["whenMs"] = int64_t{1234};
+    }
+
+    auto want = json::parse(R"([
+        {"subject": "my_subject", "feature": "temperature", "value": 20, "type": "my_type", "instance": "my_instance", "whenMs": 1234},
+        {"subject": "my_subject", "feature": "humidity", "value": 0.5, "type": "default", "instance": "default", "whenMs": 1234}
+    ])");
+
+    ASSERT_EQ(published_events, want);
+
+    // Coalesced with the other events of the return topic
+    auto outbox = std::make_shared<Outbox>(gateway, 10, 60000);
+    auto batching_ctx = EventContext{"my_talent_id", "my_channel_id", "my_subject", "my_return_topic", nullptr, gateway, []{ return ""; }, outbox};
+
+    std::vector<PublishEntry> published_batch;
+    EXPECT_CALL(*gateway, PublishBatch(::testing::_)).Times(1).WillOnce(::testing::DoAll(::testing::SaveArg<0>(&published_batch), ::testing::Return(true)));
+
+    batching_ctx.Emit("temperature", 21);
+    batching_ctx.EmitBatch({{"temperature", 22}, {"humidity", 0.6}});
+    outbox->Flush();
+
+    ASSERT_EQ(published_batch.size(), 1u);
+    ASSERT_EQ(published_batch[0].topic, "my_return_topic");
+
+    auto coalesced = json::parse(published_batch[0].msg);
+    ASSERT_EQ(coalesced.size(), 3u);
+    ASSERT_EQ(coalesced[0]["value"], 21);
+    ASSERT_EQ(coalesced[1]["value"], 22);
+    ASSERT_EQ(coalesced[2]["value"], 0.6);
+}
+
+/**
+ * @brief Verify that EventContext::Emit and EventContext::EmitBatch apply
+ * the EmitPolicy of each feature.
+ */
+TEST(context, EventContext_EmitPolicy) {
+    class TestProtocolGateway : public ProtocolGateway {
+       public:
+        TestProtocolGateway() : ProtocolGateway{test_config} {}
+
+        MOCK_METHOD(bool, Publish, (const std::string&, const std::string&, const PublishOptions&), (override));
+    };
+
+    auto gateway = std::make_shared<TestProtocolGateway>();
+    auto shaper = std::make_shared<EmitShaper>();
+    shaper->SetPolicy("temperature", EmitPolicy{}.Deadband(1.0));
+    shaper->SetPolicy("humidity", EmitPolicy{}.Conflate(60000));
+
+    auto ctx = EventContext{"my_talent_id", "my_channel_id", "my_subject", "my_return_topic", nullptr, gateway, []{ return ""; }, nullptr, shaper};
+
+    std::vector<std::string> published;
+    EXPECT_CALL(*gateway, Publish("my_return_topic", ::testing::_, ::testing::_)).WillRepeatedly(::testing::Invoke(
+        [&published](const std::string&, const std::string& msg, const PublishOptions&) {
+            published.push_back(msg);
+            return true;
+        }));
+
+    ctx.Emit("temperature", 20);
+    ctx.Emit("temperature", 20.5);  // Within the deadband
+    ctx.Emit<std::string>("temperature", "unknown");
+    ctx.EmitBatch({{"temperature", 20.9}, {"temperature", 22}, {"humidity", 0.5}, {"humidity", 0.6}});
+
+    ASSERT_EQ(published.size(), 3u);
+    ASSERT_EQ(json::parse(published[0])["value"], 20);
+    ASSERT_EQ(json::parse(published[1])["value"], "unknown");
+    ASSERT_EQ(json::parse(published[2])["value"], 22);
+
+    // Only the latest humidity of the window is held back
+    shaper->Flush([&published](const std::string&, const std::string& msg) { published.push_back(msg); });
+
+    ASSERT_EQ(published.size(), 4u);
+    ASSERT_EQ(json::parse(published[3])["value"], 0.6);
+}
+
 /**
  * @brief Verify that EventContext::Call sends properly formatted function call
  * messages.
@@ -89,7 +193,7 @@ TEST(context, EventContext_Call) {
        public:
         TestProtocolGateway() : ProtocolGateway{test_config} {}
 
-        MOCK_METHOD(void, Publish, (const std::string&, const std::string&, const PublishOptions&), (override));
+        MOCK_METHOD(bool, Publish, (const std::string&, const std::string&, const PublishOptions&), (override));
     };
 
     auto gateway = std::make_shared<TestProtocolGateway>();
@@ -103,7 +207,7 @@ TEST(context, EventContext_Call) {
     // we have to store the output in a string, parse it as JSON and compare it
     // "semantically" to what we expect.
     std::string raw_published_event;
-    EXPECT_CALL(*gateway, Publish(::testing::_, ::testing::_, ::testing::_)).Times(1).WillOnce(::testing::SaveArg<1>(&raw_published_event));
+    EXPECT_CALL(*gateway, Publish(::testing::_, ::testing::_, ::testing::_)).Times(1).WillOnce(::testing::DoAll(::testing::SaveArg<1>(&raw_published_event), ::testing::Return(true)));
 
     // If the argument isn't an array we expect the SDK to wrap the argument in an array
     auto token = ctx.Call(callee, 42);
@@ -144,7 +248,7 @@ TEST(context, CallContext_Reply) {
        public:
         TestProtocolGateway() : ProtocolGateway{test_config} {}
 
-        MOCK_METHOD(void, Publish, (const std::string&, const std::string&, const PublishOptions&), (override));
+        MOCK_METHOD(bool, Publish, (const std::string&, const std::string&, const PublishOptions&), (override));
     };
 
     class TestCallContext : public CallContext {
@@ -177,7 +281,7 @@ TEST(context, CallContext_Reply) {
     // have to store what's sent, unmarshal it, tweak the timestamp and then
     // verify that the rest of the event lives up to expectations.
     std::string raw_published_reply;
-    EXPECT_CALL(*gateway, Publish(::testing::_, ::testing::_, ::testing::_)).Times(1).WillOnce(::testing::SaveArg<1>(&raw_published_reply));
+    EXPECT_CALL(*gateway, Publish(::testing::_, ::testing::_, ::testing::_)).Times(1).WillOnce(::testing::DoAll(::testing::SaveArg<1>(&raw_published_reply), ::testing::Return(true)));
     ctx.Reply(json{{"key", "value"}});
 
     auto published_reply = json::parse(raw_published_reply);
@@ -0,0 +1,107 @@
+/*****************************************************************************
+ * Copyright (c) 2021 Bosch.IO GmbH
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * SPDX-License-Identifier: MPL-2.0
+ ****************************************************************************/
+
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "dispatcher.hpp"
+
+using namespace iotea::core;
+
+/**
+ * @brief Verify that a Dispatcher without workers executes tasks
+ * synchronously on the posting thread.
+ */
+TEST(dispatcher, Dispatcher_Inline) {
+    Dispatcher d{DispatchOptions{}};
+
+    ASSERT_FALSE(d.IsParallel());
+    ASSERT_TRUE(d.GetStats().empty());
+
+    auto caller = std::this_thread::get_id();
+    auto executor = std::thread::id{};
+
+    d.Post(0, [&executor] { executor = std::this_thread::get_id(); });
+
+    ASSERT_EQ(executor, caller);
+}
+
+/**
+ * @brief Verify that tasks posted with the same key are executed in order and
+ * that all tasks have been executed once the Dispatcher has been stopped.
+ */
+TEST(dispatcher, Dispatcher_Ordering) {
+    static constexpr size_t kKeys = 8;
+    static constexpr int kTasksPerKey = 1000;
+
+    Dispatcher d{DispatchOptions{4}};
+    ASSERT_TRUE(d.IsParallel());
+
+    std::mutex mutex;
+    std::vector<std::vector<int>> executed(kKeys);
+
+    // Tasks posted before Start() are queued
+    for (int i = 0; i < kTasksPerKey; i++) {
+        for (size_t k = 0; k < kKeys; k++) {
+            d.Post(k, [&mutex, &executed, k, i] {
+                std::lock_guard<std::mutex> lock(mutex);
+                executed[k].push_back(i);
+            });
+        }
+    }
+
+    auto stats = d.GetStats();
+    ASSERT_EQ(stats.size(), 4u);
+
+    size_t queued = 0;
+    for (const auto& s : stats) {
+        queued += s.queue_depth;
+        ASSERT_EQ(s.processed, 0u);
+        ASSERT_EQ(s.max_queue_depth, s.queue_depth);
+    }
+    ASSERT_EQ(queued, kKeys * kTasksPerKey);
+
+    d.Start();
+    d.Stop();
+
+    uint64_t processed = 0;
+    for (const auto& s : d.GetStats()) {
+        processed += s.processed;
+        ASSERT_EQ(s.queue_depth, 0u);
+    }
+    ASSERT_EQ(processed, kKeys * kTasksPerKey);
+
+    for (const auto& e : executed) {
+        ASSERT_EQ(e.size(), static_cast<size_t>(kTasksPerKey));
+
+        for (int i = 0; i < kTasksPerKey; i++) {
+            ASSERT_EQ(e[i], i);
+        }
+    }
+}
+
+/**
+ * @brief Verify that tasks posted after the Dispatcher has been stopped are
+ * executed synchronously.
+ */
+TEST(dispatcher, Dispatcher_PostAfterStop) {
+    Dispatcher d{DispatchOptions{2}};
+    d.Start();
+    d.Stop();
+
+    auto executed = false;
+    d.Post(1, [&executed] { executed = true; });
+
+    ASSERT_TRUE(executed);
+}
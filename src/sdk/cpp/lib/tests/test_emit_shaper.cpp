@@ -0,0 +1,183 @@
+/*****************************************************************************
+ * Copyright (c) 2021 Bosch.IO GmbH
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * SPDX-License-Identifier: MPL-2.0
+ ****************************************************************************/
+
+#include <algorithm>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "emit_shaper.hpp"
+
+using namespace iotea::core;
+
+using sent_t = std::vector<std::pair<std::string, std::string>>;
+
+/**
+ * @brief Verify that numbers within the absolute or relative deadband of the
+ * last value sent are suppressed and that other values pass.
+ */
+TEST(emit_shaper, Deadband) {
+    EmitShaper shaper;
+    shaper.SetPolicy("absolute", EmitPolicy{}.Deadband(1.0));
+    shaper.SetPolicy("relative", EmitPolicy{}.Deadband(0, 0.1));
+
+    auto admit = [&shaper](const std::string& feature, double number, const std::string& instance = "i") {
+        return shaper.Admit("s", feature, "t", instance, &number, 0);
+    };
+
+    ASSERT_EQ(admit("absolute", 10), EmitShaper::Decision::SEND);
+    ASSERT_EQ(admit("absolute", 10.5), EmitShaper::Decision::SUPPRESS);
+    ASSERT_EQ(admit("absolute", 9.5), EmitShaper::Decision::SUPPRESS);
+    ASSERT_EQ(admit("absolute", 11), EmitShaper::Decision::SEND);
+
+    // Compared against the last value sent, not the last value emitted
+    ASSERT_EQ(admit("absolute", 11.9), EmitShaper::Decision::SUPPRESS);
+    ASSERT_EQ(admit("absolute", 12), EmitShaper::Decision::SEND);
+
+    // Each instance has its own last value
+    ASSERT_EQ(admit("absolute", 12.1, "j"), EmitShaper::Decision::SEND);
+
+    ASSERT_EQ(admit("relative", 100), EmitShaper::Decision::SEND);
+    ASSERT_EQ(admit("relative", 109), EmitShaper::Decision::SUPPRESS);
+    ASSERT_EQ(admit("relative", 111), EmitShaper::Decision::SEND);
+
+    // Values that are not numbers always pass
+    ASSERT_EQ(shaper.Admit("s", "absolute", "t", "i", nullptr, 0), EmitShaper::Decision::SEND);
+
+    // Features without a policy always pass
+    ASSERT_EQ(admit("unshaped", 12), EmitShaper::Decision::SEND);
+    ASSERT_EQ(admit("unshaped", 12), EmitShaper::Decision::SEND);
+
+    auto stats = shaper.GetStats();
+    ASSERT_EQ(stats.size(), 2);
+    ASSERT_EQ(stats["absolute"].sent, 5);
+    ASSERT_EQ(stats["absolute"].suppressed, 3);
+    ASSERT_EQ(stats["relative"].sent, 2);
+    ASSERT_EQ(stats["relative"].suppressed, 1);
+}
+
+/**
+ * @brief Verify that events exceeding the rate are suppressed once the burst
+ * is used up and that the bucket refills over time.
+ */
+TEST(emit_shaper, RateLimit) {
+    EmitShaper shaper;
+    shaper.SetPolicy("feature", EmitPolicy{}.RateLimit(2, 3));
+
+    auto admit = [&shaper](int64_t now_ms) {
+        return shaper.Admit("s", "feature", "t", "i", nullptr, now_ms);
+    };
+
+    // The burst
+    ASSERT_EQ(admit(1000), EmitShaper::Decision::SEND);
+    ASSERT_EQ(admit(1000), EmitShaper::Decision::SEND);
+    ASSERT_EQ(admit(1000), EmitShaper::Decision::SEND);
+    ASSERT_EQ(admit(1000), EmitShaper::Decision::SUPPRESS);
+
+    // Two events per second, i.e. one every 500ms
+    ASSERT_EQ(admit(1250), EmitShaper::Decision::SUPPRESS);
+    ASSERT_EQ(admit(1500), EmitShaper::Decision::SEND);
+    ASSERT_EQ(admit(1500), EmitShaper::Decision::SUPPRESS);
+
+    // The bucket holds at most the burst
+    ASSERT_EQ(admit(10000), EmitShaper::Decision::SEND);
+    ASSERT_EQ(admit(10000), EmitShaper::Decision::SEND);
+    ASSERT_EQ(admit(10000), EmitShaper::Decision::SEND);
+    ASSERT_EQ(admit(10000), EmitShaper::Decision::SUPPRESS);
+
+    auto stats = shaper.GetStats();
+    ASSERT_EQ(stats["feature"].sent, 7);
+    ASSERT_EQ(stats["feature"].suppressed, 4);
+    ASSERT_EQ(stats["feature"].conflated, 0);
+}
+
+/**
+ * @brief Verify that only the latest event of a conflation window is sent
+ * at the end of the window, per subject, type and instance.
+ */
+TEST(emit_shaper, Conflate) {
+    EmitShaper shaper;
+    shaper.SetPolicy("feature", EmitPolicy{}.Conflate(100));
+    shaper.SetPolicy("other", EmitPolicy{}.Conflate(50));
+
+    ASSERT_EQ(shaper.GetMinConflationWindow(), 50);
+
+    auto emit = [&shaper](const std::string& subject, const std::string& msg, int64_t now_ms) {
+        auto decision = shaper.Admit(subject, "feature", "t", "i", nullptr, now_ms);
+        if (decision == EmitShaper::Decision::HOLD) {
+            shaper.Hold(subject, "feature", "t", "i", "topic", msg);
+        }
+        return decision;
+    };
+
+    sent_t sent;
+    auto sink = [&sent](const std::string& topic, const std::string& msg) { sent.emplace_back(topic, msg); };
+
+    ASSERT_EQ(emit("a", "a1", 1000), EmitShaper::Decision::HOLD);
+    ASSERT_EQ(emit("a", "a2", 1050), EmitShaper::Decision::HOLD);
+    ASSERT_EQ(emit("b", "b1", 1060), EmitShaper::Decision::HOLD);
+
+    // No window has ended yet
+    shaper.FlushExpired(1099, sink);
+    ASSERT_TRUE(sent.empty());
+
+    shaper.FlushExpired(1100, sink);
+    ASSERT_EQ(sent, (sent_t{{"topic", "a2"}}));
+
+    // A new window starts with the next event
+    ASSERT_EQ(emit("a", "a3", 1110), EmitShaper::Decision::HOLD);
+
+    sent.clear();
+    shaper.Flush(sink);
+    std::sort(sent.begin(), sent.end());
+    ASSERT_EQ(sent, (sent_t{{"topic", "a3"}, {"topic", "b1"}}));
+
+    // Nothing is left
+    sent.clear();
+    shaper.Flush(sink);
+    ASSERT_TRUE(sent.empty());
+
+    auto stats = shaper.GetStats();
+    ASSERT_EQ(stats["feature"].sent, 3);
+    ASSERT_EQ(stats["feature"].suppressed, 0);
+    ASSERT_EQ(stats["feature"].conflated, 1);
+}
+
+/**
+ * @brief Verify that the deadband is applied before conflation, so that a
+ * suppressed value does not replace the event held back.
+ */
+TEST(emit_shaper, ConflateWithDeadband) {
+    EmitShaper shaper;
+    shaper.SetPolicy("feature", EmitPolicy{}.Conflate(100).Deadband(1.0));
+
+    auto emit = [&shaper](double number, int64_t now_ms) {
+        auto decision = shaper.Admit("s", "feature", "t", "i", &number, now_ms);
+        if (decision == EmitShaper::Decision::HOLD) {
+            shaper.Hold("s", "feature", "t", "i", "topic", std::to_string(static_cast<int>(number * 10)));
+        }
+        return decision;
+    };
+
+    ASSERT_EQ(emit(10, 0), EmitShaper::Decision::HOLD);
+    ASSERT_EQ(emit(10.5, 10), EmitShaper::Decision::SUPPRESS);
+    ASSERT_EQ(emit(12, 20), EmitShaper::Decision::HOLD);
+
+    sent_t sent;
+    shaper.FlushExpired(100, [&sent](const std::string& topic, const std::string& msg) { sent.emplace_back(topic, msg); });
+    ASSERT_EQ(sent, (sent_t{{"topic", "120"}}));
+
+    auto stats = shaper.GetStats();
+    ASSERT_EQ(stats["feature"].sent, 1);
+    ASSERT_EQ(stats["feature"].suppressed, 1);
+    ASSERT_EQ(stats["feature"].conflated, 1);
+}
@@ -250,3 +250,52 @@ TEST(event, Event_FromJson) {
     ASSERT_EQ(event->GetInstance(), "1");
     ASSERT_EQ(event->GetReturnTopic(), "123456/ingestion/events");
 }
+
+/**
+ * @brief Verify that Event::FromRaw decodes the fields on access and does
+ * not touch the value or the features until they are accessed.
+ */
+TEST(event, Event_FromRaw) {
+    auto raw = std::string{R"({
+            "feature": "temp",
+            "$features": {"history": [1, 2, tru]},
+            "instance": "1",
+            "msgType": 1,
+            "returnTopic": "123456/ingestion/events",
+            "subject": "booliboo",
+            "type": "kuehlschrank",
+            "value": {"temp": 5},
+            "whenMs": 1618550741000
+        })"};
+
+    auto event = Event::FromRaw(RawJsonObject{raw});
+    ASSERT_NE(event, nullptr);
+
+    ASSERT_EQ(event->GetSubject(), "booliboo");
+    ASSERT_EQ(event->GetFeature(), "temp");
+    ASSERT_EQ(event->GetType(), "kuehlschrank");
+    ASSERT_EQ(event->GetInstance(), "1");
+    ASSERT_EQ(event->GetReturnTopic(), "123456/ingestion/events");
+    ASSERT_EQ(event->GetWhen(), 1618550741000);
+    ASSERT_EQ(event->GetValue(), (json{{"temp", 5}}));
+
+    // The malformed features only fail once they are decoded
+    ASSERT_THROW(event->GetFeatures(), json::parse_error);
+
+    // Copies share the decoded fields
+    auto copy = *event;
+    ASSERT_EQ(&copy.GetValue(), &event->GetValue());
+
+    // The event keeps the buffer it was parsed from
+    auto payload = std::make_shared<const std::string>(raw);
+    auto shared = Event::FromRaw(RawJsonObject{payload});
+    ASSERT_NE(shared, nullptr);
+    ASSERT_EQ(shared->GetPayload(), payload);
+    ASSERT_EQ(shared->GetSubject(), "booliboo");
+    auto decoded = Event{"subject", "feature", json{}, json{}, "type", "instance", "", 0};
+    ASSERT_EQ(decoded.GetPayload(), nullptr);
+
+    // Required fields must be present
+    ASSERT_EQ(Event::FromRaw(RawJsonObject{R"({"feature": "temp"})"}), nullptr);
+    ASSERT_EQ(Event::FromRaw(RawJsonObject{"not json"}), nullptr);
+}
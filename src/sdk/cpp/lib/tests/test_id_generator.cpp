@@ -0,0 +1,93 @@
+/*****************************************************************************
+ * Copyright (c) 2021 Bosch.IO GmbH
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * SPDX-License-Identifier: MPL-2.0
+ ****************************************************************************/
+
+#include <mutex>
+#include <regex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "id_generator.hpp"
+
+using namespace iotea::core;
+
+/**
+ * @brief Verify that FormatUUID produces the canonical form of a UUID.
+ */
+TEST(id_generator, FormatUUID) {
+    uint8_t bits[16] = {0x00, 0x11, 0x22, 0x33, 0x44, 0x55, 0x66, 0x77,
+                        0x88, 0x99, 0xaa, 0xbb, 0xcc, 0xdd, 0xee, 0xff};
+
+    ASSERT_EQ(FormatUUID(bits), "00112233-4455-6677-8899-aabbccddeeff");
+}
+
+/**
+ * @brief Verify that GenerateUUID4 produces unique version 4 UUIDs with the
+ * RFC 4122 variant.
+ */
+TEST(id_generator, GenerateUUID4) {
+    auto expr = std::regex{R"([a-f0-9]{8}-[a-f0-9]{4}-4[a-f0-9]{3}-[89ab][a-f0-9]{3}-[a-f0-9]{12})"};
+
+    std::set<std::string> ids;
+    for (auto i = 0; i < 1000; i++) {
+        auto id = GenerateUUID4();
+        ASSERT_TRUE(std::regex_match(id, expr)) << id;
+        ids.insert(id);
+    }
+
+    ASSERT_EQ(ids.size(), 1000);
+}
+
+/**
+ * @brief Verify that GenerateCompactId produces unique IDs sharing a prefix,
+ * also when called from several threads.
+ */
+TEST(id_generator, GenerateCompactId) {
+    auto expr = std::regex{R"(([a-f0-9]{16})-[a-f0-9]+)"};
+
+    std::mutex mutex;
+    std::set<std::string> ids;
+    std::set<std::string> prefixes;
+    std::vector<std::string> malformed;
+
+    auto generate = [&] {
+        for (auto i = 0; i < 1000; i++) {
+            auto id = GenerateCompactId();
+
+            std::smatch m;
+            auto ok = std::regex_match(id, m, expr);
+
+            std::lock_guard<std::mutex> lock{mutex};
+            if (!ok) {
+                malformed.push_back(id);
+                continue;
+            }
+
+            ids.insert(id);
+            prefixes.insert(m[1]);
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (auto i = 0; i < 4; i++) {
+        threads.emplace_back(generate);
+    }
+
+    for (auto& t : threads) {
+        t.join();
+    }
+
+    ASSERT_TRUE(malformed.empty());
+    ASSERT_EQ(ids.size(), 4000);
+    ASSERT_EQ(prefixes.size(), 1);
+}
@@ -0,0 +1,217 @@
+/*****************************************************************************
+ * Copyright (c) 2021 Bosch.IO GmbH
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * SPDX-License-Identifier: MPL-2.0
+ ****************************************************************************/
+
+#include <cstdio>
+#include <fstream>
+#include <regex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "log_writer.hpp"
+
+using namespace iotea::core::logging;
+
+static std::vector<std::string> ReadLines(const std::string& path) {
+    std::ifstream in{path};
+    std::vector<std::string> lines;
+
+    for (std::string line; std::getline(in, line);) {
+        lines.push_back(line);
+    }
+
+    return lines;
+}
+
+/**
+ * @brief Verify that LogRing preserves the order of records and rejects
+ * pushes when full without consuming the record.
+ */
+TEST(log_writer, LogRing_PushPop) {
+    LogRing ring{3};
+
+    // The capacity is rounded up to 4
+    for (auto i = 0; i < 4; i++) {
+        LogRecord r{Level::INFO, {}, std::to_string(i)};
+        ASSERT_TRUE(ring.Push(r));
+    }
+
+    LogRecord overflow{Level::INFO, {}, "overflow"};
+    ASSERT_FALSE(ring.Push(overflow));
+    ASSERT_EQ(overflow.text, "overflow");
+
+    LogRecord r;
+    for (auto i = 0; i < 4; i++) {
+        ASSERT_TRUE(ring.Pop(r));
+        ASSERT_EQ(r.text, std::to_string(i));
+    }
+
+    ASSERT_FALSE(ring.Pop(r));
+
+    ASSERT_FALSE(ring.IsClosed());
+    ring.Close();
+    ASSERT_TRUE(ring.IsClosed());
+}
+
+/**
+ * @brief Verify that lines logged from several threads are all written
+ * once flushed, formatted with a timestamp and tag and in the order in which
+ * each thread logged them.
+ */
+TEST(log_writer, AsyncLogWriter_Write) {
+    auto path = testing::TempDir() + "test_log_writer_write.log";
+    std::remove(path.c_str());
+
+    AsyncLogWriter writer{16};
+    ASSERT_TRUE(writer.SetOutput(path));
+
+    constexpr auto n_threads = 4;
+    constexpr auto n_lines = 1000;
+
+    std::vector<std::thread> threads;
+    for (auto t = 0; t < n_threads; t++) {
+        threads.emplace_back([&writer, t] {
+            for (auto i = 0; i < n_lines; i++) {
+                writer.Write(Level::WARNING, std::chrono::system_clock::now(),
+                             std::to_string(t) + " " + std::to_string(i));
+            }
+        });
+    }
+
+    for (auto& t : threads) {
+        t.join();
+    }
+
+    writer.Flush();
+
+    auto lines = ReadLines(path);
+    ASSERT_EQ(lines.size(), n_threads * n_lines);
+    ASSERT_EQ(writer.GetDroppedCount(), 0);
+
+    auto expr = std::regex{R"(\d{4}-\d{2}-\d{2}T\d{2}:\d{2}:\d{2}\.\d{3}Z    WARN (\d+) (\d+))"};
+    std::vector<int> next(n_threads, 0);
+
+    for (const auto& line : lines) {
+        std::smatch m;
+        ASSERT_TRUE(std::regex_match(line, m, expr)) << line;
+
+        auto t = std::stoi(m[1]);
+        ASSERT_EQ(std::stoi(m[2]), next[t]++);
+    }
+
+    std::remove(path.c_str());
+}
+
+/**
+ * @brief Verify that the drop policy discards lines when the buffer is full
+ * and that the number of dropped lines is reported in the log.
+ */
+TEST(log_writer, AsyncLogWriter_Drop) {
+    auto path = testing::TempDir() + "test_log_writer_drop.log";
+    std::remove(path.c_str());
+
+    AsyncLogWriter writer{2};
+    ASSERT_TRUE(writer.SetOutput(path));
+    writer.SetOverflowPolicy(OverflowPolicy::DROP);
+
+    for (auto i = 0; i < 10000; i++) {
+        writer.Write(Level::INFO, std::chrono::system_clock::now(), "line");
+    }
+
+    writer.Flush();
+
+    auto dropped = writer.GetDroppedCount();
+    auto lines = ReadLines(path);
+
+    size_t reported = 0;
+    size_t written = 0;
+    auto expr = std::regex{R"(.*    WARN \[Logging\] : Dropped (\d+) log lines)"};
+
+    for (const auto& line : lines) {
+        std::smatch m;
+        if (std::regex_match(line, m, expr)) {
+            reported += std::stoul(m[1]);
+        } else {
+            written++;
+        }
+    }
+
+    ASSERT_EQ(reported, dropped);
+    ASSERT_EQ(written + dropped, 10000);
+
+    std::remove(path.c_str());
+}
+
+/**
+ * @brief Verify that lines written after the writer has been stopped are
+ * written synchronously.
+ */
+TEST(log_writer, AsyncLogWriter_Stop) {
+    auto path = testing::TempDir() + "test_log_writer_stop.log";
+    std::remove(path.c_str());
+
+    AsyncLogWriter writer;
+    ASSERT_TRUE(writer.SetOutput(path));
+
+    writer.Write(Level::DEBUG, std::chrono::system_clock::now(), "before");
+    writer.Stop();
+    writer.Write(Level::ERROR, std::chrono::system_clock::now(), "after");
+
+    auto lines = ReadLines(path);
+    ASSERT_EQ(lines.size(), 2);
+
+    std::smatch m;
+    auto expr = std::regex{R"(.*Z(.*))"};
+    ASSERT_TRUE(std::regex_match(lines[0], m, expr));
+    ASSERT_EQ(m[1], "   DEBUG before");
+    ASSERT_TRUE(std::regex_match(lines[1], m, expr));
+    ASSERT_EQ(m[1], "   ERROR after");
+
+    std::remove(path.c_str());
+}
+
+/**
+ * @brief Verify that no line is lost when the writer is stopped while other
+ * threads are writing.
+ */
+TEST(log_writer, AsyncLogWriter_StopConcurrent) {
+    static constexpr int WRITERS = 4;
+    static constexpr int LINES = 2000;
+
+    auto path = testing::TempDir() + "test_log_writer_stop_concurrent.log";
+    std::remove(path.c_str());
+
+    {
+        AsyncLogWriter writer;
+        ASSERT_TRUE(writer.SetOutput(path));
+
+        std::vector<std::thread> writers;
+        for (auto w = 0; w < WRITERS; w++) {
+            writers.emplace_back([&writer] {
+                for (auto i = 0; i < LINES; i++) {
+                    writer.Write(Level::INFO, std::chrono::system_clock::now(), "line");
+                }
+            });
+        }
+
+        writer.Stop();
+
+        for (auto& t : writers) {
+            t.join();
+        }
+    }
+
+    ASSERT_EQ(ReadLines(path).size(), static_cast<size_t>(WRITERS * LINES));
+
+    std::remove(path.c_str());
+}
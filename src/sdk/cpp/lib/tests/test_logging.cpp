@@ -0,0 +1,54 @@
+/*****************************************************************************
+ * Copyright (c) 2021 Bosch.IO GmbH
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * SPDX-License-Identifier: MPL-2.0
+ ****************************************************************************/
+
+#include <string>
+
+#include "gtest/gtest.h"
+
+#include "logging.hpp"
+
+using namespace iotea::core;
+
+/**
+ * @brief Verify that the logging macros only evaluate their arguments if the
+ * level is enabled.
+ */
+TEST(logging, IOTEA_LOG_Gated) {
+    auto logger = logging::NamedLogger{"test"};
+    auto evaluated = 0;
+
+    auto arg = [&evaluated] {
+        evaluated++;
+        return std::string{"arg"};
+    };
+
+    logging::SetLevel(logging::Level::WARNING);
+
+    ASSERT_FALSE(logging::IsEnabled(logging::Level::INFO));
+    ASSERT_TRUE(logging::IsEnabled(logging::Level::WARNING));
+
+    IOTEA_LOG_DEBUG(logger) << arg();
+    IOTEA_LOG_INFO(logger) << arg();
+    ASSERT_EQ(evaluated, 0);
+
+    IOTEA_LOG_WARN(logger) << arg();
+    IOTEA_LOG_ERROR(logger) << arg();
+    ASSERT_EQ(evaluated, 2);
+
+    // The macros must not swallow a following else branch
+    if (evaluated == 0)
+        IOTEA_LOG_ERROR(logger) << arg();
+    else
+        evaluated = -1;
+
+    ASSERT_EQ(evaluated, -1);
+
+    logging::SetLevel(logging::GetLogLevel());
+}
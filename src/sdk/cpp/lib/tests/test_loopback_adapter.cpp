@@ -0,0 +1,183 @@
+/*****************************************************************************
+ * Copyright (c) 2021 Bosch.IO GmbH
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * SPDX-License-Identifier: MPL-2.0
+ ****************************************************************************/
+
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "nlohmann/json.hpp"
+
+#include "loopback_adapter.hpp"
+#include "protocol_gateway.hpp"
+
+using json = nlohmann::json;
+using namespace iotea::core;
+
+// Collects the messages received by a subscription
+class Received {
+   public:
+    on_payload_func_ptr Callback() {
+        return [this](const std::string& topic, const payload_ptr& payload, const std::string&) {
+            std::lock_guard<std::mutex> lock{mutex_};
+            topics_.push_back(topic);
+            payloads_.push_back(payload);
+            cv_.notify_all();
+        };
+    }
+
+    bool WaitFor(size_t n) {
+        std::unique_lock<std::mutex> lock{mutex_};
+        return cv_.wait_for(lock, std::chrono::seconds{5}, [this, n] { return payloads_.size() >= n; });
+    }
+
+    std::vector<std::string> Topics() {
+        std::lock_guard<std::mutex> lock{mutex_};
+        return topics_;
+    }
+
+    std::vector<payload_ptr> Payloads() {
+        std::lock_guard<std::mutex> lock{mutex_};
+        return payloads_;
+    }
+
+   private:
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::vector<std::string> topics_;
+    std::vector<payload_ptr> payloads_;
+};
+
+// Runs an adapter on a thread of its own
+class Running {
+   public:
+    explicit Running(std::shared_ptr<Adapter> adapter)
+        : adapter_{adapter}
+        , thread_{[adapter] { adapter->Start(); }} {}
+
+    ~Running() {
+        adapter_->Stop();
+        thread_.join();
+    }
+
+   private:
+    std::shared_ptr<Adapter> adapter_;
+    std::thread thread_;
+};
+
+/**
+ * @brief Verify that messages are delivered to all adapters on the same bus
+ * with matching subscriptions, sharing a single copy of the payload.
+ */
+TEST(loopback_adapter, Publish_Wildcards) {
+    auto config = json{{"bus", "wildcards"}};
+    auto a = std::make_shared<LoopbackAdapter>("a", false, config);
+    auto b = std::make_shared<LoopbackAdapter>("b", false, config);
+    auto other_bus = std::make_shared<LoopbackAdapter>("c", false, json{{"bus", "other"}});
+
+    Received plus, hash, none, other;
+    a->SubscribePayload("talent/+/events", plus.Callback(), SubscribeOptions{false, ""});
+    b->SubscribePayload("talent/#", hash.Callback(), SubscribeOptions{false, ""});
+    b->SubscribePayload("talent/+", none.Callback(), SubscribeOptions{false, ""});
+    other_bus->SubscribePayload("#", other.Callback(), SubscribeOptions{false, ""});
+
+    Running ra{a}, rb{b}, rc{other_bus};
+
+    ASSERT_TRUE(a->Publish("talent/t1/events", "event", PublishOptions{false, ""}));
+
+    ASSERT_TRUE(plus.WaitFor(1));
+    ASSERT_TRUE(hash.WaitFor(1));
+
+    ASSERT_EQ(plus.Topics()[0], "iotea/talent/t1/events");
+    ASSERT_EQ(*plus.Payloads()[0], "event");
+    ASSERT_EQ(plus.Payloads()[0], hash.Payloads()[0]);
+
+    auto payload = std::make_shared<const std::string>("no copy");
+    b->Publish("talent/t2/events", payload);
+
+    ASSERT_TRUE(plus.WaitFor(2));
+    ASSERT_EQ(plus.Payloads()[1], payload);
+
+    ASSERT_TRUE(none.Payloads().empty());
+    ASSERT_TRUE(other.Payloads().empty());
+}
+
+/**
+ * @brief Verify that each message of a shared subscription is delivered to
+ * one member of the group, in turns, and that adapters that no longer exist
+ * are skipped.
+ */
+TEST(loopback_adapter, SubscribeShared) {
+    auto config = json{{"bus", "shared"}};
+    auto publisher = std::make_shared<LoopbackAdapter>("publisher", false, config);
+
+    Received all;
+    publisher->SubscribePayload("talent/t1/events", all.Callback(), SubscribeOptions{false, ""});
+
+    std::vector<std::shared_ptr<LoopbackAdapter>> members;
+    std::vector<Received> received(3);
+    for (size_t i = 0; i < received.size(); i++) {
+        members.push_back(std::make_shared<LoopbackAdapter>("member", false, config));
+        members[i]->SubscribeSharedPayload("t1", "talent/t1/events", received[i].Callback(), SubscribeOptions{false, ""});
+    }
+
+    // Removed from the group
+    members.pop_back();
+
+    {
+        Running r0{members[0]}, r1{members[1]}, rp{publisher};
+
+        for (auto i = 0; i < 6; i++) {
+            publisher->Publish("talent/t1/events", std::to_string(i), PublishOptions{false, ""});
+        }
+
+        ASSERT_TRUE(all.WaitFor(6));
+        ASSERT_TRUE(received[0].WaitFor(3));
+        ASSERT_TRUE(received[1].WaitFor(3));
+    }
+
+    ASSERT_EQ(received[0].Payloads().size(), 3);
+    ASSERT_EQ(received[1].Payloads().size(), 3);
+    ASSERT_TRUE(received[2].Payloads().empty());
+}
+
+/**
+ * @brief Verify that the ProtocolGateway creates the builtin LoopbackAdapter
+ * without loading a shared library.
+ */
+TEST(loopback_adapter, ProtocolGateway_Builtin) {
+    auto config = ProtocolGateway::CreateConfig(json::array({
+        {
+            {"platform", true},
+            {"module", {{"name", "loopback"}}},
+            {"config", {{"bus", "gateway"}}},
+        }
+    }));
+
+    ProtocolGateway gw{config};
+    gw.Initialize();
+
+    Received received;
+    gw.SubscribeSharedPayload("group", "talent/t1/events", received.Callback());
+
+    std::thread t{[&gw] { gw.Start(); }};
+
+    ASSERT_TRUE(gw.Publish("talent/t1/events", "event"));
+    ASSERT_TRUE(received.WaitFor(1));
+
+    gw.Stop();
+    t.join();
+
+    ASSERT_EQ(*received.Payloads()[0], "event");
+}
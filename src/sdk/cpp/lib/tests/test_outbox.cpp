@@ -0,0 +1,106 @@
+/*****************************************************************************
+ * Copyright (c) 2021 Bosch.IO GmbH
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * SPDX-License-Identifier: MPL-2.0
+ ****************************************************************************/
+
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "gmock/gmock.h"
+#include "nlohmann/json.hpp"
+
+#include "outbox.hpp"
+#include "util.hpp"
+
+using json = nlohmann::json;
+
+using namespace iotea::core;
+
+namespace {
+
+// Records the batches published through the gateway
+class RecordingGateway : public ProtocolGateway {
+   public:
+    RecordingGateway() : ProtocolGateway{"RecordingGateway", false} {}
+
+    bool PublishBatch(const std::vector<PublishEntry>& entries) override {
+        std::vector<std::pair<std::string, std::string>> batch;
+
+        for (const auto& e : entries) {
+            batch.emplace_back(e.topic, e.msg);
+        }
+
+        std::sort(batch.begin(), batch.end());
+        published.push_back(batch);
+        return true;
+    }
+
+    std::vector<std::vector<std::pair<std::string, std::string>>> published;
+};
+
+using batch_t = std::vector<std::pair<std::string, std::string>>;
+
+}  // namespace
+
+/**
+ * @brief Verify that the messages of a topic are published as an array once
+ * max_events are pending and that Flush() publishes the rest, single
+ * messages as they are.
+ */
+TEST(outbox, Post) {
+    auto gateway = std::make_shared<RecordingGateway>();
+    Outbox outbox{gateway, 3, 60000};
+
+    outbox.Post("a", R"({"n":1})");
+    outbox.Post("b", R"({"n":2})");
+    outbox.Post("a", R"({"n":3})");
+    ASSERT_TRUE(gateway->published.empty());
+
+    outbox.Post("a", R"({"n":4})");
+    ASSERT_EQ(gateway->published.size(), 1u);
+    ASSERT_EQ(gateway->published[0], (batch_t{{"a", R"([{"n":1},{"n":3},{"n":4}])"}}));
+
+    outbox.Post("a", R"({"n":5})");
+    outbox.Post("c", R"({"n":6})");
+    outbox.Post("c", R"({"n":7})");
+    outbox.Flush();
+    ASSERT_EQ(gateway->published.size(), 2u);
+    ASSERT_EQ(gateway->published[1], (batch_t{
+        {"a", R"({"n":5})"},
+        {"b", R"({"n":2})"},
+        {"c", R"([{"n":6},{"n":7}])"},
+    }));
+
+    // Nothing left to publish
+    outbox.Flush();
+    ASSERT_EQ(gateway->published.size(), 2u);
+}
+
+/**
+ * @brief Verify that FlushExpired() only publishes the topics whose oldest
+ * message has been held back for max_delay_ms.
+ */
+TEST(outbox, FlushExpired) {
+    auto gateway = std::make_shared<RecordingGateway>();
+    Outbox outbox{gateway, 100, 1000};
+
+    auto start = GetEpochTimeMs();
+    outbox.Post("a", "1");
+    outbox.Post("a", "2");
+
+    outbox.FlushExpired(start - 1);
+    ASSERT_TRUE(gateway->published.empty());
+
+    outbox.FlushExpired(GetEpochTimeMs() + 1000);
+    ASSERT_EQ(gateway->published.size(), 1u);
+    ASSERT_EQ(gateway->published[0], (batch_t{{"a", "[1,2]"}}));
+}
@@ -8,20 +8,33 @@
  * SPDX-License-Identifier: MPL-2.0
  ****************************************************************************/
 
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
 #include "gtest/gtest.h"
 #include "gmock/gmock.h"
 #include "nlohmann/json.hpp"
 
+#include "loopback_adapter.hpp"
 #include "protocol_gateway.hpp"
 
 using json = nlohmann::json;
 
 using iotea::core::Adapter;
+using iotea::core::LoopbackAdapter;
 using iotea::core::ProtocolGateway;
 using iotea::core::PubSubOptions;
+using iotea::core::PublishEntry;
 using iotea::core::PublishOptions;
 using iotea::core::SubscribeOptions;
 using iotea::core::on_msg_func_ptr;
+using iotea::core::on_payload_func_ptr;
+using iotea::core::payload_ptr;
 using ::testing::StrictMock;
 
 TEST(protocol_gateway, PubSubOptions) {
@@ -61,6 +74,11 @@ TEST(protocol_gateway, PublishOptions) {
     ASSERT_EQ(opts.GetAdapterId(), "my_adapter");
     ASSERT_FALSE(opts.Retain());
     ASSERT_TRUE(opts.Stash());
+    ASSERT_EQ(opts.Qos(), PublishOptions::DEFAULT_QOS);
+
+    PublishOptions qos_opts{false, "my_adapter", 1};
+    ASSERT_EQ(qos_opts.Qos(), 1);
+    ASSERT_FALSE(qos_opts == opts);
 }
 
 TEST(protocol_gateway, SubscribeOptions) {
@@ -78,7 +96,7 @@ class MockAdapter : public Adapter {
     MOCK_METHOD(void, Stop, (), (override));
 
 
-    MOCK_METHOD(void, Publish, (const std::string&, const std::string&, const PublishOptions&), (override));
+    MOCK_METHOD(bool, Publish, (const std::string&, const std::string&, const PublishOptions&), (override));
 
     MOCK_METHOD(void, Subscribe, (const std::string&, on_msg_func_ptr, const SubscribeOptions&), (override));
 
@@ -148,6 +166,58 @@ TEST(protocol_gateway, StartStop) {
     gateway.Stop();
 }
 
+/**
+ * @brief Verify that the adapters run concurrently, i.e. that an adapter
+ * blocking in Start() does not keep the others from receiving, and that the
+ * messages of all adapters reach the same subscriber.
+ */
+TEST(protocol_gateway, StartConcurrently) {
+    auto config = ProtocolGateway::CreateConfig(json::array({
+        {
+            {"platform", true},
+            {"module", {{"name", "loopback"}}},
+            {"config", {{"bus", "concurrent-1"}}},
+        },
+        {
+            {"platform", false},
+            {"module", {{"name", "loopback"}}},
+            {"config", {{"bus", "concurrent-2"}}},
+        }
+    }));
+
+    ProtocolGateway gw{config};
+    gw.Initialize();
+
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::vector<std::string> received;
+
+    gw.Subscribe("topic", [&](const std::string&, const std::string& msg, const std::string&) {
+        std::lock_guard<std::mutex> lock{mutex};
+        received.push_back(msg);
+        cv.notify_one();
+    });
+
+    std::thread t{[&gw] { gw.Start(); }};
+
+    // Publish on each bus from outside the gateway
+    LoopbackAdapter p1{"p1", true, {{"bus", "concurrent-1"}}};
+    LoopbackAdapter p2{"p2", true, {{"bus", "concurrent-2"}}};
+    ASSERT_TRUE(p1.Publish("topic", "1", PublishOptions{false, ""}));
+    ASSERT_TRUE(p2.Publish("topic", "2", PublishOptions{false, ""}));
+
+    {
+        std::unique_lock<std::mutex> lock{mutex};
+        EXPECT_TRUE(cv.wait_for(lock, std::chrono::seconds{5}, [&received] { return received.size() == 2; }));
+    }
+
+    gw.Stop();
+    t.join();
+
+    std::sort(received.begin(), received.end());
+    ASSERT_EQ(received, (std::vector<std::string>{"1", "2"}));
+}
+
 TEST(protocol_gateway, Publish) {
     // In this test we use a StrictMock tor wrap the ProtocolGateway, this
     // assures that the test fails if an unexpected call (i.e. a call that has
@@ -260,6 +330,88 @@ TEST(protocol_gateway, Publish) {
         EXPECT_CALL(*adapter2, Publish("test/topic", "test_message", opts));
         gw.Publish("test/topic", "test_message", opts);
     }
+
+    // GW - platform proto is not set
+    // Adapter1 - platform proto is set
+    // Adapter2 - platform proto is not set
+    // Publish opt - platform proto is set
+    //             - name is set to "adapter2" or an unknown adapter
+    //
+    // Expect call to not be forwarded to any adapter
+    {
+        StrictMock<MockProtocolGateway> gw(false);
+        auto adapter1 = std::make_shared<MockAdapter>("adapter1", true);
+        auto adapter2 = std::make_shared<MockAdapter>("adapter2", false);
+        gw.Add(adapter1);
+        gw.Add(adapter2);
+
+        ASSERT_TRUE(gw.Publish("test/topic", "test_message", PublishOptions{true, "adapter2"}));
+        ASSERT_TRUE(gw.Publish("test/topic", "test_message", PublishOptions{false, "adapter3"}));
+    }
+
+    // Expect the message to be reported as rejected if any of the adapters
+    // rejects it
+    {
+        StrictMock<MockProtocolGateway> gw(false);
+        auto adapter1 = std::make_shared<MockAdapter>("adapter1", false);
+        auto adapter2 = std::make_shared<MockAdapter>("adapter2", false);
+        gw.Add(adapter1);
+        gw.Add(adapter2);
+
+        PublishOptions opts{false, ""};
+        EXPECT_CALL(*adapter1, Publish("test/topic", "test_message", opts)).WillRepeatedly(::testing::Return(true));
+        EXPECT_CALL(*adapter2, Publish("test/topic", "test_message", opts)).WillOnce(::testing::Return(true)).WillOnce(::testing::Return(false));
+        ASSERT_TRUE(gw.Publish("test/topic", "test_message", opts));
+        ASSERT_FALSE(gw.Publish("test/topic", "test_message", opts));
+    }
+}
+
+/**
+ * @brief Verify that PublishBatch() routes each message by its options and
+ * hands consecutive messages routed to the same adapters over as one batch.
+ */
+TEST(protocol_gateway, PublishBatch) {
+    class MockProtocolGateway : public ProtocolGateway {
+       public:
+        MockProtocolGateway(bool platform_proto_only) : ProtocolGateway("TestProtocolGateway", platform_proto_only) {}
+
+        // Make Add() public for this test
+        bool Add(std::shared_ptr<Adapter> adapter) { return ProtocolGateway::Add(adapter); }
+    };
+
+    class BatchAdapter : public MockAdapter {
+       public:
+        using MockAdapter::MockAdapter;
+
+        MOCK_METHOD(bool, PublishBatch, (const PublishEntry*, size_t), (override));
+    };
+
+    StrictMock<MockProtocolGateway> gw(false);
+    auto adapter1 = std::make_shared<BatchAdapter>("adapter1", true);
+    auto adapter2 = std::make_shared<MockAdapter>("adapter2", false);
+    gw.Add(adapter1);
+    gw.Add(adapter2);
+
+    PublishOptions all{false, ""};
+    PublishOptions platform{true, ""};
+    PublishOptions second{false, "adapter2"};
+
+    std::vector<PublishEntry> entries{
+        {"t1", "m1", all},
+        {"t2", "m2", all},
+        {"t3", "m3", platform},
+        {"t4", "m4", second},
+        {"t5", "m5", second},
+    };
+
+    ::testing::InSequence seq;
+    EXPECT_CALL(*adapter1, PublishBatch(&entries[0], 2)).WillOnce(::testing::Return(true));
+    EXPECT_CALL(*adapter2, Publish("t1", "m1", all)).WillOnce(::testing::Return(true));
+    EXPECT_CALL(*adapter2, Publish("t2", "m2", all)).WillOnce(::testing::Return(true));
+    EXPECT_CALL(*adapter1, PublishBatch(&entries[2], 1)).WillOnce(::testing::Return(true));
+    EXPECT_CALL(*adapter2, Publish("t4", "m4", second)).WillOnce(::testing::Return(false));
+    EXPECT_CALL(*adapter2, Publish("t5", "m5", second)).WillOnce(::testing::Return(true));
+    ASSERT_FALSE(gw.PublishBatch(entries));
 }
 
 TEST(protocol_gateway, Subscribe) {
@@ -491,3 +643,39 @@ TEST(protocol_gateway, SubscribeShared) {
         gw.SubscribeShared("group", "test/topic", cb, opts);
     }
 }
+
+TEST(protocol_gateway, SubscribePayload) {
+    class MockProtocolGateway : public ProtocolGateway {
+       public:
+        MockProtocolGateway() : ProtocolGateway("TestProtocolGateway", false) {}
+
+        // Make Add() public for this test
+        bool Add(std::shared_ptr<Adapter> adapter) { return ProtocolGateway::Add(adapter); }
+    };
+
+    std::string received;
+    on_payload_func_ptr cb = [&received](const std::string&, const payload_ptr& msg, const std::string&) {
+        received = *msg;
+    };
+
+    // Verify that adapters without support for payload_ptr receive a
+    // subscription wrapping the callback
+    StrictMock<MockProtocolGateway> gw;
+    auto adapter = std::make_shared<MockAdapter>("adapter", false);
+    gw.Add(adapter);
+
+    SubscribeOptions opts{false, ""};
+    on_msg_func_ptr on_msg;
+    EXPECT_CALL(*adapter, Subscribe("test/topic", ::testing::_, opts)).WillOnce(::testing::SaveArg<1>(&on_msg));
+    gw.SubscribePayload("test/topic", cb, opts);
+
+    on_msg("test/topic", "message", "adapter");
+    ASSERT_EQ(received, "message");
+
+    on_msg_func_ptr on_shared_msg;
+    EXPECT_CALL(*adapter, SubscribeShared("group", "test/topic", ::testing::_, opts)).WillOnce(::testing::SaveArg<2>(&on_shared_msg));
+    gw.SubscribeSharedPayload("group", "test/topic", cb, opts);
+
+    on_shared_msg("test/topic", "shared message", "adapter");
+    ASSERT_EQ(received, "shared message");
+}
@@ -0,0 +1,228 @@
+/*****************************************************************************
+ * Copyright (c) 2021 Bosch.IO GmbH
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * SPDX-License-Identifier: MPL-2.0
+ ****************************************************************************/
+
+#include <chrono>
+#include <condition_variable>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "publisher.hpp"
+
+using namespace iotea::core;
+
+namespace {
+
+// Records the published messages, batches wait until the gateway is opened
+class GatedGateway : public ProtocolGateway {
+   public:
+    explicit GatedGateway(bool open = true)
+        : ProtocolGateway{"GatedGateway", false}
+        , open_{open} {}
+
+    bool Publish(const std::string&, const std::string& msg, const PublishOptions&) override {
+        std::lock_guard<std::mutex> lock{mutex_};
+        published_.push_back(msg);
+        return true;
+    }
+
+    bool PublishBatch(const std::vector<PublishEntry>& entries) override {
+        std::unique_lock<std::mutex> lock{mutex_};
+        entered_ = true;
+        cv_.notify_all();
+        cv_.wait(lock, [this] { return open_; });
+
+        for (const auto& e : entries) {
+            published_.push_back(e.msg);
+        }
+
+        return true;
+    }
+
+    // Wait until the publisher thread is stuck in PublishBatch()
+    void WaitEntered() {
+        std::unique_lock<std::mutex> lock{mutex_};
+        cv_.wait(lock, [this] { return entered_; });
+    }
+
+    void Open() {
+        std::lock_guard<std::mutex> lock{mutex_};
+        open_ = true;
+        cv_.notify_all();
+    }
+
+    std::vector<std::string> GetPublished() {
+        std::lock_guard<std::mutex> lock{mutex_};
+        return published_;
+    }
+
+   private:
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    bool open_;
+    bool entered_ = false;
+    std::vector<std::string> published_;
+};
+
+using msgs_t = std::vector<std::string>;
+
+}  // namespace
+
+/**
+ * @brief Verify that messages are published on the posting thread while the
+ * publisher thread is not running.
+ */
+TEST(publisher, Post_NotRunning) {
+    auto gateway = std::make_shared<GatedGateway>(false);
+    Publisher publisher{gateway, PublisherOptions{}};
+
+    ASSERT_EQ(publisher.Post("topic", "a"), PublishStatus::OK);
+
+    publisher.Start();
+    publisher.Stop();
+
+    ASSERT_EQ(publisher.Post("topic", "b"), PublishStatus::OK);
+    ASSERT_EQ(gateway->GetPublished(), (msgs_t{"a", "b"}));
+    ASSERT_EQ(publisher.GetStats()[static_cast<size_t>(PublishPriority::NORMAL)].published, 2u);
+}
+
+/**
+ * @brief Verify that the queue of the higher priority class is drained first.
+ */
+TEST(publisher, Post_Priority) {
+    auto gateway = std::make_shared<GatedGateway>(false);
+    Publisher publisher{gateway, PublisherOptions{}};
+    publisher.Start();
+
+    publisher.Post("topic", "first");
+    gateway->WaitEntered();
+
+    ASSERT_EQ(publisher.Post("topic", "n1"), PublishStatus::OK);
+    ASSERT_EQ(publisher.Post("topic", "n2"), PublishStatus::OK);
+    ASSERT_EQ(publisher.Post("topic", "h1", PublishPriority::HIGH), PublishStatus::OK);
+
+    gateway->Open();
+    publisher.Stop();
+
+    ASSERT_EQ(gateway->GetPublished(), (msgs_t{"first", "h1", "n1", "n2"}));
+}
+
+/**
+ * @brief Verify the DROP_NEWEST and DROP_OLDEST overflow policies.
+ */
+TEST(publisher, Post_Drop) {
+    auto gateway = std::make_shared<GatedGateway>(false);
+    auto options = PublisherOptions{}
+        .SetQueue(PublishPriority::HIGH, 2, PublisherOptions::Overflow::DROP_NEWEST)
+        .SetQueue(PublishPriority::NORMAL, 2, PublisherOptions::Overflow::DROP_OLDEST);
+    Publisher publisher{gateway, options};
+    publisher.Start();
+
+    publisher.Post("topic", "first");
+    gateway->WaitEntered();
+
+    ASSERT_EQ(publisher.Post("topic", "h1", PublishPriority::HIGH), PublishStatus::OK);
+    ASSERT_EQ(publisher.Post("topic", "h2", PublishPriority::HIGH), PublishStatus::OK);
+    ASSERT_EQ(publisher.Post("topic", "h3", PublishPriority::HIGH), PublishStatus::DROPPED);
+
+    ASSERT_EQ(publisher.Post("topic", "n1"), PublishStatus::OK);
+    ASSERT_EQ(publisher.Post("topic", "n2"), PublishStatus::OK);
+    ASSERT_EQ(publisher.Post("topic", "n3"), PublishStatus::DISPLACED);
+
+    auto stats = publisher.GetStats();
+    ASSERT_EQ(stats[static_cast<size_t>(PublishPriority::HIGH)].queue_depth, 2u);
+    ASSERT_EQ(stats[static_cast<size_t>(PublishPriority::HIGH)].dropped, 1u);
+    ASSERT_EQ(stats[static_cast<size_t>(PublishPriority::NORMAL)].queue_depth, 2u);
+    ASSERT_EQ(stats[static_cast<size_t>(PublishPriority::NORMAL)].displaced, 1u);
+
+    gateway->Open();
+    publisher.Stop();
+
+    ASSERT_EQ(gateway->GetPublished(), (msgs_t{"first", "h1", "h2", "n2", "n3"}));
+
+    stats = publisher.GetStats();
+    ASSERT_EQ(stats[static_cast<size_t>(PublishPriority::HIGH)].published, 2u);
+    ASSERT_EQ(stats[static_cast<size_t>(PublishPriority::NORMAL)].published, 3u);
+}
+
+/**
+ * @brief Verify that the BLOCK overflow policy makes the producer wait until
+ * the publisher thread has made room.
+ */
+TEST(publisher, Post_Block) {
+    auto gateway = std::make_shared<GatedGateway>(false);
+    auto options = PublisherOptions{}.SetQueue(PublishPriority::NORMAL, 2, PublisherOptions::Overflow::BLOCK);
+    Publisher publisher{gateway, options};
+    publisher.Start();
+
+    publisher.Post("topic", "first");
+    gateway->WaitEntered();
+
+    ASSERT_EQ(publisher.Post("topic", "n1"), PublishStatus::OK);
+    ASSERT_EQ(publisher.Post("topic", "n2"), PublishStatus::OK);
+
+    auto blocked = std::async(std::launch::async, [&publisher] { return publisher.Post("topic", "n3"); });
+    ASSERT_EQ(blocked.wait_for(std::chrono::milliseconds{50}), std::future_status::timeout);
+
+    gateway->Open();
+    ASSERT_EQ(blocked.get(), PublishStatus::THROTTLED);
+
+    publisher.Stop();
+
+    ASSERT_EQ(gateway->GetPublished(), (msgs_t{"first", "n1", "n2", "n3"}));
+    ASSERT_EQ(publisher.GetStats()[static_cast<size_t>(PublishPriority::NORMAL)].throttled, 1u);
+}
+
+/**
+ * @brief Verify that no message is lost or reordered when several threads
+ * post to a small blocking queue.
+ */
+TEST(publisher, Post_Concurrent) {
+    static constexpr int PRODUCERS = 4;
+    static constexpr int MESSAGES = 10000;
+
+    auto gateway = std::make_shared<GatedGateway>();
+    auto options = PublisherOptions{}.SetQueue(PublishPriority::NORMAL, 16, PublisherOptions::Overflow::BLOCK);
+    Publisher publisher{gateway, options};
+    publisher.Start();
+
+    std::vector<std::thread> producers;
+    for (auto p = 0; p < PRODUCERS; p++) {
+        producers.emplace_back([&publisher, p] {
+            for (auto i = 0; i < MESSAGES; i++) {
+                publisher.Post("topic", std::to_string(p) + ":" + std::to_string(i));
+            }
+        });
+    }
+
+    for (auto& t : producers) {
+        t.join();
+    }
+
+    publisher.Stop();
+
+    auto published = gateway->GetPublished();
+    ASSERT_EQ(published.size(), static_cast<size_t>(PRODUCERS * MESSAGES));
+
+    std::vector<int> next(PRODUCERS, 0);
+    for (const auto& m : published) {
+        auto sep = m.find(':');
+        auto p = std::stoi(m.substr(0, sep));
+        auto i = std::stoi(m.substr(sep + 1));
+
+        ASSERT_EQ(i, next[p]);
+        next[p]++;
+    }
+}
@@ -0,0 +1,98 @@
+/*****************************************************************************
+ * Copyright (c) 2021 Bosch.IO GmbH
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * SPDX-License-Identifier: MPL-2.0
+ ****************************************************************************/
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "nlohmann/json.hpp"
+
+#include "raw_json.hpp"
+
+using json = nlohmann::json;
+using namespace iotea::core;
+
+/**
+ * @brief Verify that the members of an object are found and decoded,
+ * including strings with escape sequences and nested values.
+ */
+TEST(raw_json, RawJsonObject_Decode) {
+    RawJsonObject obj{R"( {
+        "s": "plain",
+        "e": "a \"quoted\" \\ string",
+        "n": -12,
+        "b": true,
+        "z": null,
+        "o": {"a": [1, {"b": "}]"}], "c": "\\"},
+        "a": [[], {}]
+    } )"};
+
+    ASSERT_TRUE(obj.IsValid());
+
+    ASSERT_EQ(obj.DecodeString(*obj.Find("s")), "plain");
+    ASSERT_EQ(obj.DecodeString(*obj.Find("e")), "a \"quoted\" \\ string");
+    ASSERT_EQ(obj.DecodeInt(*obj.Find("n")), -12);
+    ASSERT_EQ(obj.Decode("b"), json(true));
+    ASSERT_EQ(obj.Decode("z"), json(nullptr));
+    ASSERT_EQ(obj.Decode("o"), json::parse(R"({"a": [1, {"b": "}]"}], "c": "\\"})"));
+    ASSERT_EQ(obj.Decode("a"), json::parse("[[], {}]"));
+
+    ASSERT_EQ(obj.Find("missing"), nullptr);
+    ASSERT_EQ(obj.Decode("missing"), json{});
+
+    ASSERT_THROW(obj.DecodeString(*obj.Find("n")), json::type_error);
+
+    RawJsonObject empty{"{}"};
+    ASSERT_TRUE(empty.IsValid());
+    ASSERT_EQ(empty.Find("s"), nullptr);
+}
+
+/**
+ * @brief Verify that an object indexes a shared payload in place instead of
+ * copying it.
+ */
+TEST(raw_json, RawJsonObject_SharedPayload) {
+    auto payload = std::make_shared<const std::string>(R"({"s": "plain"})");
+    RawJsonObject obj{payload};
+
+    ASSERT_TRUE(obj.IsValid());
+    ASSERT_EQ(obj.GetPayload(), payload);
+    ASSERT_EQ(obj.GetText().data(), payload->data());
+    ASSERT_EQ(obj.DecodeString(*obj.Find("s")), "plain");
+
+    RawJsonObject none{payload_ptr{}};
+    ASSERT_FALSE(none.IsValid());
+    ASSERT_EQ(none.GetText(), "");
+}
+
+/**
+ * @brief Verify that malformed objects are rejected.
+ */
+TEST(raw_json, RawJsonObject_Invalid) {
+    const std::vector<std::string> invalid{
+        "",
+        "[]",
+        "\"string\"",
+        "{",
+        R"({"a": 1)",
+        R"({"a": 1,})",
+        R"({"a" 1})",
+        R"({"a": })",
+        R"({"a": [1, 2})",
+        R"({"a": "unterminated})",
+        R"({"a": 1} trailing)",
+        R"({a: 1})",
+    };
+
+    for (const auto& text : invalid) {
+        ASSERT_FALSE(RawJsonObject{text}.IsValid()) << text;
+    }
+}
@@ -0,0 +1,128 @@
+/*****************************************************************************
+ * Copyright (c) 2021 Bosch.IO GmbH
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * SPDX-License-Identifier: MPL-2.0
+ ****************************************************************************/
+
+#include <limits>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "nlohmann/json.hpp"
+
+#include "call.hpp"
+#include "event.hpp"
+#include "serializer.hpp"
+
+using json = nlohmann::json;
+using namespace iotea::core;
+
+static const std::string ESCAPED = "quote \" backslash \\ control \b\f\n\r\t \x01\x1f\x7f unicode \xc3\xa4\xe2\x82\xac";
+
+template <typename T>
+static void ExpectEvent(const T& value) {
+    auto expected = OutgoingEvent<T>{"subject", "talent", "feature", value, "type", "instance", 1234}.Json().dump();
+
+    std::string have;
+    SerializeEvent(have, "subject", "feature", value, "type", "instance", 1234);
+
+    ASSERT_EQ(have, expected);
+}
+
+/**
+ * @brief Verify that SerializeEvent produces the same bytes as dumping an
+ * OutgoingEvent for values of different types.
+ */
+TEST(serializer, SerializeEvent) {
+    ExpectEvent(42);
+    ExpectEvent(-42);
+    ExpectEvent(std::numeric_limits<int64_t>::min());
+    ExpectEvent(std::numeric_limits<int64_t>::max());
+    ExpectEvent(std::numeric_limits<uint64_t>::max());
+    ExpectEvent(0);
+    ExpectEvent(3.14159);
+    ExpectEvent(1e-300);
+    ExpectEvent(true);
+    ExpectEvent(false);
+    ExpectEvent(std::string{"value"});
+    ExpectEvent(ESCAPED);
+    ExpectEvent(std::vector<int>{1, 2, 3});
+    ExpectEvent(std::map<std::string, double>{{"b", 1.5}, {"a", -0.0}});
+    ExpectEvent(json{{"z", nullptr}, {"a", {1, "two", 3.0}}, {ESCAPED, {{"nested", true}}}});
+    ExpectEvent(json{});
+
+    // Fields are escaped as well
+    auto expected = OutgoingEvent<int>{ESCAPED, "talent", ESCAPED, 1, ESCAPED, ESCAPED, -1}.Json().dump();
+    std::string have;
+    SerializeEvent(have, ESCAPED, ESCAPED, 1, ESCAPED, ESCAPED, -1);
+    ASSERT_EQ(have, expected);
+}
+
+/**
+ * @brief Verify that SerializeCall produces the same bytes as dumping an
+ * OutgoingCall, wrapping arguments that are not an array.
+ */
+TEST(serializer, SerializeCall) {
+    for (const auto& args : {json{1, "two", json{{"three", 3}}}, json{{"single", "object"}}, json(7), json::array()}) {
+        auto wrapped = args.is_array() ? args : json::array({args});
+        auto expected = OutgoingCall{"talent", "channel", "call", "func", wrapped, "subject", "type", 1000, 1234}.Json().dump();
+
+        std::string have;
+        SerializeCall(have, "talent", "channel", "call", "func", args, "subject", "type", 1000, 1234);
+
+        ASSERT_EQ(have, expected);
+    }
+}
+
+/**
+ * @brief Verify that SerializeReply produces the same bytes as the JSON
+ * representation of a reply event.
+ */
+TEST(serializer, SerializeReply) {
+    auto value = json{{"result", {1, 2, 3}}};
+    auto result = json{
+        {"$tsuffix", "/channel/call"},
+        {"$vpath", "value"},
+        {"value", value}
+    };
+
+    auto expected = OutgoingEvent<json>{"subject", "talent", "talent.func", result, "type", "instance", 1234}.Json().dump();
+
+    std::string have;
+    SerializeReply(have, "talent", "func", "channel", "call", value, "subject", "type", "instance", 1234);
+
+    ASSERT_EQ(have, expected);
+}
+
+/**
+ * @brief Verify that nested ScopedBuffers receive distinct, cleared strings
+ * and that strings are reused.
+ */
+TEST(serializer, ScopedBuffer) {
+    const std::string* outer_ptr;
+
+    {
+        ScopedBuffer outer;
+        outer_ptr = &outer.Get();
+        outer.Get() = "outer";
+
+        {
+            ScopedBuffer inner;
+            ASSERT_NE(&inner.Get(), &outer.Get());
+            ASSERT_TRUE(inner.Get().empty());
+            inner.Get() = "inner";
+        }
+
+        ASSERT_EQ(outer.Get(), "outer");
+    }
+
+    ScopedBuffer again;
+    ASSERT_EQ(&again.Get(), outer_ptr);
+    ASSERT_TRUE(again.Get().empty());
+}
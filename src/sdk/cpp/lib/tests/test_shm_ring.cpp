@@ -0,0 +1,184 @@
+/*****************************************************************************
+ * Copyright (c) 2021 Bosch.IO GmbH
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * SPDX-License-Identifier: MPL-2.0
+ ****************************************************************************/
+
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "shm_ring.hpp"
+
+using namespace iotea::core;
+
+// Memory shared with child processes
+class SharedMemory {
+   public:
+    explicit SharedMemory(size_t size)
+        : size_{size}
+        , mem_{::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0)} {}
+
+    ~SharedMemory() { ::munmap(mem_, size_); }
+
+    void* Get() const { return mem_; }
+    size_t Size() const { return size_; }
+
+   private:
+    size_t size_;
+    void* mem_;
+};
+
+/**
+ * @brief Verify that messages are popped in order across many wraps of the
+ * ring and that pushes to a full ring are dropped.
+ */
+TEST(shm_ring, PushPop) {
+    SharedMemory mem{ShmRing::Size(256)};
+
+    ShmRing producer;
+    ShmRing consumer;
+    ASSERT_FALSE(consumer.Attach(mem.Get(), mem.Size()));
+    ASSERT_TRUE(producer.Create(mem.Get(), mem.Size()));
+    ASSERT_TRUE(consumer.Attach(mem.Get(), mem.Size()));
+
+    uint32_t tag;
+    std::string topic, payload;
+    ASSERT_FALSE(consumer.Pop(tag, topic, payload));
+
+    for (uint32_t i = 0; i < 1000; i++) {
+        auto p = std::string(i % 50, 'x') + std::to_string(i);
+        ASSERT_TRUE(producer.Push(i, "topic/" + std::to_string(i % 7), p.data(), p.size()));
+
+        ASSERT_TRUE(consumer.Pop(tag, topic, payload));
+        ASSERT_EQ(tag, i);
+        ASSERT_EQ(topic, "topic/" + std::to_string(i % 7));
+        ASSERT_EQ(payload, p);
+        ASSERT_FALSE(consumer.Pop(tag, topic, payload));
+    }
+
+    // Fill the ring
+    auto pushed = 0;
+    while (producer.Push(1, "t", "0123456789", 10)) {
+        pushed++;
+    }
+
+    ASSERT_EQ(pushed, 256 / 32);
+    ASSERT_EQ(producer.Dropped(), 1);
+
+    // Too large to ever fit
+    std::string large(300, 'x');
+    ASSERT_TRUE(consumer.Pop(tag, topic, payload));
+    ASSERT_FALSE(producer.Push(1, "t", large.data(), large.size()));
+    ASSERT_EQ(producer.Dropped(), 2);
+}
+
+/**
+ * @brief Verify that Wait() returns once a message is pushed by another
+ * thread or Wake() is called, and after the timeout otherwise.
+ */
+TEST(shm_ring, Wait) {
+    SharedMemory mem{ShmRing::Size(1024)};
+
+    ShmRing ring;
+    ASSERT_TRUE(ring.Create(mem.Get(), mem.Size()));
+
+    ASSERT_FALSE(ring.Wait(std::chrono::milliseconds{10}));
+
+    std::thread producer{[&mem] {
+        ShmRing r;
+        r.Attach(mem.Get(), mem.Size());
+        std::this_thread::sleep_for(std::chrono::milliseconds{20});
+        r.Push(0, "topic", "payload", 7);
+    }};
+
+    auto start = std::chrono::steady_clock::now();
+    while (!ring.Wait(std::chrono::seconds{5})) {}
+    ASSERT_LT(std::chrono::steady_clock::now() - start, std::chrono::seconds{5});
+    producer.join();
+
+    ring.Wake();
+    start = std::chrono::steady_clock::now();
+    ASSERT_TRUE(ring.Wait(std::chrono::seconds{5}));
+    ASSERT_LT(std::chrono::steady_clock::now() - start, std::chrono::seconds{1});
+
+    uint32_t tag;
+    std::string topic, payload;
+    ASSERT_TRUE(ring.Pop(tag, topic, payload));
+
+    ring.Wake();
+    start = std::chrono::steady_clock::now();
+    ASSERT_FALSE(ring.Wait(std::chrono::seconds{5}));
+    ASSERT_LT(std::chrono::steady_clock::now() - start, std::chrono::seconds{1});
+}
+
+/**
+ * @brief Verify that the messages of several producer processes all arrive,
+ * in order per producer.
+ */
+TEST(shm_ring, MultipleProcesses) {
+    static constexpr uint32_t PRODUCERS = 4;
+    static constexpr uint32_t MESSAGES = 10000;
+
+    SharedMemory mem{ShmRing::Size(4096)};
+
+    ShmRing consumer;
+    ASSERT_TRUE(consumer.Create(mem.Get(), mem.Size()));
+
+    std::vector<pid_t> children;
+    for (uint32_t p = 0; p < PRODUCERS; p++) {
+        auto pid = ::fork();
+        ASSERT_GE(pid, 0);
+
+        if (pid == 0) {
+            ShmRing producer;
+            producer.Attach(mem.Get(), mem.Size());
+
+            for (uint32_t i = 0; i < MESSAGES; i++) {
+                auto payload = std::to_string(i);
+                while (!producer.Push(p, "topic", payload.data(), payload.size())) {
+                    std::this_thread::yield();
+                }
+            }
+
+            ::_exit(0);
+        }
+
+        children.push_back(pid);
+    }
+
+    std::vector<uint32_t> next(PRODUCERS, 0);
+    uint32_t received = 0;
+
+    uint32_t tag;
+    std::string topic, payload;
+
+    while (received < PRODUCERS * MESSAGES) {
+        if (!consumer.Pop(tag, topic, payload)) {
+            consumer.Wait(std::chrono::milliseconds{100});
+            continue;
+        }
+
+        ASSERT_LT(tag, PRODUCERS);
+        ASSERT_EQ(payload, std::to_string(next[tag]));
+        next[tag]++;
+        received++;
+    }
+
+    for (auto pid : children) {
+        int status;
+        ::waitpid(pid, &status, 0);
+        ASSERT_TRUE(WIFEXITED(status));
+    }
+}
@@ -0,0 +1,135 @@
+/*****************************************************************************
+ * Copyright (c) 2021 Bosch.IO GmbH
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * SPDX-License-Identifier: MPL-2.0
+ ****************************************************************************/
+
+#include <unistd.h>
+
+#include <cstdio>
+#include <string>
+
+#include "gtest/gtest.h"
+
+#include "spool.hpp"
+
+using iotea::core::Spool;
+using iotea::core::SpoolRecord;
+
+static std::string SpoolPath(const std::string& name) {
+    auto path = ::testing::TempDir() + "iotea_spool_" + name + "_" + std::to_string(::getpid());
+    std::remove(path.c_str());
+    return path;
+}
+
+/**
+ * @brief Verify that messages are returned oldest first with their options.
+ */
+TEST(spool, AppendPeekPop) {
+    auto path = SpoolPath("append");
+
+    Spool spool;
+    ASSERT_TRUE(spool.Open(path, 4096));
+    ASSERT_EQ(spool.Count(), 0u);
+
+    SpoolRecord record;
+    ASSERT_FALSE(spool.Peek(record));
+
+    ASSERT_TRUE(spool.Append("topic/1", "payload 1", 1, false));
+    ASSERT_TRUE(spool.Append("topic/2", "", 0, true));
+    ASSERT_EQ(spool.Count(), 2u);
+
+    ASSERT_TRUE(spool.Peek(record));
+    ASSERT_EQ(record.topic, "topic/1");
+    ASSERT_EQ(record.payload, "payload 1");
+    ASSERT_EQ(record.qos, 1);
+    ASSERT_FALSE(record.retain);
+    spool.Pop();
+
+    ASSERT_TRUE(spool.Peek(record));
+    ASSERT_EQ(record.topic, "topic/2");
+    ASSERT_EQ(record.payload, "");
+    ASSERT_EQ(record.qos, 0);
+    ASSERT_TRUE(record.retain);
+    spool.Pop();
+
+    ASSERT_EQ(spool.Count(), 0u);
+    ASSERT_FALSE(spool.Peek(record));
+
+    spool.Close();
+    std::remove(path.c_str());
+}
+
+/**
+ * @brief Verify that the oldest messages are dropped once the spool is full
+ * and that the order is kept when the ring wraps.
+ */
+TEST(spool, DropOldest) {
+    auto path = SpoolPath("drop");
+
+    // Each record takes 16 + 1 + 10 bytes, padded to 32
+    Spool spool;
+    ASSERT_TRUE(spool.Open(path, 200));
+
+    for (auto i = 0; i < 20; i++) {
+        ASSERT_TRUE(spool.Append("t", "payload-" + std::to_string(10 + i), 0, false));
+    }
+
+    // 200 bytes hold 6 records, the remaining 8 bytes are wrap padding
+    ASSERT_EQ(spool.Count(), 6u);
+    ASSERT_EQ(spool.Dropped(), 14u);
+
+    SpoolRecord record;
+    for (auto i = 14; i < 20; i++) {
+        ASSERT_TRUE(spool.Peek(record));
+        ASSERT_EQ(record.payload, "payload-" + std::to_string(10 + i));
+        spool.Pop();
+    }
+
+    ASSERT_EQ(spool.Count(), 0u);
+
+    // A message larger than the spool is rejected
+    ASSERT_FALSE(spool.Append("t", std::string(300, 'x'), 0, false));
+
+    spool.Close();
+    std::remove(path.c_str());
+}
+
+/**
+ * @brief Verify that spooled messages survive reopening the spool and that
+ * a spool of a different capacity is discarded.
+ */
+TEST(spool, Reopen) {
+    auto path = SpoolPath("reopen");
+
+    {
+        Spool spool;
+        ASSERT_TRUE(spool.Open(path, 1024));
+        ASSERT_TRUE(spool.Append("topic/1", "payload 1", 1, false));
+        ASSERT_TRUE(spool.Append("topic/2", "payload 2", 1, false));
+        spool.Pop();
+    }
+
+    {
+        Spool spool;
+        ASSERT_TRUE(spool.Open(path, 1024));
+        ASSERT_EQ(spool.Count(), 1u);
+
+        SpoolRecord record;
+        ASSERT_TRUE(spool.Peek(record));
+        ASSERT_EQ(record.topic, "topic/2");
+        ASSERT_EQ(record.payload, "payload 2");
+    }
+
+    {
+        Spool spool;
+        ASSERT_TRUE(spool.Open(path, 2048));
+        ASSERT_EQ(spool.Count(), 0u);
+    }
+
+    std::remove(path.c_str());
+}
@@ -406,6 +406,34 @@ TEST(talent, FunctionTalent_RegisterFunction) {
     }
 }
 
+/**
+ * @brief Verify that FunctionTalent::FindFunction resolves the input feature
+ * of each registered function and nothing else.
+ */
+TEST(talent, FunctionTalent_FindFunction) {
+    auto talent = FunctionTalent{"FunctionTalent_FindFunction"};
+
+    auto calls = 0;
+    talent.RegisterFunction("alpha", [&calls](const json&, call_ctx_ptr) { calls++; });
+    talent.RegisterFunction("beta", [](const json&, call_ctx_ptr) {});
+
+    auto alpha = talent.FindFunction("FunctionTalent_FindFunction.alpha-in");
+    ASSERT_NE(alpha, nullptr);
+    EXPECT_EQ(alpha->name, "alpha");
+    EXPECT_EQ(alpha->output_feature, "alpha-out");
+    alpha->func(json{}, nullptr);
+    EXPECT_EQ(calls, 1);
+
+    auto beta = talent.FindFunction("FunctionTalent_FindFunction.beta-in");
+    ASSERT_NE(beta, nullptr);
+    EXPECT_EQ(beta->name, "beta");
+
+    EXPECT_EQ(talent.FindFunction("alpha-in"), nullptr);
+    EXPECT_EQ(talent.FindFunction("FunctionTalent_FindFunction.alpha-out"), nullptr);
+    EXPECT_EQ(talent.FindFunction("other_talent.alpha-in"), nullptr);
+    EXPECT_EQ(talent.FindFunction("FunctionTalent_FindFunction.gamma-in"), nullptr);
+}
+
 /**
  * @brief Verify that FunctionTalent::GetSchema produces a proper schema for
  * each permutation of; FunctionTalent
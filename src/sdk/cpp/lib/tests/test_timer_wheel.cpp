@@ -0,0 +1,135 @@
+/*****************************************************************************
+ * Copyright (c) 2021 Bosch.IO GmbH
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * SPDX-License-Identifier: MPL-2.0
+ ****************************************************************************/
+
+#include <map>
+#include <random>
+#include <set>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "timer_wheel.hpp"
+
+using namespace iotea::core;
+
+/**
+ * @brief Verify that timers expire once their deadline has passed, never
+ * earlier and at most one resolution later.
+ */
+TEST(timer_wheel, TimerWheel_Advance) {
+    TimerWheel w{5};
+
+    // Timers scheduled before the first Advance() are placed relative to it
+    auto t0 = w.Schedule(1012);
+    auto t1 = w.Schedule(1015);
+    auto t2 = w.Schedule(990);
+
+    ASSERT_EQ(w.Advance(1000), std::vector<timer_id_t>{t2});
+    ASSERT_EQ(w.Advance(1009), std::vector<timer_id_t>{});
+    ASSERT_EQ(w.Advance(1014), std::vector<timer_id_t>{});
+    ASSERT_EQ(w.Advance(1015), (std::vector<timer_id_t>{t0, t1}));
+    ASSERT_EQ(w.Size(), 0);
+
+    // Timers that are already due expire on the next Advance()
+    auto t3 = w.Schedule(1015);
+    ASSERT_EQ(w.Advance(1015), std::vector<timer_id_t>{t3});
+}
+
+/**
+ * @brief Verify that cancelled timers never expire.
+ */
+TEST(timer_wheel, TimerWheel_Cancel) {
+    TimerWheel w{1};
+    w.Advance(0);
+
+    auto t0 = w.Schedule(10);
+    auto t1 = w.Schedule(100000);
+    auto t2 = w.Schedule(10);
+
+    ASSERT_TRUE(w.Cancel(t0));
+    ASSERT_FALSE(w.Cancel(t0));
+    ASSERT_TRUE(w.Cancel(t1));
+    ASSERT_EQ(w.Size(), 1);
+
+    ASSERT_EQ(w.Advance(1000000), std::vector<timer_id_t>{t2});
+    ASSERT_FALSE(w.Cancel(t2));
+}
+
+/**
+ * @brief Compare the wheel against a reference implementation for random
+ * deadlines spanning all levels of the wheel (and beyond) and random steps.
+ */
+TEST(timer_wheel, TimerWheel_Random) {
+    std::mt19937_64 rng{42};
+    std::uniform_int_distribution<int64_t> deadline{0, int64_t{1} << 26};
+    std::uniform_int_distribution<int64_t> step{0, 1 << 14};
+
+    TimerWheel w{1};
+    std::map<timer_id_t, int64_t> deadlines;
+
+    int64_t now = 1000;
+    w.Advance(now);
+
+    for (auto i = 0; i < 2000; i++) {
+        auto d = now + deadline(rng);
+        deadlines[w.Schedule(d)] = d;
+    }
+
+    // Cancel every tenth timer
+    for (auto it = deadlines.begin(); it != deadlines.end();) {
+        if (it->first % 10 == 0) {
+            ASSERT_TRUE(w.Cancel(it->first));
+            it = deadlines.erase(it);
+        } else {
+            ++it;
+        }
+    }
+
+    while (!deadlines.empty()) {
+        now += step(rng);
+
+        std::set<timer_id_t> have;
+        for (auto id : w.Advance(now)) {
+            have.insert(id);
+        }
+
+        std::set<timer_id_t> expected;
+        for (auto it = deadlines.begin(); it != deadlines.end();) {
+            if (it->second <= now) {
+                expected.insert(it->first);
+                it = deadlines.erase(it);
+            } else {
+                ++it;
+            }
+        }
+
+        ASSERT_EQ(have, expected) << "now=" << now;
+    }
+
+    ASSERT_EQ(w.Size(), 0);
+}
+
+/**
+ * @brief Verify that changing the resolution keeps the scheduled timers.
+ */
+TEST(timer_wheel, TimerWheel_SetResolution) {
+    TimerWheel w{1000};
+    w.Advance(0);
+
+    auto t0 = w.Schedule(7);
+    auto t1 = w.Schedule(12);
+
+    w.SetResolution(5);
+    ASSERT_EQ(w.GetResolution(), 5);
+
+    ASSERT_EQ(w.Advance(6), std::vector<timer_id_t>{});
+    ASSERT_EQ(w.Advance(10), std::vector<timer_id_t>{t0});
+    ASSERT_EQ(w.Advance(15), std::vector<timer_id_t>{t1});
+}
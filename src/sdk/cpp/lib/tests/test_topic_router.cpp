@@ -0,0 +1,107 @@
+/*****************************************************************************
+ * Copyright (c) 2021 Bosch.IO GmbH
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * SPDX-License-Identifier: MPL-2.0
+ ****************************************************************************/
+
+#include <string>
+
+#include "gtest/gtest.h"
+
+#include "topic_router.hpp"
+
+using namespace iotea::core;
+
+/**
+ * @brief Verify that TopicRouter::Resolve classifies topics and extracts the
+ * talent, channel and call IDs.
+ */
+TEST(topic_router, TopicRouter_Resolve) {
+    TopicRouter router;
+    router.AddTalent("known", "known.00000000-0000-0000-0000-000000000000");
+
+    struct {
+        std::string topic;
+        TopicRoute::Type type;
+        bool known;
+        std::string talent;
+        std::string channel;
+        std::string call;
+    } tests[] {
+        // Events
+        {"iotea/talent/known/events", TopicRoute::Type::EVENT, true, "known", "", ""},
+        {"iotea/talent/unknown/events", TopicRoute::Type::EVENT, false, "unknown", "", ""},
+        {"a/b/talent/unknown/events", TopicRoute::Type::EVENT, false, "unknown", "", ""},
+        {"/talent/unknown/events", TopicRoute::Type::EVENT, false, "unknown", "", ""},
+        {"talent/unknown/events", TopicRoute::Type::UNKNOWN, false, "", "", ""},
+        {"iotea/talent//events", TopicRoute::Type::UNKNOWN, false, "", "", ""},
+        {"iotea/talents/known/events", TopicRoute::Type::UNKNOWN, false, "", "", ""},
+
+        // Call replies
+        {"iotea/talent/known/events/known.00000000-0000-0000-0000-000000000000/call-id",
+            TopicRoute::Type::CALL_REPLY, true, "known", "00000000-0000-0000-0000-000000000000", "call-id"},
+        {"iotea/talent/other/events/unknown.channel/call-id",
+            TopicRoute::Type::CALL_REPLY, false, "unknown", "channel", "call-id"},
+        {"iotea/talent/other/events/unknown.chan.nel/call-id",
+            TopicRoute::Type::CALL_REPLY, false, "unknown", "chan.nel", "call-id"},
+        {"iotea/talent/other/events/no-period/call-id", TopicRoute::Type::UNKNOWN, false, "", "", ""},
+        {"iotea/talent/other/events/.channel/call-id", TopicRoute::Type::UNKNOWN, false, "", "", ""},
+        {"iotea/talent/other/events/unknown./call-id", TopicRoute::Type::UNKNOWN, false, "", "", ""},
+        {"iotea/talent/other/events/unknown.channel/", TopicRoute::Type::UNKNOWN, false, "", "", ""},
+
+        // Call IDs spanning several levels
+        {"iotea/talent/known/events/known.00000000-0000-0000-0000-000000000000/call/id",
+            TopicRoute::Type::CALL_REPLY, true, "known", "00000000-0000-0000-0000-000000000000", "call/id"},
+        {"talent/other/events/unknown.channel/a/b/c", TopicRoute::Type::UNKNOWN, false, "", "", ""},
+        {"/talent/other/events/unknown.channel/a/b/c", TopicRoute::Type::CALL_REPLY, false, "unknown", "channel", "a/b/c"},
+        {"iotea/talent/other/events/unknown.channel/a/talent/x/events/y", TopicRoute::Type::CALL_REPLY, false,
+            "unknown", "channel", "a/talent/x/events/y"},
+        {"iotea/talent/other/events/unknown.channel/a/talent/x/events/y.z/b", TopicRoute::Type::CALL_REPLY, false,
+            "y", "z", "b"},
+        {"iotea/talent/other/events/no-period/call/id", TopicRoute::Type::UNKNOWN, false, "", "", ""},
+        {"iotea/talent/other/events/unknown.channel//", TopicRoute::Type::CALL_REPLY, false, "unknown", "channel", "/"},
+
+        // Discover and platform events
+        {"iotea/configManager/talents/discover", TopicRoute::Type::DISCOVER, false, "", "", ""},
+        {"iotea/platform/$events", TopicRoute::Type::PLATFORM_EVENT, false, "", "", ""},
+        {"iotea/platform/events", TopicRoute::Type::UNKNOWN, false, "", "", ""},
+        {"", TopicRoute::Type::UNKNOWN, false, "", "", ""},
+    };
+
+    for (const auto& t : tests) {
+        auto route = router.Resolve(t.topic);
+
+        ASSERT_EQ(route.type, t.type) << t.topic;
+        ASSERT_EQ(route.talent.ToString(), t.talent) << t.topic;
+        ASSERT_EQ(route.channel.ToString(), t.channel) << t.topic;
+        ASSERT_EQ(route.call.ToString(), t.call) << t.topic;
+        ASSERT_EQ(route.talent_id != nullptr, t.known) << t.topic;
+
+        if (t.known) {
+            ASSERT_EQ(*route.talent_id, t.talent);
+        }
+
+        if (t.known && t.type == TopicRoute::Type::CALL_REPLY) {
+            ASSERT_EQ(*route.channel_id, t.channel);
+        }
+    }
+}
+
+/**
+ * @brief Verify that the slices of a TopicRoute refer to the resolved topic
+ * rather than to copies of it.
+ */
+TEST(topic_router, TopicRouter_NoCopy) {
+    TopicRouter router;
+
+    std::string topic{"iotea/talent/talent-id/events/talent-id.channel/call-id"};
+    auto route = router.Resolve(topic);
+
+    ASSERT_EQ(route.type, TopicRoute::Type::CALL_REPLY);
+    ASSERT_EQ(route.talent.data, topic.data() + topic.find("talent-id.channel"));
+    ASSERT_EQ(route.call.data, topic.data() + topic.rfind('/') + 1);
+}
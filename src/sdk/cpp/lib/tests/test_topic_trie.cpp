@@ -0,0 +1,86 @@
+/*****************************************************************************
+ * Copyright (c) 2021 Bosch.IO GmbH
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * SPDX-License-Identifier: MPL-2.0
+ ****************************************************************************/
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "topic_trie.hpp"
+
+using iotea::core::TopicTrie;
+
+static std::vector<int> MatchAll(const TopicTrie<int>& trie, const std::string& topic) {
+    std::vector<int> matches;
+    trie.Match(topic, [&matches](int v) { matches.push_back(v); });
+    std::sort(matches.begin(), matches.end());
+    return matches;
+}
+
+/**
+ * @brief Verify that TopicTrie::Match reports the values of all matching
+ * filters according to the MQTT wildcard rules.
+ */
+TEST(topic_trie, Match) {
+    TopicTrie<int> trie;
+    trie.Insert("iotea/plain/topic", 1);
+    trie.Insert("iotea/+/topic", 2);
+    trie.Insert("iotea/#", 3);
+    trie.Insert("iotea/plain/+", 4);
+    trie.Insert("iotea/+/+/level", 5);
+    trie.Insert("#", 6);
+    trie.Insert("+/plain/#", 7);
+    trie.Insert("iotea/plain/topic", 8);
+
+    ASSERT_EQ(trie.Size(), 8u);
+
+    ASSERT_EQ(MatchAll(trie, "iotea/plain/topic"), (std::vector<int>{1, 2, 3, 4, 6, 7, 8}));
+    ASSERT_EQ(MatchAll(trie, "iotea/other/topic"), (std::vector<int>{2, 3, 6}));
+    ASSERT_EQ(MatchAll(trie, "iotea/plain/topic/level"), (std::vector<int>{3, 5, 6, 7}));
+    ASSERT_EQ(MatchAll(trie, "iotea/plain"), (std::vector<int>{3, 6, 7}));
+    ASSERT_EQ(MatchAll(trie, "iotea"), (std::vector<int>{3, 6}));
+    ASSERT_EQ(MatchAll(trie, "other"), (std::vector<int>{6}));
+
+    // '+' matches empty levels as well
+    ASSERT_EQ(MatchAll(trie, "iotea//topic"), (std::vector<int>{2, 3, 6}));
+
+    // Levels are compared as a whole
+    ASSERT_EQ(MatchAll(trie, "iotea/plain/topics"), (std::vector<int>{3, 4, 6, 7}));
+    ASSERT_EQ(MatchAll(trie, "iotea.plain"), (std::vector<int>{6}));
+}
+
+/**
+ * @brief Verify that wildcards in the first level do not match topics
+ * starting with '$' while wildcards in other levels do.
+ */
+TEST(topic_trie, Match_Dollar) {
+    TopicTrie<int> trie;
+    trie.Insert("#", 1);
+    trie.Insert("+/$events", 2);
+    trie.Insert("$SYS/#", 3);
+    trie.Insert("platform/+", 4);
+
+    ASSERT_EQ(MatchAll(trie, "$SYS/broker/uptime"), (std::vector<int>{3}));
+    ASSERT_EQ(MatchAll(trie, "platform/$events"), (std::vector<int>{1, 2, 4}));
+}
+
+/**
+ * @brief Verify that shared subscriptions are matched by their filter.
+ */
+TEST(topic_trie, Insert_Shared) {
+    TopicTrie<int> trie;
+    trie.Insert("$share/group/iotea/talent/+/events", 1);
+    trie.Insert("$share/other/iotea/talent/+/events", 2);
+    trie.Insert("iotea/talent/+/events", 3);
+
+    ASSERT_EQ(MatchAll(trie, "iotea/talent/my-talent/events"), (std::vector<int>{1, 2, 3}));
+    ASSERT_EQ(MatchAll(trie, "$share/group/iotea/talent/my-talent/events"), (std::vector<int>{}));
+}
@@ -150,6 +150,27 @@ TEST(util, TopicExprMatcher_Match) {
             "iotea/topic/with/all/level1/level2/suffix1/suffix2",
             true,
         },
+        // Characters with a special meaning in regular expressions
+        {
+            "iotea/topic/with/(parens)|[brackets]*",
+            "iotea/topic/with/(parens)|[brackets]*",
+            true,
+        },
+        {
+            "iotea/topic/with/a*",
+            "iotea/topic/with/aaa",
+            false,
+        },
+        {
+            "iotea/topic/with/+.period",
+            "iotea/topic/with/one.two.period",
+            true,
+        },
+        {
+            "iotea/topic/with/+.period",
+            "iotea/topic/with/.period",
+            false,
+        },
     };
 
     for (const auto& t : tests) {